@@ -22,7 +22,15 @@ const int kBallSpeed = kBarSpeed;
 
 array<bitset<kNumBlocksX>, kNumBlocksY> blocks;
 
-void DrawBlocks(uint64_t layer_id) {
+// 한 프레임의 그리기 명령. 프레임 끝에서 SyscallWinDraw로 한 번에 그린다
+array<WinDrawCmd, kNumBlocksX * kNumBlocksY + 8> cmds;
+size_t num_cmds = 0;
+
+void FillRect(int x, int y, int w, int h, uint32_t color) {
+  cmds[num_cmds++] = WinDrawFillRectCmd(x, y, w, h, color);
+}
+
+void DrawBlocks() {
   for (int by = 0; by < kNumBlocksY; ++by) {
     const int y = 24 + kGapHeight + by * kBlockHeight;
     const uint32_t color = 0xff << (by % 3) * 8;
@@ -31,25 +39,22 @@ void DrawBlocks(uint64_t layer_id) {
       if (blocks[by][bx]) {
         const int x = 4 + kGapWidth + bx * kBlockWidth;
         const uint32_t c = color | (0xff << ((bx + by) % 3) * 8);
-        SyscallWinFillRectangle(layer_id, x, y, kBlockWidth, kBlockHeight, c);
+        FillRect(x, y, kBlockWidth, kBlockHeight, c);
       }
     }
   }
 }
 
-void DrawBar(uint64_t layer_id, int bar_x) {
-  SyscallWinFillRectangle(layer_id,
-                          4 + bar_x, 24 + kBarY,
-                          kBarWidth, kBarHeight, 0xffffff);
+void DrawBar(int bar_x) {
+  FillRect(4 + bar_x, 24 + kBarY,
+           kBarWidth, kBarHeight, 0xffffff);
 }
 
-void DrawBall(uint64_t layer_id, int x, int y) {
-  SyscallWinFillRectangle(layer_id,
-                          4 + x - kBallRadius, 24 + y - kBallRadius,
-                          2 * kBallRadius, 2 * kBallRadius, 0x007f00);
-  SyscallWinFillRectangle(layer_id,
-                          4 + x - kBallRadius/2, 24 + y - kBallRadius/2,
-                          kBallRadius, kBallRadius, 0x00ff00);
+void DrawBall(int x, int y) {
+  FillRect(4 + x - kBallRadius, 24 + y - kBallRadius,
+           2 * kBallRadius, 2 * kBallRadius, 0x007f00);
+  FillRect(4 + x - kBallRadius/2, 24 + y - kBallRadius/2,
+           kBallRadius, kBallRadius, 0x00ff00);
 }
 
 template <class T>
@@ -84,23 +89,23 @@ extern "C" void main(int argc, char** argv) {
 
   for (;;) {
     // 画面を一旦クリアし，各種オブジェクトを描画
-    SyscallWinFillRectangle(layer_id | LAYER_NO_REDRAW,
-                            4, 24, kCanvasWidth, kCanvasHeight, 0);
+    num_cmds = 0;
+    FillRect(4, 24, kCanvasWidth, kCanvasHeight, 0);
 
-    DrawBlocks(layer_id | LAYER_NO_REDRAW);
-    DrawBar(layer_id | LAYER_NO_REDRAW, bar_x);
+    DrawBlocks();
+    DrawBar(bar_x);
     if (ball_y >= 0) {
-      DrawBall(layer_id | LAYER_NO_REDRAW, ball_x, ball_y);
+      DrawBall(ball_x, ball_y);
     }
-    SyscallWinRedraw(layer_id);
+    SyscallWinDraw(layer_id, cmds.data(), num_cmds);
 
     static unsigned long prev_timeout = 0;
     if (prev_timeout == 0) {
-      const auto timeout = SyscallCreateTimer(TIMER_ONESHOT_REL, 1, 1000 / kFrameRate);
+      const auto timeout = SyscallCreateTimer(TIMER_ONESHOT_REL, 1, 1000 / kFrameRate, nullptr);
       prev_timeout = timeout.value;
     } else {
       prev_timeout += 1000 / kFrameRate;
-      SyscallCreateTimer(TIMER_ONESHOT_ABS, 1, prev_timeout);
+      SyscallCreateTimer(TIMER_ONESHOT_ABS, 1, prev_timeout, nullptr);
     }
 
     // #@@range_begin(read_event)
@@ -0,0 +1,48 @@
+#include "clock.h"
+#include "../kernel/time_page.hpp"
+
+static const volatile struct TimePage* const time_page = (const volatile struct TimePage*)TIME_PAGE_ADDR;
+
+static inline uint64_t ReadTSC(void) {
+	uint32_t lo, hi;
+	__asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+	return (uint64_t)hi << 32 | lo;
+}
+
+/* seqlock: 커널이 갱신하는 도중이거나 읽는 사이에 갱신되었으면 다시 읽는다 */
+static struct TimePage ReadTimePage(void) {
+	struct TimePage t;
+	uint32_t seq;
+	do {
+		seq = __atomic_load_n(&time_page->seq, __ATOMIC_ACQUIRE);
+		t.tick = time_page->tick;
+		t.tick_freq = time_page->tick_freq;
+		t.tsc_at_tick = time_page->tsc_at_tick;
+		t.tsc_freq = time_page->tsc_freq;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while ((seq & 1) || seq != __atomic_load_n(&time_page->seq, __ATOMIC_RELAXED));
+	t.seq = seq;
+	return t;
+}
+
+struct SysTimerResult ClockGetTick(void) {
+	const struct TimePage t = ReadTimePage();
+	struct SysTimerResult res = { t.tick, (int)t.tick_freq };
+	return res;
+}
+
+uint64_t ClockNowNs(void) {
+	const struct TimePage t = ReadTimePage();
+	const uint64_t ns = t.tick / t.tick_freq * 1000000000ull + t.tick % t.tick_freq * 1000000000ull / t.tick_freq;
+	if (t.tsc_freq == 0) {
+		return ns;
+	}
+
+	// 다음 tick 값을 넘어가지 않도록 한 tick 길이로 제한해서 시간이 거꾸로 가지 않게 한다
+	const uint64_t tsc_per_tick = t.tsc_freq / t.tick_freq;
+	uint64_t delta = ReadTSC() - t.tsc_at_tick;
+	if (delta > tsc_per_tick) {
+		delta = tsc_per_tick;
+	}
+	return ns + delta * 1000000000ull / t.tsc_freq;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "syscall.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 커널이 매핑해준 시간 정보 페이지(kernel/time_page.hpp)를 읽어서 시스템콜 없이 시각을 구한다.
+ */
+
+/** @brief SyscallGetCurrentTick과 같은 값 (tick, 초당 tick 수) */
+struct SysTimerResult ClockGetTick(void);
+/**
+ * @brief 부팅 이후 경과 시간 (나노초). 마지막 tick 이후의 시간은 TSC로 보간하며, TSC 주파수를 모르면 tick 단위로 증가합니다
+ */
+uint64_t ClockNowNs(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
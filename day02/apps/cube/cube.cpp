@@ -191,14 +191,14 @@ void DrawSurface_opt(uint64_t layer_id, int surf) {
 bool Sleep(unsigned long ms) {
 	static unsigned long prv_timeout = 0;
 	if (prv_timeout == 0) {
-		auto timeout = SyscallCreateTimer(TIMER_ONESHOT_REL, 1, ms);
+		auto timeout = SyscallCreateTimer(TIMER_ONESHOT_REL, 1, ms, nullptr);
 		prv_timeout = timeout.value;
 	}
 	else {
 		prv_timeout += ms;
-		auto timeout = SyscallCreateTimer(TIMER_ONESHOT_ABS, 1, prv_timeout);
+		auto timeout = SyscallCreateTimer(TIMER_ONESHOT_ABS, 1, prv_timeout, nullptr);
 	}
-	SyscallCreateTimer(TIMER_ONESHOT_REL, 1, ms);
+	SyscallCreateTimer(TIMER_ONESHOT_REL, 1, ms, nullptr);
 	
 	AppEvent e;
 	while (true) {
@@ -264,8 +264,8 @@ struct Vector2D {
   T x, y;
 };
 
-void DrawObj(uint64_t layer_id);
-void DrawSurface(uint64_t layer_id, int sur);
+void DrawObj();
+void DrawSurface(int sur);
 bool Sleep(unsigned long ms);
 
 const int kScale = 50, kMargin = 10;
@@ -284,6 +284,7 @@ const array<uint32_t, kSurface.size()> kColor{
 array<Vector3D<double>, kCube.size()> vert;
 array<double, kSurface.size()> centerz4;
 array<Vector2D<int>, kCube.size()> scr;
+array<uint32_t, kCanvasSize * kCanvasSize> canvas; // 한 프레임을 여기에 그리고 SyscallWinBlit으로 복사한다
 
 extern "C" void main(int argc, char** argv) {
   auto [layer_id, err_openwin]
@@ -321,10 +322,12 @@ extern "C" void main(int argc, char** argv) {
 	}
 
 	// 画面を一旦クリアし，立方体を描画
-	SyscallWinFillRectangle(layer_id | LAYER_NO_REDRAW,
-							4, 24, kCanvasSize, kCanvasSize, 0);
-	DrawObj(layer_id | LAYER_NO_REDRAW);
-	SyscallWinRedraw(layer_id);
+	canvas.fill(0);
+	DrawObj();
+	WinBlitImage image{};
+	image.pixels = canvas.data();
+	image.width = image.height = kCanvasSize;
+	SyscallWinBlit(layer_id, 4, 24, &image);
 	if (Sleep(50)) {
 	  break;
 	}
@@ -334,7 +337,7 @@ extern "C" void main(int argc, char** argv) {
   exit(0);
 }
 
-void DrawObj(uint64_t layer_id) {
+void DrawObj() {
   // オブジェクト座標 vert を スクリーン座標 scr に変換（画面奥が Z+）
   for (int i = 0; i < kCube.size(); i++) {
 	const double t = 6*kScale / (vert[i].z + 8*kScale);
@@ -358,12 +361,12 @@ void DrawObj(uint64_t layer_id) {
 	const auto e0x = v1.x - v0.x, e0y = v1.y - v0.y, // v0 --> v1
 			   e1x = v2.x - v1.x, e1y = v2.y - v1.y; // v1 --> v2
 	if (e0x * e1y <= e0y * e1x) {
-	  DrawSurface(layer_id, sur);
+	  DrawSurface(sur);
 	}
   }
 }
 
-void DrawSurface(uint64_t layer_id, int sur) {
+void DrawSurface(int sur) {
   const auto& surface = kSurface[sur]; // 描画する面
   int ymin = kCanvasSize, ymax = 0; // 画面の描画範囲 [ymin, ymax]
   int y2x_up[kCanvasSize], y2x_down[kCanvasSize]; // Y, X 座標の組
@@ -394,20 +397,20 @@ void DrawSurface(uint64_t layer_id, int sur) {
   }
 
   for (int y = ymin; y <= ymax; y++) {
-	int p0x = min(y2x_up[y], y2x_down[y]);
-	int p1x = max(y2x_up[y], y2x_down[y]);
-	SyscallWinFillRectangle(layer_id, 4 + p0x, 24 + y, p1x - p0x + 1, 1, kColor[sur]);
+	int p0x = max(min(y2x_up[y], y2x_down[y]), 0);
+	int p1x = min(max(y2x_up[y], y2x_down[y]), kCanvasSize - 1);
+	fill(&canvas[y * kCanvasSize + p0x], &canvas[y * kCanvasSize + p1x + 1], kColor[sur]);
   }
 }
 
 bool Sleep(unsigned long ms) {
   static unsigned long prev_timeout = 0;
   if (prev_timeout == 0) {
-	const auto timeout = SyscallCreateTimer(TIMER_ONESHOT_REL, 1, ms);
+	const auto timeout = SyscallCreateTimer(TIMER_ONESHOT_REL, 1, ms, nullptr);
 	prev_timeout = timeout.value;
   } else {
 	prev_timeout += ms;
-	SyscallCreateTimer(TIMER_ONESHOT_ABS, 1, prev_timeout);
+	SyscallCreateTimer(TIMER_ONESHOT_ABS, 1, prev_timeout, nullptr);
   }
 
   AppEvent events[1];
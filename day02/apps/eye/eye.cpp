@@ -31,25 +31,36 @@ extern "C" void main(int argc, void** argv) {
 
 	SyscallWinFillRect(layerID, 4, 24, kCanvasSize, kCanvasSize, 0xffffff);
 
-	AppEvent e;
-	while (true) {
-		auto [n, err] = SyscallReadEvent(&e, 1);
+	AppEvent events[16];
+	bool quit = false;
+	while (!quit) {
+		auto [n, err] = SyscallReadEvent(events, 16);
 		if (err) {
 			printf("ReadEvent failed: %s\n", strerror(err));
 			break;
 		}
-		if (e.type == AppEvent::kQuit) {
-			break;
+
+		// 한 번에 받은 마우스 이동 중 마지막 위치만 그린다
+		const AppEvent* last_move = nullptr;
+		for (size_t i = 0; i < n; i++) {
+			const AppEvent& e = events[i];
+			if (e.type == AppEvent::kQuit) {
+				quit = true;
+				break;
+			}
+			else if (e.type == AppEvent::kMouseMove) {
+				last_move = &e;
+			}
+			else {
+				printf("unknown event: type = %d\n", e.type);
+			}
 		}
-		else if (e.type == AppEvent::kMouseMove) {
-			auto& arg = e.arg.mouse_move;
+		if (!quit && last_move) {
+			auto& arg = last_move->arg.mouse_move;
 			SyscallWinFillRect(layerID | LAYER_NO_DRAW, 4, 24, kCanvasSize, kCanvasSize, 0xffffff);
 			printf("X: %d, Y: %d\n", arg.x, arg.y);
 			DrawEye(layerID, arg.x, arg.y, 0x000000);
 		}
-		else {
-			printf("unknown event: type = %d\n", e.type);
-		}
 	}
 	SyscallCloseWindow(layerID);
 	exit(0);
@@ -0,0 +1,51 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include "../syscall.h"
+
+// fork 처리량 측정: fork -> 자식은 곧바로 종료 -> 부모가 wait 하는 과정을 반복한다
+// 자식이 페이지에 쓰면 copy-on-write로 복사되므로, touch_pages 만큼 힙 페이지에 써서 복사 비용도 같이 잰다
+namespace {
+	constexpr size_t kPageSize = 4096;
+}
+
+extern "C" void main(int argc, char** argv) {
+	const unsigned long iterations = argc > 1 ? atoi(argv[1]) : 1000;
+	const size_t heap_pages = argc > 2 ? atoi(argv[2]) : 256;
+	const size_t touch_pages = argc > 3 ? atoi(argv[3]) : 0;
+
+	// 부모의 주소 공간을 키워서 fork가 복제해야 할 페이지를 만든다
+	auto heap = static_cast<char*>(malloc(heap_pages * kPageSize));
+	if (heap == nullptr) {
+		printf("malloc: %s\n", strerror(errno));
+		exit(1);
+	}
+	memset(heap, 1, heap_pages * kPageSize);
+	fflush(stdout); // 자식이 버퍼에 남은 출력을 중복해서 내보내지 않도록 한다
+
+	const auto start = SyscallGetCurrentTick();
+	for (unsigned long i = 0; i < iterations; i++) {
+		auto child = SyscallFork();
+		if (child.error) {
+			printf("fork: %s\n", strerror(child.error));
+			exit(1);
+		}
+		if (child.value == 0) {
+			for (size_t p = 0; p < touch_pages && p < heap_pages; p++) {
+				heap[p * kPageSize] = 2;
+			}
+			SyscallExit(0);
+		}
+		SyscallWaitChild(child.value);
+	}
+	const auto end = SyscallGetCurrentTick();
+
+	const unsigned long ms = (end.tick - start.tick) * 1000 / end.freq;
+	printf("fork+exit+wait: %lu iterations, %lu heap pages (%lu touched), %lu ms", iterations, heap_pages, touch_pages, ms);
+	if (ms > 0) {
+		printf(", %lu forks/s", iterations * 1000 / ms);
+	}
+	printf("\n");
+	exit(0);
+}
@@ -86,13 +86,19 @@ extern "C" void main(int argc, char** argv) {
   }
   const uint64_t layer_id = window.value;
 
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      uint32_t c = get_color(&image_data[bytes_per_pixel * (y * width + x)]);
-      SyscallWinFillRectangle(layer_id | LAYER_NO_REDRAW,
-                              4 + x, 24 + y, 1, 1, c);
-    }
+  // 0x00RRGGBB로 변환해 두고 시스템콜 한 번으로 창에 복사한다
+  auto pixels = new uint32_t[width * height];
+  for (int i = 0; i < width * height; ++i) {
+    pixels[i] = get_color(&image_data[bytes_per_pixel * i]);
+  }
+  WinBlitImage image{};
+  image.pixels = pixels;
+  image.width = width;
+  image.height = height;
+  if (auto err = SyscallWinBlit(layer_id | LAYER_NO_REDRAW, 4, 24, &image).error) {
+    fprintf(stderr, "WinBlit failed: %s\n", strerror(err));
   }
+  delete[] pixels;
 
   SyscallWinRedraw(layer_id);
   WaitEvent();
@@ -0,0 +1,23 @@
+#include <cstdio>
+#include <cstdlib>
+#include "../syscall.h"
+#include "../clock.h"
+
+// 바쁜 루프로 CPU를 계속 점유한다 (스케줄러 지연 측정용). 시각은 2^24회마다 시간 정보 페이지에서 읽고, 시스템콜은 끝날 때 출력에만 사용한다
+extern "C" void main(int argc, char** argv) {
+	const unsigned long duration_s = argc > 1 ? atoi(argv[1]) : 10;
+	const auto start = ClockGetTick();
+	const unsigned long end_tick = start.tick + duration_s * start.freq;
+
+	volatile unsigned long counter = 0;
+	while (true) {
+		for (int i = 0; i < (1 << 24); i++) {
+			++counter;
+		}
+		if (ClockGetTick().tick >= end_tick) {
+			break;
+		}
+	}
+	printf("%lu loops in %lu sec\n", counter, duration_s);
+	exit(0);
+}
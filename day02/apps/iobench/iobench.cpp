@@ -0,0 +1,96 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include "../syscall.h"
+#include "../clock.h"
+
+/*
+ * 파일 I/O 시스템콜 비교
+ * - 쓰기: 1024바이트씩 나눠서 SyscallPutString vs 한 번에 SyscallPutString
+ * - 임의 위치 읽기: 다시 열어서 앞에서부터 읽기 vs SyscallPRead
+ * - 파일 끝을 훨씬 넘는 위치에 쓰기: 파일 크기가 4GiB를 넘게 되므로 EFBIG로 거부되고 파일은 그대로여야 한다
+ */
+namespace {
+	constexpr size_t kRecordBytes = 512;
+
+	int Open(const char* path, int flags) {
+		const auto res = SyscallOpenFile(path, flags);
+		if (res.error) {
+			fprintf(stderr, "failed to open %s: %d\n", path, res.error);
+			exit(1);
+		}
+		return res.value;
+	}
+
+	uint64_t ElapsedUs(uint64_t start_ns) {
+		return (ClockNowNs() - start_ns) / 1000;
+	}
+}
+
+extern "C" void main(int argc, char** argv) {
+	const size_t file_kib = argc > 1 ? atoi(argv[1]) : 256;
+	const int num_reads = argc > 2 ? atoi(argv[2]) : 200;
+	const char* path = argc > 3 ? argv[3] : "iobench.dat";
+	const size_t file_bytes = file_kib * 1024;
+
+	auto buf = static_cast<uint8_t*>(malloc(file_bytes));
+	for (size_t i = 0; i < file_bytes; i++) {
+		buf[i] = i;
+	}
+
+	int fd = Open(path, O_CREAT | O_RDWR);
+	uint64_t start = ClockNowNs();
+	for (size_t off = 0; off < file_bytes; off += 1024) {
+		SyscallPutString(fd, reinterpret_cast<char*>(buf + off), 1024);
+	}
+	printf("write %lu KiB in 1 KiB calls: %lu us\n", file_kib, ElapsedUs(start));
+
+	SyscallSeek(fd, 0, SEEK_SET);
+	start = ClockNowNs();
+	const auto res = SyscallPutString(fd, reinterpret_cast<char*>(buf), file_bytes);
+	printf("write %lu KiB in 1 call: %lu us (%lu bytes)\n", file_kib, ElapsedUs(start), res.value);
+	SyscallCloseFile(fd);
+
+	const size_t num_records = file_bytes / kRecordBytes;
+	uint8_t record[kRecordBytes];
+	srand(1);
+
+	// pread 이전의 방법: 다시 열어서 원하는 위치까지 읽고 버린다
+	start = ClockNowNs();
+	for (int i = 0; i < num_reads; i++) {
+		const size_t r = rand() % num_records;
+		fd = Open(path, O_RDONLY);
+		for (size_t skip = 0; skip < r; skip++) {
+			SyscallReadFile(fd, record, kRecordBytes);
+		}
+		SyscallReadFile(fd, record, kRecordBytes);
+		SyscallCloseFile(fd);
+	}
+	printf("%d random reads by reopen+read: %lu us\n", num_reads, ElapsedUs(start));
+
+	fd = Open(path, O_RDONLY);
+	start = ClockNowNs();
+	int mismatches = 0;
+	for (int i = 0; i < num_reads; i++) {
+		const size_t r = rand() % num_records;
+		SyscallPRead(fd, record, kRecordBytes, r * kRecordBytes);
+		mismatches += memcmp(record, buf + r * kRecordBytes, kRecordBytes) != 0;
+	}
+	printf("%d random reads by pread: %lu us (%d mismatches)\n", num_reads, ElapsedUs(start), mismatches);
+	SyscallCloseFile(fd);
+
+	fd = Open(path, O_RDWR);
+	constexpr uint64_t kFarOffset = uint64_t{1} << 40;
+	const auto far_pwrite = SyscallPWrite(fd, buf, 1, kFarOffset);
+	SyscallSeek(fd, kFarOffset, SEEK_SET);
+	const auto far_write = SyscallPutString(fd, reinterpret_cast<char*>(buf), 1);
+	const auto size = SyscallSeek(fd, 0, SEEK_END);
+	SyscallCloseFile(fd);
+	const bool far_ok = far_pwrite.error == EFBIG && far_write.error == EFBIG && size.value == file_bytes;
+	printf("write at offset 2^40: pwrite error %d, seek+write error %d, file size %lu (%s)\n",
+		far_pwrite.error, far_write.error, size.value, far_ok ? "ok" : "FAILED");
+	exit(far_ok ? 0 : 1);
+}
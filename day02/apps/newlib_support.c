@@ -6,7 +6,28 @@
 #include "syscall.h"
 
 int getpid(void) {
-	return 1;
+	return SyscallGetTaskID().value;
+}
+
+pid_t fork(void) {
+  struct SyscallResult res = SyscallFork();
+  if (res.error == 0) {
+    return res.value;
+  }
+  errno = res.error;
+  return -1;
+}
+
+pid_t waitpid(pid_t pid, int* status, int options) {
+  struct SyscallResult res = SyscallWaitChild(pid);
+  if (res.error) {
+    errno = res.error;
+    return -1;
+  }
+  if (status) {
+    *status = (res.value & 0xff) << 8; // WEXITSTATUS
+  }
+  return pid;
 }
 
 int kill(int pid, int sig) {
@@ -15,7 +36,11 @@ int kill(int pid, int sig) {
 }
 
 int close(int fd) {
-  errno = EBADF;
+  struct SyscallResult res = SyscallCloseFile(fd);
+  if (res.error == 0) {
+    return 0;
+  }
+  errno = res.error;
   return -1;
 }
 
@@ -30,7 +55,37 @@ int isatty(int fd) {
 }
 
 off_t lseek(int fd, off_t offset, int whence) {
-  errno = EBADF;
+  struct SyscallResult res = SyscallSeek(fd, offset, whence);
+  if (res.error == 0) {
+    return res.value;
+  }
+  errno = res.error;
+  return -1;
+}
+
+ssize_t pread(int fd, void* buf, size_t count, off_t offset) {
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  struct SyscallResult res = SyscallPRead(fd, buf, count, offset);
+  if (res.error == 0) {
+    return res.value;
+  }
+  errno = res.error;
+  return -1;
+}
+
+ssize_t pwrite(int fd, const void* buf, size_t count, off_t offset) {
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  struct SyscallResult res = SyscallPWrite(fd, buf, count, offset);
+  if (res.error == 0) {
+    return res.value;
+  }
+  errno = res.error;
   return -1;
 }
 
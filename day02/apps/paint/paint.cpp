@@ -15,32 +15,37 @@ extern "C" void main(int argc, char** argv) {
 		exit(err);
 	}
 
-	AppEvent event;
+	AppEvent events[16];
 	bool press = false;
-	while (true) {
-		auto [ n, err ] = SyscallReadEvent(&event, 1);
+	bool quit = false;
+	while (!quit) {
+		// 쌓여있는 이벤트를 한 번에 받는다. 연속된 MouseMove는 하나로 합쳐서 선 하나로 그린다
+		auto [ n, err ] = SyscallReadEventTimeout(events, 16, READ_EVENT_COALESCE_MOUSE, READ_EVENT_WAIT_FOREVER);
 		if (err) {
 			printf("revnt failed: %s\n", strerror(err));
 			break;
 		}
-		if (event.type == AppEvent::kQuit) break;
-		else if (event.type == AppEvent::kMouseMove) {
-			auto& arg = event.arg.mouse_move;
-			const auto px = arg.x - arg.dx;
-			const auto py = arg.y - arg.dy;
-			if (press && IsInside(px, py) && IsInside(arg.x, arg.y)) {
-				SyscallWinDrawLine(layer_id, px, py, arg.x, arg.y, 0x000000);
+		for (size_t i = 0; i < n && !quit; i++) {
+			const AppEvent& event = events[i];
+			if (event.type == AppEvent::kQuit) quit = true;
+			else if (event.type == AppEvent::kMouseMove) {
+				auto& arg = event.arg.mouse_move;
+				const auto px = arg.x - arg.dx;
+				const auto py = arg.y - arg.dy;
+				if (press && IsInside(px, py) && IsInside(arg.x, arg.y)) {
+					SyscallWinDrawLine(layer_id, px, py, arg.x, arg.y, 0x000000);
+				}
 			}
-		}
-		else if (event.type == AppEvent::kMouseButton) {
-			auto& arg = event.arg.mouse_button;
-			if (arg.button == 0) { // Lclick
-				press = arg.press;
-				SyscallWinFillRect(layer_id, arg.x, arg.y, 1, 1, 0x000000); // draw dot
+			else if (event.type == AppEvent::kMouseButton) {
+				auto& arg = event.arg.mouse_button;
+				if (arg.button == 0) { // Lclick
+					press = arg.press;
+					SyscallWinFillRect(layer_id, arg.x, arg.y, 1, 1, 0x000000); // draw dot
+				}
+			}
+			else {
+				printf("unknown event: %d\n", event.type);
 			}
-		}
-		else {
-			printf("unknown event: %d\n", event.type);
 		}
 	}
 	SyscallCloseWindow(layer_id);
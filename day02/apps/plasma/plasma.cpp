@@ -0,0 +1,63 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../syscall.h"
+#include "../clock.h"
+
+static constexpr int kWidth = 256, kHeight = 192;
+
+// 창 surface에 매 프레임 직접 그리고 SyscallWinCommit으로 화면에 올린다
+extern "C" void main(int argc, char** argv) {
+	int num_frames = 300;
+	if (argc >= 2) {
+		num_frames = atoi(argv[1]);
+	}
+
+	WinSurface surface;
+	auto [layer_id, err] = SyscallOpenWindowSurface(kWidth + 8, kHeight + 28, 10, 10, "plasma", &surface);
+	if (err) {
+		fprintf(stderr, "OpenWindowSurface failed: %s\n", strerror(err));
+		exit(err);
+	}
+
+	uint8_t sine[256];
+	uint32_t palette[256]; // surface의 픽셀 형식으로 미리 변환해 둔다
+	for (int i = 0; i < 256; i++) {
+		const double t = i * 2 * M_PI / 256;
+		sine[i] = static_cast<uint8_t>(127.5 + 127.5 * sin(t));
+		const uint32_t r = 127.5 + 127.5 * sin(t);
+		const uint32_t g = 127.5 + 127.5 * sin(t + 2 * M_PI / 3);
+		const uint32_t b = 127.5 + 127.5 * sin(t + 4 * M_PI / 3);
+		palette[i] = WinSurfaceColor(&surface, r << 16 | g << 8 | b);
+	}
+
+	const auto beg = ClockNowNs();
+	int back = surface.back;
+	for (int frame = 0; frame < num_frames; frame++) {
+		uint32_t* buf = surface.buffers[back];
+		for (int y = 0; y < surface.height; y++) {
+			uint32_t* row = buf + y * surface.stride;
+			const int sy = sine[(y * 2 + frame * 3) & 0xff];
+			for (int x = 0; x < surface.width; x++) {
+				const int v = sine[(x + frame) & 0xff] + sy + sine[(x + y + frame * 2) & 0xff];
+				row[x] = palette[(v / 3 + frame) & 0xff];
+			}
+		}
+
+		auto res = SyscallWinCommit(layer_id, 0, 0, -1, -1);
+		if (res.error) {
+			fprintf(stderr, "WinCommit failed: %s\n", strerror(res.error));
+			exit(res.error);
+		}
+		back = res.value;
+	}
+	const auto elapsed_ns = ClockNowNs() - beg;
+
+	printf("%d frames in %lu ms", num_frames, elapsed_ns / 1000000);
+	if (elapsed_ns > 0) {
+		printf(" (%lu fps)", num_frames * 1000000000ul / elapsed_ns);
+	}
+	printf("\n");
+	exit(0);
+}
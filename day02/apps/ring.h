@@ -0,0 +1,117 @@
+#pragma once
+
+#include "syscall.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * SyscallRingEnter 도우미 (kernel/syscall_ring.hpp 참고).
+ * 항목을 여러 개 채운 뒤 RingSubmit 한 번으로 실행하므로, 그리기 명령처럼 작은 시스템콜을 많이 호출할 때 왕복 비용을 줄인다.
+ * sqes/cqes 배열은 앱이 준비하며 용량은 2의 거듭제곱이어야 한다.
+ */
+
+/* 링으로 실행할 수 있는 시스템콜 (syscall.asm의 번호). Exit, Fork, RingEnter는 제외 */
+#define RING_OP_LOG_STRING         0x80000000
+#define RING_OP_PUT_STRING         0x80000001
+#define RING_OP_OPEN_WINDOW        0x80000003
+#define RING_OP_WIN_WRITE_STRING   0x80000004
+#define RING_OP_WIN_FILL_RECT      0x80000005
+#define RING_OP_GET_CURRENT_TICK   0x80000006
+#define RING_OP_WIN_REDRAW         0x80000007
+#define RING_OP_WIN_DRAW_LINE      0x80000008
+#define RING_OP_CLOSE_WINDOW       0x80000009
+#define RING_OP_READ_EVENT         0x8000000a
+#define RING_OP_CREATE_TIMER       0x8000000b
+#define RING_OP_OPEN_FILE          0x8000000c
+#define RING_OP_READ_FILE          0x8000000d
+#define RING_OP_DEMAND_PAGES       0x8000000e
+#define RING_OP_MAP_FILE           0x8000000f
+#define RING_OP_CANCEL_TIMER       0x80000010
+#define RING_OP_GET_TASK_USAGE     0x80000011
+#define RING_OP_FUTEX_WAIT         0x80000012
+#define RING_OP_FUTEX_WAKE         0x80000013
+#define RING_OP_THREAD_CREATE      0x80000014
+#define RING_OP_THREAD_JOIN        0x80000015
+#define RING_OP_SET_FS_BASE        0x80000016
+#define RING_OP_WAIT_CHILD         0x80000018
+#define RING_OP_SPAWN              0x80000019
+#define RING_OP_GET_TASK_ID        0x8000001a
+#define RING_OP_PREAD              0x8000001c
+#define RING_OP_PWRITE             0x8000001d
+#define RING_OP_SEEK               0x8000001e
+#define RING_OP_CLOSE_FILE         0x8000001f
+#define RING_OP_READV              0x80000020
+#define RING_OP_WRITEV             0x80000021
+#define RING_OP_WIN_BLIT           0x80000022
+#define RING_OP_OPEN_WINDOW_SURFACE 0x80000023
+#define RING_OP_WIN_COMMIT         0x80000024
+#define RING_OP_WIN_DRAW           0x80000025
+#define RING_OP_READ_EVENT_TIMEOUT 0x80000026
+
+/* 시스템콜을 추가하면 SYSCALL_COUNT(kernel/syscall_ring.hpp)와 함께 이 목록도 늘려야 한다 */
+#ifdef __cplusplus
+static_assert(RING_OP_READ_EVENT_TIMEOUT == 0x80000000 + SYSCALL_COUNT - 1, "RING_OP_* must cover every syscall");
+#else
+_Static_assert(RING_OP_READ_EVENT_TIMEOUT == 0x80000000 + SYSCALL_COUNT - 1, "RING_OP_* must cover every syscall");
+#endif
+
+static inline void RingInit(struct SyscallRing* ring,
+                            struct SyscallRingEntry* sqes, uint32_t sq_capacity,
+                            struct SyscallRingCompletion* cqes, uint32_t cq_capacity) {
+	ring->sq_head = ring->sq_tail = 0;
+	ring->cq_head = ring->cq_tail = 0;
+	ring->sq_capacity = sq_capacity;
+	ring->cq_capacity = cq_capacity;
+	ring->sqes = sqes;
+	ring->cqes = cqes;
+}
+
+/**
+ * @brief op(args...)를 submission 링에 넣습니다. RingSubmit을 호출해야 실행됩니다
+ * @param flags SYSCALL_RING_*
+ * @return 링이 가득 차면 0, 넣었으면 1
+ */
+static inline int RingPush(struct SyscallRing* ring, uint64_t op, uint32_t flags, uint64_t user_data,
+                           uint64_t a1, uint64_t a2, uint64_t a3, uint64_t a4, uint64_t a5, uint64_t a6) {
+	const uint32_t tail = ring->sq_tail;
+	if (tail - __atomic_load_n(&ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_capacity) {
+		return 0;
+	}
+	struct SyscallRingEntry* e = &ring->sqes[tail & (ring->sq_capacity - 1)];
+	e->op = op;
+	e->flags = flags;
+	e->reserved = 0;
+	e->args[0] = a1;
+	e->args[1] = a2;
+	e->args[2] = a3;
+	e->args[3] = a4;
+	e->args[4] = a5;
+	e->args[5] = a6;
+	e->user_data = user_data;
+	__atomic_store_n(&ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+/** @brief 지금까지 넣은 항목을 모두 실행합니다 (SyscallRingEnter) */
+static inline struct SyscallResult RingSubmit(struct SyscallRing* ring) {
+	return SyscallRingEnter(ring);
+}
+
+/** @return 꺼낼 completion이 없으면 NULL. 사용한 뒤 RingPopCompletion을 호출해야 합니다 */
+static inline struct SyscallRingCompletion* RingPeekCompletion(struct SyscallRing* ring) {
+	const uint32_t head = ring->cq_head;
+	if (head == __atomic_load_n(&ring->cq_tail, __ATOMIC_ACQUIRE)) {
+		return NULL;
+	}
+	return &ring->cqes[head & (ring->cq_capacity - 1)];
+}
+
+static inline void RingPopCompletion(struct SyscallRing* ring) {
+	__atomic_store_n(&ring->cq_head, ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,79 @@
+#include <cstdio>
+#include <cstdlib>
+#include "../syscall.h"
+#include "../ring.h"
+
+// 작은 사각형 그리기를 시스템콜 하나씩 호출할 때와 SyscallRingEnter로 묶어서 제출할 때의 초당 그리기 횟수를 비교한다
+namespace {
+	constexpr int kWidth = 200, kHeight = 200;
+	constexpr uint32_t kRingSize = 256;
+
+	SyscallRingEntry sqes[kRingSize];
+	SyscallRingCompletion cqes[kRingSize];
+	SyscallRing ring;
+
+	uint64_t layer_id;
+
+	uint32_t Color(int i) {
+		return (i * 0x010307) & 0xffffff;
+	}
+
+	unsigned long ElapsedMs(const SysTimerResult& beg) {
+		const auto end = SyscallGetCurrentTick();
+		return (end.tick - beg.tick) * 1000 / beg.freq;
+	}
+
+	void Report(const char* name, int num_ops, unsigned long ms) {
+		printf("%-8s %d ops in %lu ms", name, num_ops, ms);
+		if (ms > 0) {
+			printf(", %lu ops/s", num_ops * 1000ul / ms);
+		}
+		printf("\n");
+	}
+
+	void DrawPerCall(int num_ops) {
+		for (int i = 0; i < num_ops; i++) {
+			SyscallWinFillRect(layer_id | LAYER_NO_DRAW, 4 + i % (kWidth - 2), 24 + (i / kWidth) % (kHeight - 2), 2, 2, Color(i));
+		}
+		SyscallWinRedraw(layer_id);
+	}
+
+	void DrawRing(int num_ops) {
+		for (int i = 0; i < num_ops; i++) {
+			while (!RingPush(&ring, RING_OP_WIN_FILL_RECT, SYSCALL_RING_SKIP_SUCCESS, i,
+			                 layer_id | LAYER_NO_DRAW, 4 + i % (kWidth - 2), 24 + (i / kWidth) % (kHeight - 2), 2, 2, Color(i))) {
+				RingSubmit(&ring); // submission 링이 가득 찼다
+			}
+		}
+		RingPush(&ring, RING_OP_WIN_REDRAW, SYSCALL_RING_SKIP_SUCCESS, 0, layer_id, 0, 0, 0, 0, 0);
+		RingSubmit(&ring);
+
+		// 실패한 항목만 completion이 생긴다
+		while (auto c = RingPeekCompletion(&ring)) {
+			printf("op %lu failed: %d\n", c->user_data, c->error);
+			RingPopCompletion(&ring);
+		}
+	}
+}
+
+extern "C" void main(int argc, char** argv) {
+	const int num_ops = argc > 1 ? atoi(argv[1]) : 100000;
+
+	auto [id, err] = SyscallOpenWindow(kWidth + 8, kHeight + 28, 10, 10, "ringbench");
+	if (err) {
+		exit(err);
+	}
+	layer_id = id;
+	RingInit(&ring, sqes, kRingSize, cqes, kRingSize);
+
+	auto beg = SyscallGetCurrentTick();
+	DrawPerCall(num_ops);
+	Report("per-call", num_ops, ElapsedMs(beg));
+
+	beg = SyscallGetCurrentTick();
+	DrawRing(num_ops);
+	Report("ring", num_ops, ElapsedMs(beg));
+
+	SyscallCloseWindow(layer_id);
+	exit(0);
+}
@@ -0,0 +1,105 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <immintrin.h>
+#include "../syscall.h"
+#include "../clock.h"
+
+// saxpy(y = a * x + y)를 스칼라, SSE2, AVX2+FMA로 실행해서 결과와 시간을 비교한다.
+// AVX2 경로는 CPUID와 XCR0(커널이 AVX 상태를 저장하도록 켰는지)를 확인한 뒤에만 실행한다
+namespace {
+	constexpr size_t kLen = 4096; // 두 배열이 L1에 들어가는 크기
+
+	alignas(32) float x[kLen];
+	alignas(32) float y[kLen];
+
+	void Cpuid(uint32_t leaf, uint32_t subleaf, uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d) {
+		__asm__ volatile("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(leaf), "c"(subleaf));
+	}
+
+	bool HasAVX2() {
+		uint32_t a, b, c, d;
+		Cpuid(0, 0, a, b, c, d);
+		const uint32_t max_leaf = a;
+		Cpuid(1, 0, a, b, c, d);
+		const bool osxsave = c & (1u << 27), avx = c & (1u << 28), fma = c & (1u << 12);
+		if (!osxsave || !avx || !fma || max_leaf < 7) {
+			return false;
+		}
+		uint32_t xcr0_lo, xcr0_hi;
+		__asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+		if ((xcr0_lo & 6) != 6) { // SSE, AVX 상태를 커널이 저장하지 않으면 사용할 수 없다
+			return false;
+		}
+		Cpuid(7, 0, a, b, c, d);
+		return b & (1u << 5);
+	}
+
+	// 자동 벡터화를 막아서 기준이 되는 스칼라 코드를 만든다
+	__attribute__((noinline)) void SaxpyScalar(float a, const float* x, float* y, size_t n) {
+		#pragma clang loop vectorize(disable) interleave(disable)
+		for (size_t i = 0; i < n; i++) {
+			y[i] = a * x[i] + y[i];
+		}
+	}
+
+	__attribute__((noinline)) void SaxpySSE2(float a, const float* x, float* y, size_t n) {
+		const __m128 va = _mm_set1_ps(a);
+		for (size_t i = 0; i < n; i += 4) {
+			const __m128 v = _mm_add_ps(_mm_mul_ps(va, _mm_load_ps(x + i)), _mm_load_ps(y + i));
+			_mm_store_ps(y + i, v);
+		}
+	}
+
+	__attribute__((noinline, target("avx2,fma"))) void SaxpyAVX2(float a, const float* x, float* y, size_t n) {
+		const __m256 va = _mm256_set1_ps(a);
+		for (size_t i = 0; i < n; i += 8) {
+			_mm256_store_ps(y + i, _mm256_fmadd_ps(va, _mm256_load_ps(x + i), _mm256_load_ps(y + i)));
+		}
+	}
+
+	using SaxpyFunc = void(float, const float*, float*, size_t);
+
+	// y를 초기화하고 rounds번 실행한 시간(ns)과 결과의 합을 반환한다
+	uint64_t Run(SaxpyFunc* f, int rounds, double& checksum) {
+		for (size_t i = 0; i < kLen; i++) {
+			x[i] = static_cast<float>(i % 17) * 0.25f;
+			y[i] = 1.0f;
+		}
+		const uint64_t start = ClockNowNs();
+		for (int r = 0; r < rounds; r++) {
+			f(0.5f / (r + 1), x, y, kLen);
+		}
+		const uint64_t elapsed = ClockNowNs() - start;
+
+		checksum = 0;
+		for (size_t i = 0; i < kLen; i++) {
+			checksum += y[i];
+		}
+		return elapsed;
+	}
+}
+
+extern "C" void main(int argc, char** argv) {
+	const int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+
+	double ref;
+	const uint64_t scalar_ns = Run(SaxpyScalar, rounds, ref);
+	printf("scalar: %lu us\n", scalar_ns / 1000);
+
+	double sum;
+	const uint64_t sse2_ns = Run(SaxpySSE2, rounds, sum);
+	printf("sse2:   %lu us (x%.2f)%s\n", sse2_ns / 1000, static_cast<double>(scalar_ns) / sse2_ns,
+		std::fabs(sum - ref) > std::fabs(ref) * 1e-5 ? " MISMATCH" : "");
+
+	if (!HasAVX2()) {
+		printf("avx2:   not supported (CPUID/XCR0)\n");
+		exit(0);
+	}
+	// FMA는 곱셈 결과를 반올림하지 않으므로 스칼라와 약간 다를 수 있다
+	const uint64_t avx2_ns = Run(SaxpyAVX2, rounds, sum);
+	printf("avx2:   %lu us (x%.2f)%s\n", avx2_ns / 1000, static_cast<double>(scalar_ns) / avx2_ns,
+		std::fabs(sum - ref) > std::fabs(ref) * 1e-5 ? " MISMATCH" : "");
+	exit(0);
+}
@@ -1,6 +1,7 @@
 #include <cstdlib>
 #include <random>
 #include "../syscall.h"
+#include "../clock.h"
 
 static constexpr int kWidth = 100, kHeight = 100;
 
@@ -17,18 +18,23 @@ extern "C" void main(int argc, char** argv) {
 		num_stars = atoi(argv[1]);
 	}
 
-	auto timer_beg = SyscallGetCurrentTick();
+	auto timer_beg = ClockGetTick();
 
 	std::default_random_engine rand_engine;
 	std::uniform_int_distribution x_dist(0, kWidth - 2), y_dist(0, kHeight - 2);
-	for (int i = 0; i < num_stars; i++) {
-		int x = x_dist(rand_engine);
-		int y = y_dist(rand_engine);
-		SyscallWinFillRect(layerID | LAYER_NO_DRAW, 4 + x, 24 + y, 2, 2, 0xfff100);
+	// 별을 WIN_DRAW_MAX_CMDS개씩 묶어서 그린다
+	static WinDrawCmd cmds[WIN_DRAW_MAX_CMDS];
+	for (int i = 0; i < num_stars; ) {
+		int n = 0;
+		for (; n < WIN_DRAW_MAX_CMDS && i < num_stars; n++, i++) {
+			int x = x_dist(rand_engine);
+			int y = y_dist(rand_engine);
+			cmds[n] = WinDrawFillRectCmd(4 + x, 24 + y, 2, 2, 0xfff100);
+		}
+		SyscallWinDraw(layerID, cmds, n);
 	}
-	SyscallWinRedraw(layerID); // flush
 
-	auto timer_end = SyscallGetCurrentTick();
+	auto timer_end = ClockGetTick();
 
 	printf("%lu tick ~ %lu tick\n", timer_beg.tick, timer_end.tick);
 	printf("%d stars in %lu ms.\n", num_stars, (timer_end.tick - timer_beg.tick) * 1000 / timer_beg.freq);
@@ -0,0 +1,80 @@
+#include "sync.h"
+#include "syscall.h"
+
+static uint32_t CompareExchange(uint32_t* p, uint32_t expected, uint32_t desired) {
+	__atomic_compare_exchange_n(p, &expected, desired, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+	return expected; // 교환 전의 값
+}
+
+void MutexLock(struct Mutex* m) {
+	uint32_t c = CompareExchange(&m->state, 0, 1);
+	if (c == 0) {
+		return;
+	}
+
+	// 대기자가 있다고 표시한 뒤에 잠들어야 MutexUnlock이 깨워준다
+	if (c != 2) {
+		c = __atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE);
+	}
+	while (c != 0) {
+		SyscallFutexWait(&m->state, 2);
+		c = __atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE);
+	}
+}
+
+int MutexTryLock(struct Mutex* m) {
+	return CompareExchange(&m->state, 0, 1) == 0;
+}
+
+void MutexUnlock(struct Mutex* m) {
+	if (__atomic_fetch_sub(&m->state, 1, __ATOMIC_RELEASE) != 1) {
+		__atomic_store_n(&m->state, 0, __ATOMIC_RELEASE);
+		SyscallFutexWake(&m->state, 1);
+	}
+}
+
+void CondWait(struct CondVar* cv, struct Mutex* m) {
+	const uint32_t seq = __atomic_load_n(&cv->seq, __ATOMIC_RELAXED);
+	MutexUnlock(m);
+	SyscallFutexWait(&cv->seq, seq);
+
+	// 깨어난 대기자가 여러 개일 수 있으므로 대기자가 있다고 가정하고 잠근다
+	while (__atomic_exchange_n(&m->state, 2, __ATOMIC_ACQUIRE) != 0) {
+		SyscallFutexWait(&m->state, 2);
+	}
+}
+
+void CondSignal(struct CondVar* cv) {
+	__atomic_fetch_add(&cv->seq, 1, __ATOMIC_RELEASE);
+	SyscallFutexWake(&cv->seq, 1);
+}
+
+void CondBroadcast(struct CondVar* cv) {
+	__atomic_fetch_add(&cv->seq, 1, __ATOMIC_RELEASE);
+	SyscallFutexWake(&cv->seq, 0x7fffffff);
+}
+
+int SemTryWait(struct Semaphore* s) {
+	uint32_t v = __atomic_load_n(&s->value, __ATOMIC_RELAXED);
+	while (v > 0) {
+		if (__atomic_compare_exchange_n(&s->value, &v, v - 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+void SemWait(struct Semaphore* s) {
+	while (!SemTryWait(s)) {
+		__atomic_fetch_add(&s->waiters, 1, __ATOMIC_ACQ_REL);
+		SyscallFutexWait(&s->value, 0);
+		__atomic_fetch_sub(&s->waiters, 1, __ATOMIC_RELEASE);
+	}
+}
+
+void SemPost(struct Semaphore* s) {
+	__atomic_fetch_add(&s->value, 1, __ATOMIC_ACQ_REL);
+	if (__atomic_load_n(&s->waiters, __ATOMIC_ACQUIRE) > 0) {
+		SyscallFutexWake(&s->value, 1);
+	}
+}
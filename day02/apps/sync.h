@@ -0,0 +1,52 @@
+#pragma once
+
+#ifdef __cplusplus
+#include <cstdint>
+
+extern "C" {
+#else
+#include <stdint.h>
+#endif
+
+/*
+ * SyscallFutexWait/Wake 기반의 동기화 객체.
+ * 경쟁이 없으면 시스템콜 없이 원자적 연산만으로 끝나고, 기다려야 할 때만 커널에서 잠든다.
+ * 모두 0으로 초기화하면 사용할 수 있다 (MUTEX_INITIALIZER 등).
+ */
+
+/* state: 0 = 해제, 1 = 잠김, 2 = 잠김 + 대기자 있음 */
+struct Mutex {
+	uint32_t state;
+};
+#define MUTEX_INITIALIZER { 0 }
+
+void MutexLock(struct Mutex* m);
+/** @return 잠금에 성공하면 1, 이미 잠겨 있으면 0 */
+int  MutexTryLock(struct Mutex* m);
+void MutexUnlock(struct Mutex* m);
+
+/* seq: signal/broadcast마다 증가하는 번호. 대기자는 잠들기 전에 읽은 번호가 바뀌면 깨어난다 */
+struct CondVar {
+	uint32_t seq;
+};
+#define CONDVAR_INITIALIZER { 0 }
+
+/** @brief m을 풀고 signal/broadcast를 기다린 뒤 다시 m을 잠급니다. 호출자는 깨어난 뒤 조건을 다시 확인해야 합니다 */
+void CondWait(struct CondVar* cv, struct Mutex* m);
+void CondSignal(struct CondVar* cv);
+void CondBroadcast(struct CondVar* cv);
+
+struct Semaphore {
+	uint32_t value;
+	uint32_t waiters;
+};
+#define SEMAPHORE_INITIALIZER(n) { (n), 0 }
+
+void SemWait(struct Semaphore* s);
+/** @return 값을 감소시켰으면 1, 값이 0이면 0 */
+int  SemTryWait(struct Semaphore* s);
+void SemPost(struct Semaphore* s);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
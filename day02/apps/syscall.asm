@@ -25,4 +25,27 @@ define_syscall CreateTimer,      0x8000000b
 define_syscall OpenFile,         0x8000000c
 define_syscall ReadFile,         0x8000000d
 define_syscall DemandPages,      0x8000000e
-define_syscall MapFile,          0x8000000f
\ No newline at end of file
+define_syscall MapFile,          0x8000000f
+define_syscall CancelTimer,      0x80000010
+define_syscall GetTaskUsage,     0x80000011
+define_syscall FutexWait,        0x80000012
+define_syscall FutexWake,        0x80000013
+define_syscall ThreadCreate,     0x80000014
+define_syscall ThreadJoin,       0x80000015
+define_syscall SetFSBase,        0x80000016
+define_syscall Fork,             0x80000017
+define_syscall WaitChild,        0x80000018
+define_syscall Spawn,            0x80000019
+define_syscall GetTaskID,        0x8000001a
+define_syscall RingEnter,        0x8000001b
+define_syscall PRead,            0x8000001c
+define_syscall PWrite,           0x8000001d
+define_syscall Seek,             0x8000001e
+define_syscall CloseFile,        0x8000001f
+define_syscall ReadV,            0x80000020
+define_syscall WriteV,           0x80000021
+define_syscall WinBlit,          0x80000022
+define_syscall OpenWindowSurface, 0x80000023
+define_syscall WinCommit,        0x80000024
+define_syscall WinDraw,          0x80000025
+define_syscall ReadEventTimeout, 0x80000026
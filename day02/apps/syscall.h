@@ -1,3 +1,5 @@
+#pragma once
+
 #ifdef __cplusplus
 #include <cstddef>
 #include <cstdint>
@@ -10,6 +12,12 @@ extern "C" {
 
 #include "../kernel/logger.hpp"
 #include "../kernel/app_event.hpp"
+#include "../kernel/task_usage.hpp"
+#include "../kernel/syscall_ring.hpp"
+#include "../kernel/iovec.hpp"
+#include "../kernel/win_blit.hpp"
+#include "../kernel/win_surface.hpp"
+#include "../kernel/win_draw.hpp"
 
 /**
  * @brief 시스템콜 반환값
@@ -43,16 +51,26 @@ struct SyscallResult SyscallReadEvent(struct AppEvent* events, size_t len);
 
 #define TIMER_ONESHOT_ABS 0 /* 단발 모드, 절대 시각에 인터럽트 발생 */
 #define TIMER_ONESHOT_REL 1 /* 단발 모드, 현재 시각 + 타임아웃에 인터럽트 발생 */
+#define TIMER_PERIODIC    2 /* 주기 모드, 타임아웃마다 반복해서 인터럽트 발생 (TIMER_ONESHOT_REL과 함께 사용) */
+#define TIMER_SLACK_MS(ms) ((unsigned int)(ms) << 16) /* 타임아웃 허용 오차(+/- ms, 최대 65535). 근처의 타이머와 묶여서 발생함 */
 
 /**
  * @brief 밀리초 단위로 타이머를 생성합니다
  * 
- * @param mode 타이머 동작 설정값 (TIMER_ONESHOT_REL, TIMER_ONESHOT_ABS)
+ * @param mode 타이머 동작 설정값 (TIMER_ONESHOT_REL, TIMER_ONESHOT_ABS, TIMER_PERIODIC, TIMER_SLACK_MS(ms))
  * @param timer_value 타이머 반환값 (반드시 양수여야함)
  * @param timeout_ms 타이머 타임아웃 값 (밀리초 단위)
+ * @param timer_id 생성된 타이머의 handle이 저장될 위치 (NULL 가능; SyscallCancelTimer에 사용)
  * @return struct SyscallResult 
  */
-struct SyscallResult SyscallCreateTimer(unsigned int mode, int timer_value, unsigned long timeout_ms);
+struct SyscallResult SyscallCreateTimer(unsigned int mode, int timer_value, unsigned long timeout_ms, uint64_t* timer_id);
+/**
+ * @brief SyscallCreateTimer로 생성한 타이머를 취소합니다
+ * 
+ * @param timer_id 타이머 handle
+ * @return struct SyscallResult (이미 만료된 타이머인 경우 error = EINVAL)
+ */
+struct SyscallResult SyscallCancelTimer(uint64_t timer_id);
 
 struct SyscallResult SyscallOpenFile(const char* path, int flags);
 struct SyscallResult SyscallReadFile(int fd, void* buf, size_t count);
@@ -60,6 +78,146 @@ struct SyscallResult SyscallReadFile(int fd, void* buf, size_t count);
 struct SyscallResult SyscallDemandPages(size_t num_pages, int flags);
 struct SyscallResult SyscallMapFile(int fd, size_t* file_size, int flags);
 
+/**
+ * @brief 현재 Task(앱을 실행 중인 터미널 Task)의 누적 CPU 사용량을 읽어옵니다
+ * 
+ * @param usage 사용량이 저장될 위치
+ * @return struct SyscallResult (value = TSC 주파수(Hz), 측정하지 못한 경우 0)
+ */
+struct SyscallResult SyscallGetTaskUsage(struct TaskUsage* usage);
+
+/**
+ * @brief *addr == val이면 SyscallFutexWake로 깨워질 때까지 잠듭니다
+ * 
+ * @param addr 4바이트 정렬된 futex word (같은 앱의 스레드끼리 사용하며, 창 surface처럼 공유되는 페이지는 물리 주소로 구분됨)
+ * @param val 잠들기 직전에 *addr와 비교할 값
+ * @return struct SyscallResult (*addr != val이면 error = EAGAIN)
+ */
+struct SyscallResult SyscallFutexWait(const uint32_t* addr, uint32_t val);
+/**
+ * @brief addr에서 대기 중인 Task를 최대 n개 깨웁니다
+ * 
+ * @return struct SyscallResult (value = 깨운 Task 수)
+ */
+struct SyscallResult SyscallFutexWake(const uint32_t* addr, int n);
+
+/**
+ * @brief 현재 앱과 주소 공간 및 파일 테이블을 공유하는 스레드를 만듭니다. 타이머와 이벤트는 스레드마다 따로 받습니다 (thread.h 참고)
+ * 
+ * @param entry 스레드 시작 함수. entry(0, arg)로 호출되며 반환하지 않고 SyscallExit을 호출해야 함
+ * @param stack_top 스레드의 user 스택 끝 주소
+ * @param fs_base 스레드의 FS base (TLS; 0 가능)
+ * @return struct SyscallResult (value = 스레드 ID)
+ */
+struct SyscallResult SyscallThreadCreate(void (*entry)(int, void*), void* arg, void* stack_top, void* fs_base);
+/**
+ * @brief 스레드가 SyscallExit을 호출할 때까지 기다립니다. 스레드마다 한 번만 join할 수 있습니다
+ * 
+ * @return struct SyscallResult (value = 스레드의 종료 코드, 이 앱의 스레드가 아니면 error = ESRCH, 앱이 종료 중이면 error = EINTR)
+ */
+struct SyscallResult SyscallThreadJoin(uint64_t thread_id);
+struct SyscallResult SyscallSetFSBase(void* fs_base);
+/**
+ * @brief 현재 앱의 주소 공간을 copy-on-write로 복제한 자식 Task를 만듭니다. 파일 디스크립터는 부모와 공유되며 호출한 스레드만 복제됩니다
+ * 
+ * @return struct SyscallResult (부모: value = 자식 Task ID, 자식: value = 0)
+ */
+struct SyscallResult SyscallFork(void);
+/**
+ * @brief SyscallFork/SyscallSpawn으로 만든 자식이 SyscallExit을 호출할 때까지 기다립니다. 자식마다 한 번만 wait할 수 있습니다
+ * 
+ * @return struct SyscallResult (value = 자식의 종료 코드, 이 앱의 자식이 아니면 error = ECHILD, 앱이 종료 중이면 error = EINTR)
+ */
+struct SyscallResult SyscallWaitChild(uint64_t child_id);
+/**
+ * @brief path의 앱을 터미널 없이 새 Task에서 실행합니다 (posix_spawn). 종료 코드는 SyscallWaitChild로 얻습니다
+ * 
+ * @param argv NULL로 끝나는 인자 배열 (NULL이면 path만 전달, 최대 32개). 인자는 공백으로 이어 붙여 전달되므로 공백을 포함할 수 없음
+ * @param fds 자식의 fd 0, 1, 2가 될 현재 앱의 fd 3개 (NULL이면 0, 1, 2)
+ * @return struct SyscallResult (value = 자식 Task ID, 앱을 찾지 못하면 error = ENOENT)
+ */
+struct SyscallResult SyscallSpawn(const char* path, const char* const* argv, const int* fds);
+/** @return struct SyscallResult (value = 현재 Task(스레드) ID) */
+struct SyscallResult SyscallGetTaskID(void);
+/**
+ * @brief ring에 제출된 시스템콜을 순서대로 실행합니다 (syscall_ring.hpp, ring.h 참고).
+ * SyscallExit, SyscallFork, SyscallRingEnter는 링으로 실행할 수 없습니다 (error = EINVAL)
+ * 
+ * @return struct SyscallResult (value = 실행한 항목 수, completion 링이 가득 차서 하나도 실행하지 못하면 error = EBUSY)
+ */
+struct SyscallResult SyscallRingEnter(struct SyscallRing* ring);
+
+/**
+ * @brief 파일 위치를 바꾸지 않고 offset부터 읽습니다 (pread)
+ * 
+ * @return struct SyscallResult (value = 읽은 바이트 수, 터미널/파이프면 error = ESPIPE)
+ */
+struct SyscallResult SyscallPRead(int fd, void* buf, size_t count, size_t offset);
+/**
+ * @brief 파일 위치를 바꾸지 않고 offset부터 씁니다 (pwrite). 파일 끝을 넘어서 쓰면 그 사이는 0으로 채워집니다
+ * 
+ * @return struct SyscallResult (value = 쓴 바이트 수, 터미널/파이프면 error = ESPIPE)
+ */
+struct SyscallResult SyscallPWrite(int fd, const void* buf, size_t count, size_t offset);
+/**
+ * @brief SyscallReadFile/SyscallPutString이 사용하는 파일 위치를 바꿉니다 (lseek)
+ * 
+ * @param whence SEEK_SET, SEEK_CUR, SEEK_END
+ * @return struct SyscallResult (value = 새 파일 위치. 새 위치가 음수면 EINVAL, int64_t 범위를 넘으면 EOVERFLOW)
+ */
+struct SyscallResult SyscallSeek(int fd, int64_t offset, int whence);
+/** @return struct SyscallResult (SyscallMapFile로 매핑한 파일이면 error = EBUSY) */
+struct SyscallResult SyscallCloseFile(int fd);
+/**
+ * @brief iov의 버퍼를 차례로 채웁니다 (readv). 버퍼 하나를 다 채우지 못하면 거기서 멈춥니다
+ * 
+ * @param iovcnt IOVec 수 (최대 IOV_MAX_COUNT)
+ * @return struct SyscallResult (value = 읽은 바이트 수의 합)
+ */
+struct SyscallResult SyscallReadV(int fd, const struct IOVec* iov, int iovcnt);
+struct SyscallResult SyscallWriteV(int fd, const struct IOVec* iov, int iovcnt);
+/**
+ * @brief image를 창의 (x, y)에 한 번에 복사합니다. 픽셀마다 SyscallWinFillRect를 호출하는 것보다 훨씬 빠릅니다
+ * 
+ * @param layer_id_flags SyscallWinFillRect와 같음 (LAYER_NO_REDRAW)
+ * @param x, y 창의 테두리를 포함한 좌표. 창 밖으로 나가는 부분은 잘립니다
+ * @return struct SyscallResult (이미지를 읽을 수 없으면 error = EFAULT)
+ */
+struct SyscallResult SyscallWinBlit(uint64_t layer_id_flags, int x, int y, const struct WinBlitImage* image);
+/**
+ * @brief SyscallOpenWindow와 같이 창을 열고, 창 내부 영역의 픽셀 버퍼(struct WinSurface)를 앱 주소 공간에 매핑합니다.
+ * 앱은 surface->buffers[surface->back]에 직접 그린 뒤 SyscallWinCommit으로 화면에 반영합니다 (복사 없음)
+ * 
+ * @param surface 매핑된 버퍼 정보를 받을 구조체
+ * @return struct SyscallResult (value = layer id, 버퍼를 할당할 수 없으면 error = ENOMEM)
+ */
+struct SyscallResult SyscallOpenWindowSurface(int w, int h, int x, int y, const char* title, struct WinSurface* surface);
+/**
+ * @brief 그리기를 마친 back 버퍼를 front로 바꾸고 (x, y, w, h) 영역을 다시 그립니다 (surface 좌표, w나 h가 음수면 전체).
+ * 합성기가 새 back 버퍼를 읽는 중이면 다 읽을 때까지 기다리므로 반환된 버퍼에 바로 그려도 됩니다
+ * 
+ * @param layer_id_flags LAYER_NO_DRAW면 다시 그리지 않습니다
+ * @return struct SyscallResult (value = 다음에 그릴 back 버퍼 번호, surface가 없는 창이면 error = EINVAL)
+ */
+struct SyscallResult SyscallWinCommit(uint64_t layer_id_flags, int x, int y, int w, int h);
+/**
+ * @brief 명령 목록(display list)을 차례로 실행하고, 그린 영역의 합집합만 한 번 다시 그립니다.
+ * 프레임마다 LAYER_NO_DRAW로 여러 번 그리고 SyscallWinRedraw를 호출하는 대신 사용합니다
+ * 
+ * @param cmds WinDraw*Cmd로 만든 명령 (최대 WIN_DRAW_MAX_CMDS개). 창 밖과 WIN_DRAW_CLIP 밖은 잘립니다
+ * @return struct SyscallResult (value = 실행한 명령 수, 잘못된 명령을 만나면 거기서 멈추고 error = EINVAL)
+ */
+struct SyscallResult SyscallWinDraw(uint64_t layer_id_flags, const struct WinDrawCmd* cmds, size_t num_cmds);
+/**
+ * @brief SyscallReadEvent와 같지만 기다리는 시간을 정할 수 있고, 빠르게 쌓이는 MouseMove를 합칠 수 있습니다.
+ * 애니메이션 앱은 타이머 없이 timeout_ms로 프레임 간격을 기다리고, 그리기 앱은 READ_EVENT_COALESCE_MOUSE로 이벤트 수를 줄입니다
+ * 
+ * @param flags READ_EVENT_COALESCE_MOUSE
+ * @param timeout_ms READ_EVENT_WAIT_FOREVER(음수)면 이벤트가 올 때까지, READ_EVENT_NO_WAIT(0)면 기다리지 않고, 양수면 최대 그 시간(ms)만큼 기다립니다
+ * @return struct SyscallResult (value = 읽은 이벤트 수. 시간이 다 되었거나 쌓인 이벤트가 없으면 0)
+ */
+struct SyscallResult SyscallReadEventTimeout(struct AppEvent* events, size_t len, unsigned int flags, int timeout_ms);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -0,0 +1,51 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include "../syscall.h"
+#include "../clock.h"
+
+// 아무 일도 하지 않는 시스템콜(SyscallGetTaskID)의 왕복 시간과 시간 조회 비용을 TSC 사이클로 잰다
+namespace {
+	uint64_t ReadTSC() {
+		uint32_t lo, hi;
+		__asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+		return static_cast<uint64_t>(hi) << 32 | lo;
+	}
+}
+
+extern "C" void main(int argc, char** argv) {
+	const unsigned long iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+	const int rounds = argc > 2 ? atoi(argv[2]) : 5;
+
+	uint64_t best = UINT64_MAX;
+	for (int r = 0; r < rounds; r++) {
+		const uint64_t start = ReadTSC();
+		for (unsigned long i = 0; i < iterations; i++) {
+			SyscallGetTaskID();
+		}
+		const uint64_t cycles = (ReadTSC() - start) / iterations;
+		printf("round %d: %lu cycles/syscall\n", r, cycles);
+		if (cycles < best) {
+			best = cycles;
+		}
+	}
+	printf("null syscall round trip: %lu cycles (best of %d x %lu)\n", best, rounds, iterations);
+
+	// 시간 조회: 시스템콜과 시간 정보 페이지(vDSO) 비교
+	uint64_t start = ReadTSC();
+	for (unsigned long i = 0; i < iterations; i++) {
+		SyscallGetCurrentTick();
+	}
+	printf("SyscallGetCurrentTick: %lu cycles/call\n", (ReadTSC() - start) / iterations);
+	start = ReadTSC();
+	for (unsigned long i = 0; i < iterations; i++) {
+		ClockGetTick();
+	}
+	printf("ClockGetTick: %lu cycles/call\n", (ReadTSC() - start) / iterations);
+	start = ReadTSC();
+	for (unsigned long i = 0; i < iterations; i++) {
+		ClockNowNs();
+	}
+	printf("ClockNowNs: %lu cycles/call\n", (ReadTSC() - start) / iterations);
+	exit(0);
+}
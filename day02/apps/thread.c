@@ -0,0 +1,109 @@
+#include <errno.h>
+#include <stdlib.h>
+#include "thread.h"
+#include "sync.h"
+#include "syscall.h"
+
+static struct Thread main_thread;
+static void InitMainThread(void);
+
+// SyscallThreadCreate의 entry. CallApp이 (0, arg)를 넘겨준다
+static void ThreadEntry(int unused, void* arg) {
+	struct Thread* t = (struct Thread*)arg;
+	ThreadExit(t->func(t->arg));
+}
+
+struct Thread* ThreadSelf(void) {
+	InitMainThread();
+	struct Thread* self;
+	__asm__ volatile("mov %%fs:0, %0" : "=r"(self));
+	return self;
+}
+
+// main 스레드는 FS base 없이 시작하므로, 처음 필요할 때 제어 블록을 붙여준다
+static void InitMainThread(void) {
+	if (main_thread.self) {
+		return;
+	}
+	main_thread.self = &main_thread;
+	SyscallSetFSBase(&main_thread);
+}
+
+int ThreadCreate(struct Thread** thread, void* (*func)(void*), void* arg, size_t stack_size) {
+	InitMainThread();
+	if (stack_size == 0) {
+		stack_size = THREAD_DEFAULT_STACK_SIZE;
+	}
+
+	struct Thread* t = malloc(sizeof(struct Thread));
+	void* stack = malloc(stack_size);
+	if (!t || !stack) {
+		free(t);
+		free(stack);
+		return ENOMEM;
+	}
+	t->self = t;
+	t->func = func;
+	t->arg = arg;
+	t->ret = NULL;
+	t->stack = stack;
+
+	struct SyscallResult res = SyscallThreadCreate(ThreadEntry, t, (char*)stack + stack_size, t);
+	if (res.error) {
+		free(stack);
+		free(t);
+		return res.error;
+	}
+	t->id = res.value;
+	*thread = t;
+	return 0;
+}
+
+int ThreadJoin(struct Thread* thread, void** ret) {
+	struct SyscallResult res = SyscallThreadJoin(thread->id);
+	if (res.error) {
+		return res.error;
+	}
+	if (ret) {
+		*ret = thread->ret;
+	}
+	free(thread->stack);
+	free(thread);
+	return 0;
+}
+
+void ThreadExit(void* ret) {
+	ThreadSelf()->ret = ret;
+	SyscallExit(0);
+}
+
+/*
+ * newlib의 malloc은 __malloc_lock/__malloc_unlock으로 보호된다 (기본 구현은 아무것도 하지 않음).
+ * 스레드를 만든 적이 없으면 잠그지 않는다. malloc 안에서 다시 호출될 수 있으므로 재진입을 허용한다.
+ */
+struct _reent;
+static struct Mutex malloc_mutex = MUTEX_INITIALIZER;
+static struct Thread* malloc_owner;
+static int malloc_depth;
+
+void __malloc_lock(struct _reent* r) {
+	if (main_thread.self == NULL) {
+		return;
+	}
+	struct Thread* self = ThreadSelf();
+	if (malloc_owner != self) {
+		MutexLock(&malloc_mutex);
+		malloc_owner = self;
+	}
+	++malloc_depth;
+}
+
+void __malloc_unlock(struct _reent* r) {
+	if (main_thread.self == NULL) {
+		return;
+	}
+	if (--malloc_depth == 0) {
+		malloc_owner = NULL;
+		MutexUnlock(&malloc_mutex);
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+#else
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+/*
+ * SyscallThreadCreate/Join 위의 pthread 스타일 스레드 (pthread_create -> ThreadCreate, ...).
+ * 스레드 제어 블록(struct Thread)이 FS base가 되며, 첫 필드가 자기 자신을 가리키므로 %fs:0으로 ThreadSelf를 구한다.
+ * 앱의 main 스레드가 종료하면 커널은 남은 스레드가 모두 종료될 때까지 기다린 뒤 주소 공간을 해제한다.
+ */
+
+#define THREAD_DEFAULT_STACK_SIZE (64 * 1024)
+
+struct Thread {
+	struct Thread* self;	// %fs:0
+	uint64_t id;			// 커널 Task ID
+	void* (*func)(void*);
+	void* arg;
+	void* ret;
+	void* stack;
+};
+
+/**
+ * @brief func(arg)를 실행하는 스레드를 만듭니다
+ * @param stack_size 스레드의 user 스택 크기 (0이면 THREAD_DEFAULT_STACK_SIZE)
+ * @return 성공하면 0, 실패하면 errno 값
+ */
+int ThreadCreate(struct Thread** thread, void* (*func)(void*), void* arg, size_t stack_size);
+/**
+ * @brief thread가 종료될 때까지 기다린 뒤 반환값을 ret에 저장하고 thread의 자원을 해제합니다
+ * @return 성공하면 0, 실패하면 errno 값
+ */
+int ThreadJoin(struct Thread* thread, void** ret);
+/** @brief 현재 스레드를 ret을 반환값으로 종료합니다. main 스레드에서 호출하면 앱이 종료됩니다 */
+void ThreadExit(void* ret);
+struct Thread* ThreadSelf(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,67 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../syscall.h"
+#include "../thread.h"
+#include "../sync.h"
+
+// 스레드와 futex 기반 동기화 객체 확인용: Mutex로 보호된 카운터와 Semaphore ping-pong
+namespace {
+	Mutex counter_lock = MUTEX_INITIALIZER;
+	unsigned long counter = 0;
+	unsigned long iterations = 100000;
+
+	void* CountWorker(void* arg) {
+		for (unsigned long i = 0; i < iterations; i++) {
+			MutexLock(&counter_lock);
+			++counter;
+			MutexUnlock(&counter_lock);
+		}
+		return arg;
+	}
+
+	Semaphore ping = SEMAPHORE_INITIALIZER(0), pong = SEMAPHORE_INITIALIZER(0);
+
+	void* PongWorker(void*) {
+		for (unsigned long i = 0; i < iterations; i++) {
+			SemWait(&ping);
+			SemPost(&pong);
+		}
+		return nullptr;
+	}
+}
+
+extern "C" void main(int argc, char** argv) {
+	const int num_threads = argc > 1 ? atoi(argv[1]) : 4;
+	if (argc > 2) {
+		iterations = atoi(argv[2]);
+	}
+
+	auto start = SyscallGetCurrentTick();
+	Thread* threads[16];
+	const int n = num_threads < 16 ? num_threads : 16;
+	for (int i = 0; i < n; i++) {
+		if (int err = ThreadCreate(&threads[i], CountWorker, reinterpret_cast<void*>(i), 0)) {
+			printf("ThreadCreate: %s\n", strerror(err));
+			exit(1);
+		}
+	}
+	for (int i = 0; i < n; i++) {
+		ThreadJoin(threads[i], nullptr);
+	}
+	auto end = SyscallGetCurrentTick();
+	printf("mutex: %d threads, counter %lu (expected %lu), %lu ms\n",
+		n, counter, n * iterations, (end.tick - start.tick) * 1000 / end.freq);
+
+	start = SyscallGetCurrentTick();
+	Thread* pong_thread;
+	ThreadCreate(&pong_thread, PongWorker, nullptr, 0);
+	for (unsigned long i = 0; i < iterations; i++) {
+		SemPost(&ping);
+		SemWait(&pong);
+	}
+	ThreadJoin(pong_thread, nullptr);
+	end = SyscallGetCurrentTick();
+	printf("semaphore ping-pong: %lu round trips, %lu ms\n", iterations, (end.tick - start.tick) * 1000 / end.freq);
+	exit(0);
+}
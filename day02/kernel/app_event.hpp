@@ -43,6 +43,13 @@ struct AppEvent {
 	} arg;
 };
 
+/* SyscallReadEventTimeout의 flags */
+#define READ_EVENT_COALESCE_MOUSE 1u /* 연속된 MouseMove(버튼 상태가 같은)를 하나로 합친다. dx, dy는 합계, x, y는 마지막 위치 */
+
+/* SyscallReadEventTimeout의 timeout_ms */
+#define READ_EVENT_NO_WAIT       0  /* 기다리지 않고 이미 쌓여있는 이벤트만 반환한다 (없으면 0개) */
+#define READ_EVENT_WAIT_FOREVER (-1) /* 이벤트가 하나 이상 올 때까지 기다린다 (SyscallReadEvent) */
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
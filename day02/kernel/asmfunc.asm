@@ -50,6 +50,11 @@ GetCR0:
 	mov rax, cr0
 	ret
 ; ---------------------------------------------------------------
+global GetCR4			; uint64_t GetCR4(void);
+GetCR4:
+	mov rax, cr4
+	ret
+; ---------------------------------------------------------------
 global LoadIDT			; void LoadIDT(uint16_t limit, uint64_t offset);
 LoadIDT:
 	push rbp
@@ -141,6 +146,34 @@ SetCR0:
 	mov cr0, rdi
 	ret
 ; ---------------------------------------------------------------
+global SetCR4			; void SetCR4(uint64_t x);
+SetCR4:
+	mov cr4, rdi
+	ret
+; ---------------------------------------------------------------
+global ReadCPUID		; void ReadCPUID(uint32_t leaf, uint32_t subleaf, uint32_t* regs);
+ReadCPUID:
+	push rbx
+	mov r8, rdx			; r8 = regs
+	mov eax, edi		; eax = leaf
+	mov ecx, esi		; ecx = subleaf
+	cpuid
+	mov [r8 + 0], eax
+	mov [r8 + 4], ebx
+	mov [r8 + 8], ecx
+	mov [r8 + 12], edx
+	pop rbx
+	ret
+; ---------------------------------------------------------------
+global XSetBV			; void XSetBV(uint32_t xcr, uint64_t value);
+XSetBV:
+	mov ecx, edi		; ecx = xcr
+	mov eax, esi		; edx:eax = value
+	mov rdx, rsi
+	shr rdx, 32
+	xsetbv
+	ret
+; ---------------------------------------------------------------
 global SwitchContext		; void SwitchContext(void* next_ctx, void* cur_ctx);
 global RestoreContext		; void RestoreContext(void* next_ctx);
 SwitchContext:
@@ -185,7 +218,7 @@ SwitchContext:
 	mov dx, gs
 	mov [rsi + 0x38], rdx
 
-	fxsave [rsi + 0xc0]
+	; FPU state is saved lazily (IntHandlerNM)
 RestoreContext:
 	; iret stack frame
 	push qword [rdi + 0x28]	; restore ss
@@ -194,15 +227,10 @@ RestoreContext:
 	push qword [rdi + 0x20]	; restore cs
 	push qword [rdi + 0x08]	; restore rip
 
-	; restore next context
-	fxrstor [rdi + 0xc0]
-	
+	; restore next context (FPU state is restored lazily by IntHandlerNM)
 	mov rax, [rdi + 0x00]
 	mov cr3, rax
-	mov rax, [rdi + 0x30]
-	mov fs, ax
-	mov rax, [rdi + 0x38]
-	mov gs, ax
+	; fs/gs 셀렉터는 항상 0이므로 다시 로드하지 않는다 (셀렉터를 로드하면 MSR로 설정한 FS base가 지워진다)
 
 	mov rax, [rdi + 0x40]
 	mov rbx, [rdi + 0x48]
@@ -225,15 +253,47 @@ RestoreContext:
 
 	o64 iret				; restore ss, rsp, rflags, cs, rip at once
 ; ---------------------------------------------------------------
-extern LAPICTimerOnInterrupt
-global IntHandlerLAPICTimer	; void IntHandlerLAPICTimer(InterruptFrame* frame);
-IntHandlerLAPICTimer:
+extern fpu_owner			; TaskContext* (owner of the FPU registers)
+extern fpu_save_mode		; int (0: fxsave, 1: xsave, 2: xsaveopt)
+global SaveFPUState			; void SaveFPUState(void* area);	(clobbers rax, rdx only)
+SaveFPUState:
+	mov eax, 0xffffffff		; edx:eax = every component enabled in XCR0
+	mov edx, eax
+	cmp dword [fpu_save_mode], 1
+	jb .fxsave
+	je .xsave
+	xsaveopt [rdi]			; skips components that are unmodified since the last xrstor
+	ret
+.xsave:
+	xsave [rdi]
+	ret
+.fxsave:
+	fxsave [rdi]
+	ret
+global RestoreFPUState		; void RestoreFPUState(const void* area);	(clobbers rax, rdx only)
+RestoreFPUState:
+	mov eax, 0xffffffff
+	mov edx, eax
+	cmp dword [fpu_save_mode], 0
+	je .fxrstor
+	xrstor [rdi]
+	ret
+.fxrstor:
+	fxrstor [rdi]
+	ret
+; ---------------------------------------------------------------
+; 인터럽트된 콘텍스트를 스택에 TaskContext 형태로 만든 뒤 %2(const TaskContext&)를 호출한다.
+; %2에서 TaskManager::SwitchTask를 호출하면 돌아오지 않고 다른 Task로 전환된다.
+; FPU 레지스터는 CR0.TS가 꺼져 있을 때(현재 Task가 fpu_owner일 때)만 현재 Task의 fpu_area에 저장하며, 이 경우 reserved = 1이 된다.
+%macro define_context_int_handler 2
+extern %2
+global %1
+%1:
 	push rbp
 	mov rbp, rsp
 
 	; create TaskContext Structure in the stack frame
-	sub rsp, 512
-	fxsave [rsp]
+	sub rsp, 16				; fpu_area (unused) + padding for 16-byte alignment
 	push r15
 	push r14
 	push r13
@@ -267,9 +327,37 @@ IntHandlerLAPICTimer:
 	push qword [rbp + 0x08] ; rip (from interrupt frame)
 	push rcx				; cr3
 
+	mov rax, cr0
+	test al, 8				; CR0.TS
+	jnz %%call_handler
+	mov rdi, [fpu_owner]	; FPU registers are live; the handler may clobber them
+	test rdi, rdi			; no owner yet (interrupts before InitTask)
+	jz %%call_handler
+	mov rdi, [rdi + 0xc0]	; fpu_owner->fpu_area
+	call SaveFPUState
+	mov qword [rsp + 0x18], 1	; reserved = FPU state saved
+
+%%call_handler:
 	mov rdi, rsp			; arg1 = TaskContext that was just created on the stack
-	call LAPICTimerOnInterrupt
-	
+	call %2
+
+	test qword [rsp + 0x18], 1
+	jz %%fpu_lazy
+	mov rdi, [fpu_owner]
+	test rdi, rdi
+	jz %%restore_regs
+	mov rdi, [rdi + 0xc0]
+	call RestoreFPUState
+	jmp %%restore_regs
+%%fpu_lazy:
+	mov rax, cr0			; if the handler took the FPU through #NM, its registers are now clobbered
+	test al, 8
+	jnz %%restore_regs
+	or rax, 8				; set CR0.TS and drop ownership (the saved area is still valid)
+	mov cr0, rax
+	mov qword [fpu_owner], 0
+
+%%restore_regs:
 	add rsp, 0x40			; ignore cr3 ~ gs
 	pop rax
 	pop rbx
@@ -286,11 +374,41 @@ IntHandlerLAPICTimer:
 	pop r13
 	pop r14
 	pop r15
-	fxrstor [rsp]
 
 	mov rsp, rbp
 	pop rbp
 	iretq
+%endmacro
+
+define_context_int_handler IntHandlerLAPICTimer, LAPICTimerOnInterrupt	; void IntHandlerLAPICTimer(InterruptFrame* frame);
+define_context_int_handler IntHandlerXHCI, XHCIOnInterrupt				; void IntHandlerXHCI(InterruptFrame* frame);
+; ---------------------------------------------------------------
+extern fpu_trap_count
+extern GetCurrentTaskContext
+global IntHandlerNM			; void IntHandlerNM(InterruptFrame* frame);
+IntHandlerNM:				; #NM (device not available): first FPU/SSE use after CR0.TS was set
+	push rax
+	push rdx
+	push rdi				; (16-byte aligned after this push)
+	clts
+	inc qword [fpu_trap_count]
+
+	mov rdi, [fpu_owner]
+	test rdi, rdi
+	jz .load
+	mov rdi, [rdi + 0xc0]	; save the previous owner's state
+	call SaveFPUState
+
+.load:
+	call GetCurrentTaskContext	; no caller-saved registers (except rax)
+	mov [fpu_owner], rax
+	mov rdi, [rax + 0xc0]
+	call RestoreFPUState
+
+	pop rdi
+	pop rdx
+	pop rax
+	iretq
 ; ---------------------------------------------------------------
 global WriteMSR	; void WriteMSR(uint32_t msr, uint64_t value);
 WriteMSR:
@@ -301,6 +419,12 @@ WriteMSR:
 	wrmsr
 	ret
 ; ---------------------------------------------------------------
+; per_cpu.hpp의 struct PerCPU
+%define PERCPU_KERNEL_STACK 0x10
+%define PERCPU_USER_RSP 0x18
+
+extern tss
+extern per_cpu
 global CallApp				; int CallApp(int argc, char** argv, uint16_t ss, uint64_t rip, uint64_t rsp, uint64_t* os_stack_ptr);
 CallApp:
 	push rbx
@@ -310,6 +434,8 @@ CallApp:
 	push r14
 	push r15
 	mov [r9], rsp			; backup os stack
+	mov [tss + 4], rsp		; rsp0: user mode 인터럽트도 os stack 아래를 사용한다
+	mov [per_cpu + PERCPU_KERNEL_STACK], rsp	; 시스템콜도 os stack 아래를 사용한다
 
 	push rbp
 	mov rbp, rsp
@@ -320,36 +446,41 @@ CallApp:
 	push rcx				; RIP
 	o64 retf
 ; ---------------------------------------------------------------
-extern GetCurrentTaskOSStackPointer
+extern OnSyscallEntry
+extern OnSyscallExit
 extern syscall_table
+extern syscall_trace_enabled
+extern SyscallTraceEnd
 global SyscallEntry		; void SyscallEntry(void);
-SyscallEntry:
+SyscallEntry:					; IA32_FMASK에 의해 인터럽트 금지 상태로 진입한다
+	swapgs						; GS base = per_cpu
+	mov [gs:PERCPU_USER_RSP], rsp
+	mov rsp, [gs:PERCPU_KERNEL_STACK]
+	push qword [gs:PERCPU_USER_RSP]
+	swapgs						; 인터럽트 핸들러는 swapgs하지 않으므로 인터럽트를 허용하기 전에 되돌린다
+
 	push rbp
 	push rcx
 	push r11
-
 	push rax					; backup syscall index
 	mov rcx, r10
 	and eax, 0x7fffffff			; change syscall index 0x8000'0000 ~ -> 0x0000'0000 ~
-	mov rbp, rsp
+	mov rbp, rsp				; [rbp] = index, r11, rcx, rbp, user rsp
 
 	and rsp, 0xfffffffffffffff0	; stack alignment
-	push rax
-	push rdx
-	cli
-	call GetCurrentTaskOSStackPointer		; no callee-saved registers (except rax & rdx)
+	call OnSyscallEntry			; no caller-saved registers
 	sti
-	mov rdx, [rsp + 0]			; rdx
-	mov [rax - 16], rdx
-	mov rdx, [rsp + 8]			; rax
-	mov [rax - 8], rdx
 
-	lea rsp, [rax - 16]
+	cmp byte [syscall_trace_enabled], 0
+	jne .traced
+	call [syscall_table + 8 * eax]
+
+.return:
+	push rax					; backup return value
+	push rdx
+	call OnSyscallExit			; switch to a higher level task woken during the syscall
 	pop rdx
 	pop rax
-	and rsp, 0xfffffffffffffff0	; stack alignment
-
-	call [syscall_table + 8 * eax]
 
 	mov rsp, rbp				; recover rsp
 	pop rsi						; recover syscall index
@@ -358,6 +489,8 @@ SyscallEntry:
 	pop r11
 	pop rcx
 	pop rbp
+	cli							; user 스택으로 바꾼 뒤에는 sysret까지 인터럽트를 받으면 안 된다
+	mov rsp, [rsp]				; recover user rsp
 	o64 sysret
 .exit:
 	mov rsp, rax				; recover os stack
@@ -371,6 +504,29 @@ SyscallEntry:
 	pop rbx
 
 	ret				; jump after call app
+.traced:						; 시스템콜 통계/추적 (syscall_trace.hpp)
+	push r9						; SyscallFork가 사용하므로 rbp와 callee-saved 레지스터는 건드리지 않는다
+	push r8
+	push rcx
+	push rdx
+	push rsi
+	push rdi
+	push rax					; syscall index
+	rdtsc
+	shl rdx, 32
+	or rax, rdx
+	push rax					; [rsp] = SyscallTraceFrame{start_tsc, index, args[6]}
+	mov eax, [rsp + 8]
+	mov rdx, [rsp + 32]
+	call [syscall_table + 8 * eax]
+	push rax
+	push rdx
+	lea rdi, [rsp + 16]			; const SyscallTraceFrame*
+	mov rsi, rax				; value
+	call SyscallTraceEnd		; (frame, value, error = edx)
+	pop rdx
+	pop rax
+	jmp .return
 global ExitApp					; void ExitApp(uint64_t rsp, int32_t ret_val);
 ExitApp:
 	mov rsp, rdi
@@ -385,7 +541,125 @@ ExitApp:
 
 	ret				; jump after call app
 ; ---------------------------------------------------------------
+extern DoFork
+global SyscallFork				; syscall::Result SyscallFork(...);	(syscall_table에서 SyscallEntry가 호출)
+SyscallFork:
+	push rbp					; SyscallEntry가 만든 프레임 (syscall index, r11, rcx, user rbp, user rsp)
+	push r15					; callee-saved 레지스터는 아직 user 값이다
+	push r14
+	push r13
+	push r12
+	push rbx
+	mov rdi, rsp				; const ForkFrame*
+	sub rsp, 8					; stack alignment
+	call DoFork
+	add rsp, 8 + 48				; DoFork가 callee-saved 레지스터를 보존하므로 다시 pop할 필요가 없다
+	ret
+; ---------------------------------------------------------------
+global ResumeApp				; int ResumeApp(const uint64_t* regs, uint64_t* os_stack_ptr);
+ResumeApp:
+	push rbx					; CallApp과 같은 순서로 저장해야 Exit 시스템콜이 여기로 돌아온다
+	push rbp
+	push r12
+	push r13
+	push r14
+	push r15
+	mov [rsi], rsp			; backup os stack
+	mov [tss + 4], rsp		; rsp0
+	mov [per_cpu + PERCPU_KERNEL_STACK], rsp
+
+	push 3 << 3 | 3			; SS
+	push qword [rdi + 16]	; RSP
+	push qword [rdi + 8]	; RFLAGS
+	push 4 << 3 | 3			; CS
+	push qword [rdi + 0]	; RIP
+	mov rbx, [rdi + 24]
+	mov rbp, [rdi + 32]
+	mov r12, [rdi + 40]
+	mov r13, [rdi + 48]
+	mov r14, [rdi + 56]
+	mov r15, [rdi + 64]
+	xor eax, eax			; fork의 반환값 {0, 0}
+	xor edx, edx
+	xor ecx, ecx
+	xor esi, esi
+	xor edi, edi
+	xor r8d, r8d
+	xor r9d, r9d
+	xor r10d, r10d
+	xor r11d, r11d
+	o64 iret
+; ---------------------------------------------------------------
 global InvalidateTLB			; void InvalidateTLB(uint64_t addr);
 InvalidateTLB:
 	invlpg [rdi]
-	ret
\ No newline at end of file
+	ret
+; ---------------------------------------------------------------
+global ReadTSC					; uint64_t ReadTSC(void);
+ReadTSC:
+	rdtsc					; edx:eax = time stamp counter
+	shl rdx, 32
+	or rax, rdx
+	ret
+; ---------------------------------------------------------------
+; user 메모리 접근 (uaccess.hpp). 아래 루틴의 .fault_ip 명령어에서 처리할 수 없는 page fault가 나면
+; IntHandlerPF가 ex_table에서 fixup 주소를 찾아 그 곳으로 돌아간다
+global CopyUserBytes			; size_t CopyUserBytes(void* dst, const void* src, size_t len);	(복사하지 못한 바이트 수)
+CopyUserBytes:
+	mov rcx, rdx
+.fault_ip:
+	rep movsb				; fault가 나면 rcx에 남은 바이트 수가 들어있다
+.fixup:
+	mov rax, rcx
+	ret
+; ---------------------------------------------------------------
+global StrncpyFromUserBytes		; int64_t StrncpyFromUserBytes(char* dst, const char* src, size_t n);	(문자열 길이, NUL이 없으면 n, 실패하면 -1)
+StrncpyFromUserBytes:
+	xor eax, eax
+.loop:
+	cmp rax, rdx
+	je .done
+.fault_ip:
+	mov cl, [rsi + rax]
+	mov [rdi + rax], cl
+	test cl, cl
+	jz .done
+	inc rax
+	jmp .loop
+.done:
+	ret
+.fixup:
+	mov rax, -1
+	ret
+; ---------------------------------------------------------------
+global LoadUser32				; int LoadUser32(const uint32_t* src, uint32_t* dst);	(성공하면 0, 실패하면 -1)
+LoadUser32:
+.fault_ip:
+	mov eax, [rdi]			; 정렬된 4바이트 접근이므로 원자적이다
+	mov [rsi], eax
+	xor eax, eax
+	ret
+.fixup:
+	mov eax, -1
+	ret
+; ---------------------------------------------------------------
+global StoreUser32				; int StoreUser32(uint32_t* dst, uint32_t value);	(성공하면 0, 실패하면 -1)
+StoreUser32:
+.fault_ip:
+	mov [rdi], esi
+	xor eax, eax
+	ret
+.fixup:
+	mov eax, -1
+	ret
+; ---------------------------------------------------------------
+section .rodata
+align 8
+global ex_table					; {fault_ip, fixup}[] (uaccess.cpp)
+global ex_table_end
+ex_table:
+	dq CopyUserBytes.fault_ip, CopyUserBytes.fixup
+	dq StrncpyFromUserBytes.fault_ip, StrncpyFromUserBytes.fixup
+	dq LoadUser32.fault_ip, LoadUser32.fixup
+	dq StoreUser32.fault_ip, StoreUser32.fixup
+ex_table_end:
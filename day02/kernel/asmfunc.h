@@ -2,10 +2,12 @@
 
 #ifdef __cplusplus
 #include <cstdint>
+#include <cstddef>
 #define EXTERN_C_BEG extern "C" {
 #define EXTERN_C_END }
 #elif
 #include <stdint.h>
+#include <stddef.h>
 #define EXTERN_C_BEG
 #define EXTERN_C_END
 #endif
@@ -21,6 +23,7 @@ uint16_t GetCS(void); // reads code segment register value
 uint64_t GetCR3(void);
 uint64_t GetCR2(void);
 uint64_t GetCR0(void);
+uint64_t GetCR4(void);
 void LoadIDT(uint16_t limit, uint64_t offset);
 void LoadGDT(uint16_t limit, uint64_t offset);
 void LoadTR(uint16_t sel);
@@ -32,6 +35,7 @@ void SetSS(uint16_t x);
 void SetCS(uint16_t x);
 void SetCR3(uint64_t x);
 void SetCR0(uint64_t x);
+void SetCR4(uint64_t x);
 void SetSegRegs(uint16_t ss, uint16_t cs);
 
 /**
@@ -53,6 +57,13 @@ void RestoreContext(void* next_ctx);
  * @param os_stack_ptr OS 스택 포인터가 저장될 위치
  */
 int CallApp(int argc, char** argv, uint16_t ss, uint64_t rip, uint64_t rsp, uint64_t* os_stack_ptr);
+/**
+ * @brief fork된 자식 Task에서 부모가 시스템콜을 호출한 직후의 user mode로 돌아갑니다. 자식에서 fork는 {0, 0}을 반환합니다.
+ * CallApp처럼 Exit 시스템콜이 호출되면 종료 코드를 반환합니다.
+ * @param regs rip, rflags, rsp, rbx, rbp, r12, r13, r14, r15 순서로 저장된 user 레지스터
+ * @param os_stack_ptr OS 스택 포인터가 저장될 위치
+ */
+int ResumeApp(const uint64_t* regs, uint64_t* os_stack_ptr);
 
 // from: https://sites.uclouvain.be/SystInfo/usr/include/asm/msr-index.h.html
 #define kIA32_EFER  0xC0000080 // Extended Feature Enable Register
@@ -60,9 +71,22 @@ int CallApp(int argc, char** argv, uint16_t ss, uint64_t rip, uint64_t rsp, uint
 #define kIA32_LSTAR 0xc0000082 // Long mode SYSCALL TARget
 #define kIA32_CSTAR 0xc0000083 // Compat mode SYSCALL TARget
 #define kIA32_FMASK 0xc0000084 // EFLAGS mask for syscall
+#define kIA32_FS_BASE 0xc0000100 // FS segment base (user mode TLS)
+#define kIA32_KERNEL_GS_BASE 0xc0000102 // swapgs로 GS base와 교환되는 값 (per_cpu.hpp)
+#define kRFlagsIF 0x200 // interrupt enable flag
 
 void WriteMSR(uint32_t msr, uint64_t value);
 void SyscallEntry(void);
 void ExitApp(uint64_t rsp, int32_t ret_val);
 void InvalidateTLB(uint64_t addr);
+uint64_t ReadTSC(void); // reads time stamp counter
+void ReadCPUID(uint32_t leaf, uint32_t subleaf, uint32_t* regs); // regs[0..3] = eax, ebx, ecx, edx
+void XSetBV(uint32_t xcr, uint64_t value); // writes extended control register
+void SaveFPUState(void* area); // fxsave/xsave/xsaveopt depending on fpu_save_mode (fpu.hpp)
+void RestoreFPUState(const void* area);
+// user 메모리 접근 루틴. 직접 호출하지 말고 uaccess.hpp의 함수를 사용한다
+size_t CopyUserBytes(void* dst, const void* src, size_t len); // 복사하지 못한 바이트 수를 반환
+int64_t StrncpyFromUserBytes(char* dst, const char* src, size_t n); // 문자열 길이 (NUL이 없으면 n, 실패하면 -1)
+int LoadUser32(const uint32_t* src, uint32_t* dst); // 성공하면 0, 실패하면 -1
+int StoreUser32(uint32_t* dst, uint32_t value);
 EXTERN_C_END
@@ -33,6 +33,9 @@ public:
 		kIsDirectory,
 		kNoSuchEntry,
 		kFreeTypeError,
+		kTryAgain,
+		kBadAddress,
+		kInterrupted,
 		kLastOfCode,
 	};
 private:
@@ -64,6 +67,9 @@ private:
 		"kIsDirectory",
 		"kNoSuchEntry",
 		"kFreeTypeError",
+		"kTryAgain",
+		"kBadAddress",
+		"kInterrupted",
 	};
 	static_assert(kLastOfCode == code_str.size());
 
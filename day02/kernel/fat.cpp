@@ -11,7 +11,9 @@ namespace fat {
 	unsigned long DirectoryEntry::per_cluster;
 
 	namespace {
+		constexpr unsigned long kMaxVolumeBytes = 32 * 1024 * 1024; // 로더(UefiLoader.c)가 블록 장치에서 읽어오는 최대 크기
 		unsigned long clus2_begin_sector;
+		unsigned long cluster_end; // 유효한 클러스터 번호는 [2, cluster_end)
 	}
 
 	void Initialize(void* volume_image) {
@@ -22,6 +24,16 @@ namespace fat {
 		clus2_begin_sector
 			= static_cast<unsigned long>(boot_volume_image->bpb_RsvdSecCnt)
 			+ static_cast<unsigned long>(boot_volume_image->bpb_NumFATs) * boot_volume_image->bpb_FATSz32;	
+
+		// 메모리에 올라온 데이터 영역의 클러스터 수와 FAT 항목 수 중 작은 쪽까지만 할당한다
+		const unsigned long loaded_sectors = std::min<unsigned long>(
+			boot_volume_image->bpb_TotSec32, kMaxVolumeBytes / boot_volume_image->bpb_BytesPerSec);
+		const unsigned long data_clusters = loaded_sectors > clus2_begin_sector
+			? (loaded_sectors - clus2_begin_sector) / boot_volume_image->bpb_SecPerClus
+			: 0;
+		const unsigned long fat_entries
+			= static_cast<unsigned long>(boot_volume_image->bpb_FATSz32) * boot_volume_image->bpb_BytesPerSec / sizeof(uint32_t);
+		cluster_end = std::min(data_clusters + 2, fat_entries);
 	}
 
 	uintptr_t GetClusterAddr(unsigned long cluster_num) {
@@ -237,43 +249,59 @@ namespace fat {
 		return p - buf_uint8;
 	}
 
+	namespace {
+		// 비어 있는 클러스터 번호. 볼륨이 가득 찼으면 0
+		unsigned long FindFreeCluster() {
+			uint32_t* fat = GetFAT();
+			for (unsigned long cand = 2; cand < cluster_end; cand++) {
+				if (fat[cand] == 0) {
+					return cand;
+				}
+			}
+			return 0;
+		}
+	}
+
+	// 체인 끝에 클러스터 count개를 붙이고 마지막 클러스터를 반환한다.
+	// 볼륨이 가득 차면 붙일 수 있는 만큼만 붙이고 0을 반환한다
 	unsigned long ExtendCluster(unsigned long eoc_cluster, size_t count) {
 		uint32_t* fat = GetFAT();
-		while (IsEndOfClusterchain(fat[eoc_cluster])) {
+		while (!IsEndOfClusterchain(fat[eoc_cluster])) {
 			eoc_cluster = fat[eoc_cluster];
 		}
 
-		size_t num_allocated = 0;
 		auto cur_clus = eoc_cluster;
-
-		for (unsigned long cand = 2; num_allocated < count; cand++) {
-			if (fat[cand] != 0) {
-				continue;
+		for (size_t num_allocated = 0; num_allocated < count; num_allocated++) {
+			const auto cand = FindFreeCluster();
+			if (cand == 0) {
+				return 0;
 			}
-
 			fat[cur_clus] = cand;
+			fat[cand] = kEndOfClusterchain;
 			cur_clus = cand;
-			++num_allocated;
 		}
-		fat[cur_clus] = kEndOfClusterchain;
 		return cur_clus;
 	}
 
 	// create new entry in dir_cluster
 	DirectoryEntry* AllocateEntry(unsigned long dir_cluster) {
 		DirectoryEntryPointer entry_ptr = { dir_cluster, 0 };
+		unsigned long last_cluster = dir_cluster;
 		while (true) {
 			auto entry = entry_ptr.get();
 			if (entry->dir_Name[0] == 0 || entry->dir_Name[0] == 0xe5) { // empty entry
 				return entry;
 			}
 
-			auto next_ptr = ++entry_ptr;
-			if (next_ptr.IsEndOfClusterchain()) break;
-			entry_ptr = next_ptr;
+			last_cluster = entry_ptr.cluster;
+			++entry_ptr;
+			if (entry_ptr.IsEndOfClusterchain()) break;
 		}
 
-		dir_cluster = ExtendCluster(entry_ptr.cluster, 1);
+		dir_cluster = ExtendCluster(last_cluster, 1);
+		if (dir_cluster == 0) {
+			return nullptr;
+		}
 		auto dir = GetSectorByCluster<DirectoryEntry>(dir_cluster);
 		memset(dir, 0, bytes_per_cluster);
 		return dir;
@@ -288,39 +316,20 @@ namespace fat {
 	}
 	
 	size_t FileDescriptor::Read(void* buf, size_t len) {
-		if (rd_cluster == 0) {
-			rd_cluster = GetFirstCluster(&fat_entry);
-		}
-		auto buf8 = reinterpret_cast<uint8_t*>(buf);
-		// sanity check
-		len = std::min(len, fat_entry.dir_FileSize - rd_offset);
-
-		size_t total = 0;
-		while (total < len) {
-			auto sec = GetSectorByCluster<uint8_t>(rd_cluster);
-			size_t n = std::min(len - total, bytes_per_cluster - rd_cluster_offset);
-			memcpy(buf8 + total, sec + rd_cluster_offset, n);
-			total += n;
-			rd_cluster_offset += n;
-			if (rd_cluster_offset == bytes_per_cluster) {
-				rd_cluster = NextCluster(rd_cluster);
-				rd_cluster_offset = 0;
-			}
-		}
-		rd_offset += total;
-		return total;
+		const size_t n = Load(buf, len, offset);
+		offset += n;
+		return n;
 	}
 
+	// 클러스터 num_clusters개짜리 체인을 만들고 첫 클러스터를 반환한다. 하나도 할당하지 못하면 0.
+	// 볼륨이 가득 차면 체인이 num_clusters개보다 짧을 수 있다
 	unsigned long AllocateClusterchain(size_t num_clusters) {
 		uint32_t* fat = GetFAT();
-		unsigned long first_cluster = 2;
-		while (true) {
-			if (fat[first_cluster] == 0) {
-				fat[first_cluster] = kEndOfClusterchain;
-				break;
-			}
-			first_cluster++;
+		const auto first_cluster = FindFreeCluster();
+		if (first_cluster == 0) {
+			return 0;
 		}
+		fat[first_cluster] = kEndOfClusterchain;
 
 		if (num_clusters > 1) {
 			ExtendCluster(first_cluster, num_clusters - 1);
@@ -329,65 +338,117 @@ namespace fat {
 	}
 
 	size_t FileDescriptor::Write(const void* buf, size_t len) {
-		auto required_clusters = [](size_t bytes) {
-			return (bytes + bytes_per_cluster - 1) / bytes_per_cluster;
-		};
+		const size_t n = Store(buf, len, offset);
+		offset += n;
+		return n;
+	}
+
+	size_t FileDescriptor::Size() const {
+		return fat_entry.dir_FileSize;
+	}
+
+	unsigned long FileDescriptor::ClusterAt(size_t offset, bool extend) {
+		const size_t index = offset / bytes_per_cluster;
+		if (GetFirstCluster(&fat_entry) == 0) { // 아직 클러스터가 없는 새 파일
+			if (!extend) {
+				return 0;
+			}
+			const auto first_cluster = AllocateClusterchain(index + 1);
+			if (first_cluster == 0) {
+				return 0;
+			}
+			fat_entry.dir_FstClusLO = first_cluster & 0xffff;
+			fat_entry.dir_FstClusHI = (first_cluster >> 16) & 0xffff;
+		}
 
-		// get valid cluster
-		if (wr_cluster == 0) {
-			if (GetFirstCluster(&fat_entry) != 0) { // existing file entry
-				wr_cluster = GetFirstCluster(&fat_entry);
-			} else { // new entry
-				wr_cluster = AllocateClusterchain(required_clusters(len));
-				fat_entry.dir_FstClusLO = wr_cluster & 0xffff;
-				fat_entry.dir_FstClusHI = (wr_cluster >> 16) & 0xffff;
+		if (cached_cluster == 0 || index < cached_index) {
+			cached_cluster = GetFirstCluster(&fat_entry);
+			cached_index = 0;
+		}
+		while (cached_index < index) {
+			auto next = NextCluster(cached_cluster);
+			if (next == kEndOfClusterchain) {
+				if (!extend) {
+					return 0;
+				}
+				// 볼륨이 가득 차면 일부만 붙었을 수 있으므로 붙은 만큼은 따라간다
+				ExtendCluster(cached_cluster, index - cached_index);
+				next = NextCluster(cached_cluster);
+				if (next == kEndOfClusterchain) {
+					return 0;
+				}
 			}
+			cached_cluster = next;
+			++cached_index;
 		}
+		return cached_cluster;
+	}
 
-		const uint8_t* buf8 = reinterpret_cast<const uint8_t*>(buf);
+	size_t FileDescriptor::Load(void* buf, size_t len, size_t offset) {
+		const size_t file_size = fat_entry.dir_FileSize;
+		if (offset >= file_size) {
+			return 0;
+		}
+		len = std::min(len, file_size - offset);
 
+		auto buf8 = reinterpret_cast<uint8_t*>(buf);
 		size_t total = 0;
 		while (total < len) {
-			if (wr_cluster_offset == bytes_per_cluster) { // end of cluster chunk (go to next cluster)
-				const auto next_cluster = NextCluster(wr_cluster);
-				if (next_cluster == kEndOfClusterchain) {
-					wr_cluster = ExtendCluster(wr_cluster, required_clusters(len - total));
-				} else {
-					wr_cluster = next_cluster;
-				}
-				wr_cluster_offset = 0;
+			const size_t pos = offset + total;
+			const auto cluster = ClusterAt(pos, false);
+			if (cluster == 0) {
+				break;
 			}
-
-			auto sec = GetSectorByCluster<uint8_t>(wr_cluster);
-			size_t n = std::min(len, bytes_per_cluster - wr_cluster_offset);
-			memcpy(sec + wr_cluster_offset, buf8, n);
+			const size_t cluster_offset = pos % bytes_per_cluster;
+			const size_t n = std::min(len - total, bytes_per_cluster - cluster_offset);
+			memcpy(buf8 + total, GetSectorByCluster<uint8_t>(cluster) + cluster_offset, n);
 			total += n;
-			wr_cluster_offset += n;
 		}
-		
-		wr_offset += total;
-		fat_entry.dir_FileSize = wr_offset;
-
 		return total;
 	}
 
-	size_t FileDescriptor::Size() const {
-		return fat_entry.dir_FileSize;
+	size_t FileDescriptor::CopyToClusters(const uint8_t* src, size_t len, size_t offset) {
+		size_t total = 0;
+		while (total < len) {
+			const size_t pos = offset + total;
+			const size_t cluster_offset = pos % bytes_per_cluster;
+			const size_t n = std::min(len - total, bytes_per_cluster - cluster_offset);
+			const auto cluster = ClusterAt(pos, true);
+			if (cluster == 0) { // 볼륨이 가득 찼다
+				break;
+			}
+			uint8_t* dst = GetSectorByCluster<uint8_t>(cluster) + cluster_offset;
+			if (src) {
+				memcpy(dst, src + total, n);
+			} else {
+				memset(dst, 0, n);
+			}
+			total += n;
+		}
+		return total;
 	}
 
-	size_t FileDescriptor::Load(void* buf, size_t len, size_t offset) {
-		FileDescriptor fd{fat_entry};
-		fd.rd_offset = offset;
-
-		unsigned long cluster = GetFirstCluster(&fat_entry);
-		while (offset >= bytes_per_cluster) {
-			offset -= bytes_per_cluster;
-			cluster = NextCluster(cluster);
+	size_t FileDescriptor::Store(const void* buf, size_t len, size_t offset) {
+		if (len == 0) {
+			return 0;
+		}
+		// 파일 크기는 dir_FileSize(uint32_t)에 들어가야 한다
+		if (offset > kMaxFileBytes || len > kMaxFileBytes - offset) {
+			return 0;
+		}
+		// 파일 끝을 넘어서 쓰면 그 사이는 0으로 채운다
+		const size_t file_size = fat_entry.dir_FileSize;
+		if (offset > file_size) {
+			const size_t filled = CopyToClusters(nullptr, offset - file_size, file_size);
+			if (filled < offset - file_size) {
+				fat_entry.dir_FileSize = file_size + filled;
+				return 0;
+			}
 		}
 
-		fd.rd_cluster = cluster;
-		fd.rd_cluster_offset = offset;
-		return fd.Read(buf, len);
+		const size_t n = CopyToClusters(reinterpret_cast<const uint8_t*>(buf), len, offset);
+		fat_entry.dir_FileSize = std::max(file_size, offset + n);
+		return n;
 	}
 
 	WithError<DirectoryEntry*> CreateFile(const char* path) {
@@ -79,6 +79,7 @@ namespace fat {
 
 	constexpr auto GetFirstCluster(const DirectoryEntry* file_entry) { return (static_cast<uint32_t>(file_entry->dir_FstClusHI) << 16) | file_entry->dir_FstClusLO; }
 	constexpr unsigned long kEndOfClusterchain = 0x0fffffff;
+	constexpr size_t kMaxFileBytes = UINT32_MAX; // dir_FileSize로 나타낼 수 있는 최대 파일 크기
 
 	void Initialize(void* volume_image);
 	uintptr_t GetClusterAddr(unsigned long cluster_num);
@@ -129,14 +130,25 @@ namespace fat {
 		size_t Write(const void* buf, size_t len) override;
 		size_t Size() const override;
 		size_t Load(void* buf, size_t len, size_t offset) override;
+		bool Seekable() const override { return true; }
+		size_t Store(const void* buf, size_t len, size_t offset) override;
+		size_t Offset() const override { return offset; }
+		void SetOffset(size_t offset) override { this->offset = offset; }
 	private:
+		/**
+		 * @brief 파일의 offset 바이트가 들어있는 클러스터를 반환합니다
+		 * @param extend true면 모자란 클러스터를 할당하고, false면 클러스터 체인을 벗어날 때 0을 반환합니다.
+		 * 할당하다가 볼륨이 가득 차도 0을 반환합니다
+		 */
+		unsigned long ClusterAt(size_t offset, bool extend);
+		// src가 nullptr이면 0으로 채운다. 볼륨이 가득 차면 거기서 멈추고 쓴 바이트 수를 반환한다
+		size_t CopyToClusters(const uint8_t* src, size_t len, size_t offset);
+
 		DirectoryEntry& fat_entry;
-		size_t rd_offset = 0;
-		unsigned long rd_cluster = 0;
-		size_t rd_cluster_offset = 0;
-		size_t wr_offset = 0;
-		unsigned long wr_cluster = 0;
-		size_t wr_cluster_offset = 0;
+		size_t offset = 0; // Read/Write가 공유하는 파일 위치
+		// 마지막으로 찾은 클러스터. 순차 접근은 클러스터 체인을 처음부터 따라가지 않는다
+		unsigned long cached_cluster = 0;
+		size_t cached_index = 0;
 	};
 
 	void ReadName(const DirectoryEntry* entry, char* basename9, char* ext4);
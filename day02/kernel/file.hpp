@@ -8,6 +8,14 @@ public:
 	virtual size_t Write(const void* buf, size_t len) = 0;
 	virtual size_t Size() const = 0;
 	virtual size_t Load(void* buf, size_t len, size_t offset) = 0;
+
+	// 파일 위치가 있는 디스크립터(FAT 파일)만 아래 함수를 지원한다. 터미널과 파이프는 Seekable()이 false
+	virtual bool Seekable() const { return false; }
+	/** @brief offset 위치에 len 바이트를 씁니다. Load처럼 파일 위치는 바뀌지 않습니다 */
+	virtual size_t Store(const void* buf, size_t len, size_t offset) { return 0; }
+	/** @brief Read/Write가 다음에 사용할 파일 위치 */
+	virtual size_t Offset() const { return 0; }
+	virtual void SetOffset(size_t offset) {}
 };
 
 size_t ReadDelim(FileDescriptor& fd, char delim, char* dst, size_t len);
\ No newline at end of file
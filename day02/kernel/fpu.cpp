@@ -0,0 +1,60 @@
+#include "fpu.hpp"
+#include "asmfunc.h"
+#include "logger.hpp"
+#include <cstring>
+
+extern "C" int fpu_save_mode = kFPUSaveFXSave;
+size_t fpu_area_size = 512;
+uint64_t fpu_xcr0 = 0;
+
+namespace {
+	constexpr uint32_t kCPUIDXSave = 1u << 26;		// CPUID.01H:ECX
+	constexpr uint32_t kCPUIDAVX = 1u << 28;		// CPUID.01H:ECX
+	constexpr uint32_t kCPUIDXSaveOpt = 1u << 0;	// CPUID.(EAX=0DH,ECX=1):EAX
+	constexpr uint64_t kCR4OSXSave = 1u << 18;
+
+	constexpr uint64_t kXCR0X87 = 1u << 0;
+	constexpr uint64_t kXCR0SSE = 1u << 1;
+	constexpr uint64_t kXCR0AVX = 1u << 2;
+	constexpr uint64_t kXCR0AVX512 = 0b111u << 5; // opmask, ZMM_Hi256, Hi16_ZMM (함께 활성화해야 함)
+}
+
+void InitializeFPU() {
+	uint32_t regs[4];
+	ReadCPUID(1, 0, regs);
+	const uint32_t features = regs[2];
+	if (!(features & kCPUIDXSave)) {
+		Log(kWarn, "FPU: xsave not supported, using fxsave\n");
+		return;
+	}
+
+	SetCR4(GetCR4() | kCR4OSXSave);
+
+	ReadCPUID(0xd, 0, regs);
+	const uint64_t supported = static_cast<uint64_t>(regs[3]) << 32 | regs[0];
+	uint64_t xcr0 = kXCR0X87 | kXCR0SSE;
+	if ((features & kCPUIDAVX) && (supported & kXCR0AVX)) {
+		xcr0 |= kXCR0AVX;
+		if ((supported & kXCR0AVX512) == kXCR0AVX512) {
+			xcr0 |= kXCR0AVX512;
+		}
+	}
+	XSetBV(0, xcr0);
+	fpu_xcr0 = xcr0;
+
+	ReadCPUID(0xd, 0, regs);
+	fpu_area_size = regs[1]; // 현재 XCR0에서 필요한 xsave 영역 크기
+
+	ReadCPUID(0xd, 1, regs);
+	fpu_save_mode = (regs[0] & kCPUIDXSaveOpt) ? kFPUSaveXSaveOpt : kFPUSaveXSave;
+
+	Log(kInfo, "FPU: %s, xcr0 = %#lx, %lu bytes/task\n",
+		fpu_save_mode == kFPUSaveXSaveOpt ? "xsaveopt" : "xsave", fpu_xcr0, fpu_area_size);
+}
+
+void InitFPUArea(uint8_t* area) {
+	// xsave header(XSTATE_BV)가 0이면 xrstor는 각 component를 초기 상태로 설정한다 (MXCSR 제외)
+	memset(area, 0, fpu_area_size);
+	*reinterpret_cast<uint16_t*>(&area[0]) = 0x037f;	// FCW
+	*reinterpret_cast<uint32_t*>(&area[24]) = 0x1f80;	// MXCSR
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* Task별 FPU/SSE/AVX 상태 저장 방식 (asmfunc.asm의 SaveFPUState/RestoreFPUState) */
+enum FPUSaveMode : int {
+	kFPUSaveFXSave = 0,		// legacy 512바이트 영역 (x87, SSE)
+	kFPUSaveXSave = 1,		// XCR0에서 활성화된 모든 component
+	kFPUSaveXSaveOpt = 2,	// XSAVE + 마지막 xrstor 이후 수정되지 않은 component 생략
+};
+
+constexpr size_t kFPUAreaAlign = 64; // xsave 영역은 64바이트 정렬이 필요함
+
+extern "C" int fpu_save_mode;
+extern size_t fpu_area_size; // Task별 FPU 상태 저장 영역 크기 (바이트)
+extern uint64_t fpu_xcr0;    // 활성화된 XSAVE component (XSAVE를 지원하지 않으면 0)
+
+/**
+ * @brief CPUID로 XSAVE/AVX 지원 여부를 확인하고 CR4.OSXSAVE 및 XCR0를 설정합니다.
+ * Task별 FPU 상태 저장 영역의 크기가 여기서 결정되므로 TaskManager를 생성하기 전에 호출해야 합니다.
+ */
+void InitializeFPU();
+
+/**
+ * @brief 새 Task의 FPU 상태 저장 영역을 초기 상태(FCW = 0x37f, MXCSR = 0x1f80)로 채웁니다
+ * @param area fpu_area_size 바이트 크기의 영역
+ */
+void InitFPUArea(uint8_t* area);
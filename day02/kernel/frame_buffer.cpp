@@ -1,5 +1,7 @@
 #include "frame_buffer.hpp"
+#include <algorithm>
 #include <cstring>
+#include <emmintrin.h>
 
 namespace {	
 	constexpr int Bits2Bytes(int bits) { return (bits + 0b111) >> 3; }
@@ -16,6 +18,16 @@ namespace {
 	constexpr uint8_t* FrameBufPtr(Vector2D<int> pos, const FrameBufferConfig& config) {
 		return config.frame_buffer + BytesPerScanLine(config) * pos.y + BytesPerPixel(config.pixel_format) * pos.x;
 	}
+	// 0x??RRGGBB 픽셀 4개의 R과 B를 바꾼다 (kPixelRGBResv8BitPerColor의 메모리 배치는 R, G, B 순서)
+	__m128i SwapRB(__m128i v) {
+		const __m128i rb_mask = _mm_set1_epi32(0x00ff00ff);
+		const __m128i rb = _mm_and_si128(v, rb_mask);
+		const __m128i ga = _mm_andnot_si128(rb_mask, v);
+		return _mm_or_si128(ga, _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16)));
+	}
+	uint32_t SwapRB(uint32_t c) {
+		return (c & 0xff00ff00) | (c >> 16 & 0xff) | (c & 0xff) << 16;
+	}
 	Vector2D<int> FrameBufferSize(const FrameBufferConfig& config) {
 		return {
 			static_cast<int>(config.horizontal_resolution),
@@ -111,4 +123,45 @@ void FrameBuffer::Shift(Vector2D<int> dst_pos, const Rectangle<int>& src_area) {
 			src_buf -= bytes_per_scan_line;
 		}
 	}
-}
\ No newline at end of file
+}
+
+void FrameBuffer::WritePixels(Vector2D<int> pos, const uint32_t* src, int len, std::optional<uint32_t> color_key) {
+	auto dst = reinterpret_cast<uint32_t*>(FrameBufPtr(pos, config));
+	// 0x00RRGGBB를 little endian으로 저장하면 B, G, R 순서이므로 BGR 형식은 그대로 복사한다
+	const bool swap_rb = config.pixel_format == kPixelRGBResv8BitPerColor;
+	if (!swap_rb && !color_key) {
+		memcpy(dst, src, sizeof(uint32_t) * len);
+		return;
+	}
+
+	const uint32_t key = color_key.value_or(0) & 0x00ffffff;
+	const __m128i key4 = _mm_set1_epi32(key);
+	const __m128i rgb_mask = _mm_set1_epi32(0x00ffffff);
+	int i = 0;
+	for (; i + 4 <= len; i += 4) {
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		__m128i out = swap_rb ? SwapRB(v) : v;
+		if (color_key) { // color key와 같은 픽셀은 원래 값을 남긴다
+			const __m128i skip = _mm_cmpeq_epi32(_mm_and_si128(v, rgb_mask), key4);
+			const __m128i old = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+			out = _mm_or_si128(_mm_and_si128(skip, old), _mm_andnot_si128(skip, out));
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), out);
+	}
+	for (; i < len; i++) {
+		const uint32_t c = src[i];
+		if (color_key && (c & 0x00ffffff) == key) {
+			continue;
+		}
+		dst[i] = swap_rb ? SwapRB(c) : c;
+	}
+}
+
+void FrameBuffer::FillRect(const Rectangle<int>& area, uint32_t color) {
+	const uint32_t c = config.pixel_format == kPixelRGBResv8BitPerColor ? SwapRB(color) : color;
+	uint8_t* row = FrameBufPtr(area.pos, config);
+	for (int dy = 0; dy < area.size.y; dy++) {
+		std::fill_n(reinterpret_cast<uint32_t*>(row), area.size.x, c);
+		row += BytesPerScanLine(config);
+	}
+}
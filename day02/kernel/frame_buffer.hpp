@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <memory>
+#include <optional>
 
 #include "frame_buffer_config.h"
 #include "graphics.hpp"
@@ -34,6 +35,18 @@ public:
 	 */
 	void Shift(Vector2D<int> dst_pos, const Rectangle<int>& src_area);
 
+	/**
+	 * @brief pos부터 가로로 len개의 0x00RRGGBB 픽셀을 이 FrameBuffer의 픽셀 형식으로 변환해서 씁니다. SSE2로 4픽셀씩 변환합니다.
+	 * 범위를 벗어나지 않도록 호출자가 잘라서 넘겨야 합니다.
+	 * @param color_key 이 색(하위 24비트)의 픽셀은 쓰지 않습니다
+	 */
+	void WritePixels(Vector2D<int> pos, const uint32_t* src, int len, std::optional<uint32_t> color_key);
+
+	/**
+	 * @brief area를 0x00RRGGBB 색 color로 채웁니다. 범위를 벗어나지 않도록 호출자가 잘라서 넘겨야 합니다.
+	 */
+	void FillRect(const Rectangle<int>& area, uint32_t color);
+
 	FrameBufferWriter* Writer() { return writer.get(); }
 	const FrameBufferConfig& Config() const { return config; }
 
@@ -0,0 +1,115 @@
+#include "futex.hpp"
+#include "paging.hpp"
+#include "task.hpp"
+#include "interrupt.hpp"
+#include "uaccess.hpp"
+#include <array>
+
+namespace {
+	/* 대기 중인 Task의 커널 스택에 놓이는 노드. 버킷마다 대기 순서대로 연결된다 */
+	/*
+	 * private futex는 (AppSpace*, 가상 주소)로 구분한다. fork는 쓰기 가능한 페이지를 다시 copy-on-write로 만들기 때문에
+	 * 물리 주소는 쓰기 한 번에 바뀔 수 있다. shared 페이지는 복사되지 않으므로 (0, 물리 주소)로 구분한다
+	 */
+	struct FutexKey {
+		uint64_t space;
+		uint64_t addr;
+
+		bool operator==(const FutexKey& rhs) const { return space == rhs.space && addr == rhs.addr; }
+		bool operator!=(const FutexKey& rhs) const { return !(*this == rhs); }
+	};
+
+	struct FutexWaiter {
+		FutexKey key;
+		Task* task;
+		bool woken;
+		FutexWaiter* next;
+	};
+
+	constexpr size_t kNumBuckets = 64;
+	std::array<FutexWaiter*, kNumBuckets> buckets {};
+
+	FutexWaiter*& Bucket(const FutexKey& key) {
+		return buckets[((key.addr >> 2) ^ (key.space >> 4)) % kNumBuckets];
+	}
+
+	WithError<FutexKey> GetFutexKey(const uint32_t* uaddr) {
+		const auto vaddr = reinterpret_cast<uint64_t>(uaddr);
+		if (vaddr % alignof(uint32_t) != 0) {
+			return { {}, MakeError(Error::kInvalidFormat) };
+		}
+		// 한 번 읽어서 demand paging / file mapping 페이지를 매핑시킨다
+		uint32_t val;
+		if (!GetUser32(uaddr, val)) {
+			return { {}, MAKE_ERROR(Error::kBadAddress) };
+		}
+		if (IsSharedPage(LinearAddress4Level{vaddr})) {
+			auto [ paddr, err ] = LinearToPhysical(vaddr);
+			return { FutexKey{0, paddr}, err };
+		}
+		InterruptDisabler guard;
+		const auto space = reinterpret_cast<uint64_t>(&task_manager->CurrentTask().Space());
+		return { FutexKey{space, vaddr}, MAKE_ERROR(Error::kSuccess) };
+	}
+}
+
+Error FutexWait(const uint32_t* uaddr, uint32_t val) {
+	auto [ key, err ] = GetFutexKey(uaddr);
+	if (err) {
+		return err;
+	}
+
+	// 값 확인부터 sleep까지 인터럽트를 금지하므로 그 사이에 FutexWake가 끼어들 수 없다
+	InterruptDisabler guard;
+	uint32_t cur;
+	if (!GetUser32(uaddr, cur)) {
+		return MAKE_ERROR(Error::kBadAddress);
+	}
+	if (cur != val) {
+		return MAKE_ERROR(Error::kTryAgain);
+	}
+
+	FutexWaiter waiter{key, &task_manager->CurrentTask(), false, nullptr};
+	FutexWaiter** tail = &Bucket(key);
+	while (*tail) {
+		tail = &(*tail)->next;
+	}
+	*tail = &waiter;
+
+	// 메세지 수신으로도 깨어날 수 있으므로 FutexWake가 큐에서 꺼낼 때까지 다시 잔다
+	while (!waiter.woken) {
+		if (waiter.task->Space().exiting) { // 앱이 종료 중이면 큐에서 빠져서 시스템콜 복귀 시 종료된다
+			for (FutexWaiter** p = &Bucket(key); *p; p = &(*p)->next) {
+				if (*p == &waiter) {
+					*p = waiter.next;
+					break;
+				}
+			}
+			return MAKE_ERROR(Error::kTryAgain);
+		}
+		waiter.task->Sleep();
+	}
+	return MAKE_ERROR(Error::kSuccess);
+}
+
+WithError<int> FutexWake(const uint32_t* uaddr, int n) {
+	auto [ key, err ] = GetFutexKey(uaddr);
+	if (err) {
+		return { 0, err };
+	}
+
+	InterruptDisabler guard;
+	int woken = 0;
+	for (FutexWaiter** p = &Bucket(key); *p && woken < n; ) {
+		FutexWaiter* w = *p;
+		if (w->key != key) {
+			p = &w->next;
+			continue;
+		}
+		*p = w->next;
+		w->woken = true;
+		w->task->Wakeup();
+		++woken;
+	}
+	return { woken, MAKE_ERROR(Error::kSuccess) };
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include "error.hpp"
+
+/**
+ * @brief *uaddr == val인 동안 현재 Task를 재웁니다 (FUTEX_WAIT).
+ * 대기 큐는 (주소 공간, uaddr)로 구분되므로 fork 이후 copy-on-write로 프레임이 바뀌어도 같은 futex로 남습니다.
+ * 여러 주소 공간에 매핑되는 shared 페이지(창 surface)만 물리 주소로 구분합니다.
+ * @return 값이 이미 다르면 kTryAgain, uaddr가 매핑되지 않았으면 kNoSuchEntry
+ */
+Error FutexWait(const uint32_t* uaddr, uint32_t val);
+/**
+ * @brief uaddr에서 대기 중인 Task를 최대 n개 대기 순서대로 깨웁니다 (FUTEX_WAKE).
+ * @return 깨운 Task 수
+ */
+WithError<int> FutexWake(const uint32_t* uaddr, int n);
@@ -96,6 +96,15 @@ struct Rectangle {
 		auto new_size = ElementMin(end, rhs_end) - new_pos;
 		return { new_pos, new_size };
 	}
+	// 두 영역을 모두 포함하는 가장 작은 영역 (크기가 0인 영역은 무시한다)
+	Rectangle<T> operator|(const Rectangle<T>& rhs) const {
+		if (size.x <= 0 || size.y <= 0) return rhs;
+		if (rhs.size.x <= 0 || rhs.size.y <= 0) return *this;
+
+		auto new_pos = ElementMin(this->pos, rhs.pos);
+		auto new_end = ElementMax(this->pos + this->size, rhs.pos + rhs.size);
+		return { new_pos, new_end - new_pos };
+	}
 };
 // typename alias
 #define Rect Rectangle
@@ -6,7 +6,12 @@
 #include "task.hpp"
 #include "font.hpp"
 #include "paging.hpp"
+#include "stack_pool.hpp"
+#include "uaccess.hpp"
+#include "workqueue.hpp"
+#include "usb/xhci/xhci.hpp"
 #include <string_view>
+#include <algorithm>
 #include <csignal>
 
 void KillApp(InterruptFrame* frame) {
@@ -56,8 +61,7 @@ namespace fault {
 	DefineFault(OF, 0);
 	DefineFault(BR, 0);
 	DefineFault(UD, 0);
-	DefineFault(NM, 0);
-	DefineFault(DF, 1);
+	// DefineFault(DF, 1);
 	DefineFault(TS, 1);
 	DefineFault(NP, 1);
 	DefineFault(SS, 1);
@@ -91,17 +95,37 @@ __attribute__((interrupt)) void IntHandlerNE(InterruptFrame* frame) {
 	while (true) __asm__("hlt");
 }
 
+void PrintStackOverflow(uint64_t cr2) {
+	if (kernel_stack_pool->IsGuardPage(cr2)) {
+		font::WriteString(*kScreenWriter, {500, font::FONT_HEIGHT * 5}, "KERNEL STACK OVERFLOW", gfx::color::RED);
+	}
+}
+
+// 커널 스택의 guard page에 닿은 경우 #PF를 전달할 스택이 없어 #DF가 발생하므로, #DF는 별도의 IST 스택에서 처리한다
+__attribute__((interrupt)) void IntHandlerDF(InterruptFrame* frame, uint64_t error_code) {
+	PrintFrame(frame, "DF");
+	PrintStackOverflow(GetCR2());
+	while (true) __asm__("hlt");
+}
+
 __attribute__((interrupt)) void IntHandlerPF(InterruptFrame* frame, uint64_t error_code) {
 	uint64_t cr2 = GetCR2();
+	++task_manager->CurrentTask().Usage().page_faults;
 	if (auto err = HandlePageFault(error_code, cr2); !err) {
 		return;
 	}
 	if ((frame->cs & 0b11) == 0b11) { // cpl = 3
 		KillApp(frame);
 	}
+	// 시스템콜이 user 메모리에 접근하다 난 fault면 접근 루틴의 fixup으로 돌아가서 실패를 반환하게 한다 (uaccess.hpp)
+	if (const uint64_t fixup = SearchExceptionTable(frame->rip)) {
+		frame->rip = fixup;
+		return;
+	}
 	PrintFrame(frame, "PF");
 	font::WriteString(*kScreenWriter, {500, font::FONT_HEIGHT * 4}, "ERR", gfx::color::RED);
 	PrintHex(error_code, 16, { Vector2D<int> { 500, 0 } + vec_multiply(font::FONT_SIZE, { 4, 4 }) });
+	PrintStackOverflow(cr2);
 	while (true) __asm__("hlt");
 }
 
@@ -131,16 +155,38 @@ void NotifyEOI() {
 	*eoi_register = 0;
 }
 
+void InterruptLatencyStat::Record(uint64_t cycles) {
+	++count;
+	total_cycles += cycles;
+	max_cycles = std::max(max_cycles, cycles);
+}
+
+InterruptLatencyStat xhci_latency;
+
 namespace {
-	__attribute__((interrupt))
-	void IntHandlerXHCI(InterruptFrame* frame) {
-		task_manager->SendMsg(1, Message{Message::InterruptXHCI});
-		NotifyEOI();
+	// bottom half: kWorkHigh worker에서 실행된다
+	void ProcessXHCIWork(uint64_t irq_tsc) {
+		{
+			InterruptDisabler guard;
+			xhci_latency.Record(ReadTSC() - irq_tsc);
+		}
+		usb::xhci::ProcessEvents();
 	}
+}
+
+extern "C" void XHCIOnInterrupt(const TaskContext& ctx_stack) {
+	QueueWork(kWorkHigh, ProcessXHCIWork, ReadTSC());
+	NotifyEOI();
 
+	// worker가 현재 Task보다 높은 레벨이면 다음 타이머 인터럽트를 기다리지 않고 바로 전환한다
+	if (task_manager->NeedResched()) {
+		task_manager->SwitchTask(ctx_stack, false);
+	}
 }
 
 extern "C" void IntHandlerLAPICTimer(InterruptFrame* frame);
+extern "C" void IntHandlerXHCI(InterruptFrame* frame);
+extern "C" void IntHandlerNM(InterruptFrame* frame);
 
 void InitializeInterrupt() {
 	auto set_idt_entry = [](int irq, auto handler) {
@@ -160,8 +206,13 @@ void InitializeInterrupt() {
 	set_idt_entry(4, IntHandlerNE<fault::OF>);
 	set_idt_entry(5, IntHandlerNE<fault::BR>);
 	set_idt_entry(6, IntHandlerNE<fault::UD>);
-	set_idt_entry(7, IntHandlerNE<fault::NM>);
-	set_idt_entry(8, IntHandlerWE<fault::DF>);
+	set_idt_entry(7, IntHandlerNM); // lazy FPU switching (task.hpp)
+	SetIDTEntry(
+		static_cast<InterruptVector::Number>(8),
+		MakeIDTAttr(DescriptorType::InterruptGate, 0, true, kISTForDoubleFault),
+		reinterpret_cast<uint64_t>(IntHandlerDF),
+		kKernelCS
+	);
 	set_idt_entry(10, IntHandlerWE<fault::TS>);
 	set_idt_entry(11, IntHandlerWE<fault::NP>);
 	set_idt_entry(12, IntHandlerWE<fault::SS>);
@@ -143,9 +143,34 @@ void NotifyEOI();
 #define ENABLE_INTERRUPT __asm__("sti")
 #define ENABLE_INTERRUPT_AND_HALT __asm__("sti\n\thlt")
 
+/* scope 동안 인터럽트를 금지하고, 끝나면 이전 IF 값을 복원한다 (인터럽트 금지 상태에서도 호출될 수 있는 코드용) */
+class InterruptDisabler {
+public:
+	InterruptDisabler() { __asm__ volatile("pushfq\n\tpop %0\n\tcli" : "=r"(rflags) :: "memory"); }
+	~InterruptDisabler() { __asm__ volatile("push %0\n\tpopfq" :: "r"(rflags) : "memory", "cc"); }
+	InterruptDisabler(const InterruptDisabler&) = delete;
+	InterruptDisabler& operator=(const InterruptDisabler&) = delete;
+
+	// guard를 만들기 전에 인터럽트가 허용되어 있었는지 (false면 인터럽트 핸들러이거나 cli 구간이다)
+	bool WasEnabled() const { return rflags & (1u << 9); }
+private:
+	uint64_t rflags;
+};
+
 /* 인터럽트 핸들러를 설정합니다. */
 void InitializeInterrupt();
 
+/* 인터럽트 발생부터 핸들러 Task가 메세지를 처리하기 시작할 때까지의 지연 시간 (TSC 사이클) */
+struct InterruptLatencyStat {
+	uint64_t count;
+	uint64_t total_cycles;
+	uint64_t max_cycles;
+
+	void Record(uint64_t cycles);
+};
+
+extern InterruptLatencyStat xhci_latency;
+
 template <class Func>
 void InterruptGuard(Func f) {
 	DISABLE_INTERRUPT;
@@ -0,0 +1,23 @@
+#pragma once
+
+#ifdef __cplusplus
+#include <cstddef>
+#else
+#include <stddef.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* SyscallReadV/SyscallWriteV에 넘기는 버퍼 (POSIX의 struct iovec와 같은 배치) */
+struct IOVec {
+	void* base;
+	size_t len;
+};
+
+#define IOV_MAX_COUNT 1024 // 한 번에 넘길 수 있는 IOVec 수
+
+#ifdef __cplusplus
+}
+#endif
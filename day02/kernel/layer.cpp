@@ -4,6 +4,8 @@
 #include "console.hpp"
 #include "task.hpp"
 #include "interrupt.hpp"
+#include "workqueue.hpp"
+#include "window_surface.hpp"
 
 void Layer::DrawTo(FrameBuffer& dst, const Rect<int>& area) const {
 	if (window) window->DrawTo(dst, pos, area);
@@ -87,8 +89,8 @@ void LayerManager::SetPosAbsolute(LayerID_t id, Vector2D<int> pos_abs) {
 	const auto window_size = layer->GetWindow()->Size();
 	const auto old_pos = layer->GetPos();
 	layer->SetPosAbsolute(pos_abs);
-	Draw( {old_pos, window_size} );
-	Draw(id);
+	DamageScreen({old_pos, window_size});
+	DamageLayer(id);
 }
 
 void LayerManager::SetPosRelative(LayerID_t id, Vector2D<int> pos_diff) {
@@ -96,8 +98,8 @@ void LayerManager::SetPosRelative(LayerID_t id, Vector2D<int> pos_diff) {
 	const auto window_size = layer->GetWindow()->Size();
 	const auto old_pos = layer->GetPos();
 	layer->SetPosRelative(pos_diff);
-	Draw( {old_pos, window_size} );
-	Draw(id);
+	DamageScreen({old_pos, window_size});
+	DamageLayer(id);
 }
 
 Vector2D<int> LayerManager::GetPos(LayerID_t id) const {
@@ -192,7 +194,7 @@ void ActiveLayer::Activate(LayerID_t layerID) {
 	if (active_layer > 0) {
 		// deactivate layer
 		manager.FindLayer(active_layer)->GetWindow()->Deactivate();
-		manager.Draw(active_layer);
+		DamageLayer(active_layer);
 		SendWindowActiveMsg(active_layer, false);
 	}
 
@@ -205,7 +207,7 @@ void ActiveLayer::Activate(LayerID_t layerID) {
 			top_depth = manager.GetDepth(mouse_layer) - 1;
 		}
 		manager.SetDepth(active_layer, top_depth);
-		manager.Draw(active_layer);
+		DamageLayer(active_layer);
 		SendWindowActiveMsg(active_layer, true);
 	}
 }
@@ -243,28 +245,130 @@ void InitializeLayer() {
 	kLayerManager->SetDepth(layerID_console, 1);
 
 	kConsole->SetWindow(win_console);
-	kConsole->SetOnDraw([=]() { kLayerManager->Draw(layerID_console); });
+	kConsole->SetOnDraw([=]() { DamageLayer(layerID_console); });
 
 	active_layer = new ActiveLayer(*kLayerManager);
 	layer_task_map = new std::map<LayerID_t, TaskID_t>;
 }
 
+namespace {
+	void SendLayerFinish(uint64_t task_id) {
+		task_manager->SendMsg(task_id, Message{Message::LayerFinish});
+	}
+}
+
 void ProcessLayerMessage(const Message& msg) {
 	const auto& arg = msg.arg.layer;
 	switch (arg.op) {
-		case LayerOperation::MovAbs:
+		case LayerOperation::MovAbs: {
+			InterruptDisabler guard;
 			kLayerManager->SetPosAbsolute(arg.layerID, {arg.x, arg.y});
-			break;
-		case LayerOperation::MovRel:
+		} break;
+		case LayerOperation::MovRel: {
+			InterruptDisabler guard;
 			kLayerManager->SetPosRelative(arg.layerID, {arg.x, arg.y});
-			break;
+		} break;
 		case LayerOperation::Draw:
-			kLayerManager->Draw(arg.layerID);
+			DamageLayer(arg.layerID);
 			break;
 		case LayerOperation::DrawPartial:
-			kLayerManager->Draw(arg.layerID, {{arg.x,arg.y}, {arg.w,arg.h}});
+			DamageLayer(arg.layerID, {{arg.x,arg.y}, {arg.w,arg.h}});
 			break;
 	}
+
+	// work는 넣은 순서대로 실행되므로, 위에서 표시한 영역의 합성이 끝난 뒤에 LayerFinish가 전달된다
+	if (!QueueWork(kWorkHigh, SendLayerFinish, msg.src_task)) {
+		SendLayerFinish(msg.src_task);
+	}
+}
+
+namespace {
+	struct Damage {
+		LayerID_t id;	// kScreenDamage면 area는 화면 좌표
+		Rect<int> area; // 크기가 음수면 레이어 전체
+	};
+
+	constexpr LayerID_t kScreenDamage = 0; // 레이어 ID는 1부터 시작한다
+
+	constexpr size_t kMaxDamages = 16;
+	std::array<Damage, kMaxDamages> damages;
+	size_t num_damages = 0;
+	bool damage_overflow = false;	// 표가 가득 차면 화면 전체를 다시 그린다
+	bool flush_queued = false;
+
+	bool WholeLayer(const Rect<int>& area) {
+		return area.size.x < 0 || area.size.y < 0;
+	}
+
+	void FlushDamages(uint64_t) {
+		std::array<Damage, kMaxDamages> pending;
+		size_t num_pending;
+		bool overflow;
+		{
+			InterruptDisabler guard;
+			pending = damages;
+			num_pending = num_damages;
+			overflow = damage_overflow;
+			num_damages = 0;
+			damage_overflow = false;
+			flush_queued = false;
+		}
+
+		if (overflow) {
+			kLayerManager->Draw({{0, 0}, ScreenSize()});
+			return;
+		}
+		for (size_t i = 0; i < num_pending; i++) {
+			if (pending[i].id == kScreenDamage) {
+				kLayerManager->Draw(pending[i].area);
+			} else {
+				kLayerManager->Draw(pending[i].id, pending[i].area);
+			}
+		}
+	}
+}
+
+void DamageLayer(LayerID_t id, const Rect<int>& area) {
+	{
+		InterruptDisabler guard;
+
+		auto it = std::find_if(damages.begin(), damages.begin() + num_damages,
+			[id](const Damage& d) { return d.id == id; });
+		if (it != damages.begin() + num_damages) {
+			if (!WholeLayer(it->area)) {
+				it->area = WholeLayer(area) ? area : (it->area | area);
+			}
+		} else if (num_damages < kMaxDamages) {
+			damages[num_damages++] = Damage{id, area};
+		} else {
+			damage_overflow = true;
+		}
+
+		// 아직 처리되지 않은 flush가 있으면 거기에 합쳐진다
+		if (flush_queued) {
+			return;
+		}
+		if (WorkQueuesReady()) {
+			flush_queued = QueueWork(kWorkHigh, FlushDamages);
+			return;
+		}
+	}
+	// 부팅 중(worker가 생기기 전)에는 main task만 그리므로 바로 합성한다
+	FlushDamages(0);
+}
+
+void DamageScreen(const Rect<int>& area) {
+	DamageLayer(kScreenDamage, area);
+}
+
+void UnmapWindowSurfaces(uint64_t cr3) {
+	InterruptDisabler guard;
+	kLayerManager->ForEachLayer([cr3](Layer& layer) {
+		auto surface = layer.GetWindow() ? layer.GetWindow()->Surface() : nullptr;
+		if (surface && surface->MappedCR3() == cr3) {
+			surface->Unmap();
+		}
+	});
 }
 
 void SendCloseMessage(LayerID_t layerID) {
@@ -287,11 +391,14 @@ Error CloseLayer(LayerID_t layerID) {
 
 	const auto pos = layer->GetPos();
 	const auto size = layer->GetWindow()->Size();
+	if (auto surface = layer->GetWindow()->Surface()) {
+		surface->Unmap(); // 앱 주소 공간에서 제거해야 창과 함께 버퍼가 해제된다
+	}
 
 	DISABLE_INTERRUPT;
 	active_layer->Activate(0);
 	kLayerManager->RemoveLayer(layerID);
-	kLayerManager->Draw({pos, size});
+	DamageScreen({pos, size});
 	layer_task_map->erase(layerID);
 	ENABLE_INTERRUPT;
 
@@ -72,6 +72,11 @@ public:
 	const Layer* FindLayer(LayerID_t id) const;
 
 	void RemoveLayer(unsigned int id);
+	// 모든 Layer에 대해 f(Layer&)를 호출합니다. 인터럽트 금지 상태에서 호출해야 합니다
+	template <class Func>
+	void ForEachLayer(Func f) {
+		for (auto& layer : layers) f(*layer);
+	}
 
 private:
 	FrameBuffer* screen{nullptr}; // OS 전체화면 그래픽
@@ -99,7 +104,25 @@ extern ActiveLayer* active_layer;
 extern std::map<LayerID_t, TaskID_t>* layer_task_map;
 
 void InitializeLayer();
+/**
+ * @brief Layer 메세지를 처리하고, 합성이 끝난 뒤 kWorkHigh worker에서 msg.src_task에게 LayerFinish를 보냅니다
+ */
 void ProcessLayerMessage(const Message& msg);
+/**
+ * @brief 레이어의 area(레이어 좌표, 크기가 음수면 레이어 전체)를 다시 그려야 한다고 표시합니다.
+ * 실제 합성은 kWorkHigh worker가 모아서 한 번에 수행하므로 레이어 하나당 영역들의 합집합만 그려집니다.
+ * 인터럽트 금지 여부와 관계없이 어느 Task에서나 호출할 수 있습니다.
+ */
+void DamageLayer(LayerID_t id, const Rect<int>& area = {{0,0}, {-1, -1}});
+/**
+ * @brief 화면 좌표 area를 다시 그려야 한다고 표시합니다 (옮기거나 닫은 레이어가 있던 자리). DamageLayer와 같이 합성됩니다
+ */
+void DamageScreen(const Rect<int>& area);
+/**
+ * @brief cr3 주소 공간에 매핑된 창 surface의 매핑을 모두 제거합니다. 앱이 CloseWindow 없이 종료되어도
+ * 창이 닫힐 때 surface 버퍼가 해제되도록, 주소 공간을 해제하기 전에 호출합니다
+ */
+void UnmapWindowSurfaces(uint64_t cr3);
 
 constexpr Message MakeLayerMessage(TaskID_t task_id, LayerID_t layer_id, LayerOperation op, Rect<int> area) {
 	Message msg{Message::Layer, task_id};
@@ -12,6 +12,7 @@
 #include "segment.hpp"
 #include "paging.hpp"
 #include "memory_manager.hpp"
+#include "stack_pool.hpp"
 
 #include "frame_buffer_config.h"
 #include "graphics.hpp"
@@ -36,6 +37,8 @@
 
 #include "usb/xhci/xhci.hpp"
 #include "syscall.hpp"
+#include "fpu.hpp"
+#include "workqueue.hpp"
 
 //void* operator new(size_t size, void* buffer) noexcept { return buffer; }
 void operator delete(void* obj) noexcept {}
@@ -73,6 +76,15 @@ void InitializeMainWindow() {
 	kLayerManager->SetDepth(layerID_mainwindow, 2);
 }
 
+// kWorkHigh worker에서 주기적으로 실행되어 main 윈도우의 시각 표시를 갱신한다
+void UpdateMainWindowTick(uint64_t) {
+	char str[16];
+	sprintf(str, "%010lu", timer_manager->CurrentTick());
+	FillRect(*win_mainwindow->InnerWriter(), {0, 0}, {font::FONT_WIDTH*10, font::FONT_HEIGHT}, {0xc6, 0xc6, 0xc6});
+	font::WriteString(*win_mainwindow->InnerWriter(), 0, 0, str, {0, 0, 0});
+	DamageLayer(layerID_mainwindow);
+}
+
 std::shared_ptr<TitleBarWindow> win_text_window; unsigned int layerID_text_window;
 void InitializeTextWindow() {
 	const int win_w = 160;
@@ -117,7 +129,7 @@ void InputTextWindow(char c) {
 		++text_window_index;
 		DrawTextCursor(true);
 	}
-	kLayerManager->Draw(layerID_text_window);
+	DamageLayer(layerID_text_window);
 }
 
 void TaskTextWindow(TaskID_t taskID, int64_t data) {
@@ -136,28 +148,30 @@ void TaskTextWindow(TaskID_t taskID, int64_t data) {
 
 	bool cursor_visible = 1;
 
+	std::array<Message, 16> msgs;
 	while (true) {
-		const auto& msg = task.Wait();
-		
-		switch (msg.type) {
-			case Message::TimerTimeout:
-				cursor_visible = !cursor_visible;
-				DrawTextCursor(cursor_visible);
-				break;
-			case Message::KeyPush:
-				if (msg.arg.keyboard.press)
-					InputTextWindow(msg.arg.keyboard.ascii);
-				break;
-			case Message::WindowClose:
-				CloseLayer(msg.arg.window_close.layer_id);
-				DISABLE_INTERRUPT;
-				task_manager->Finish(0);
-				break;
-			default: break;
+		const size_t num_msgs = task.WaitMsgs(msgs.data(), msgs.size());
+
+		for (size_t i = 0; i < num_msgs; i++) {
+			const auto& msg = msgs[i];
+			switch (msg.type) {
+				case Message::TimerTimeout:
+					cursor_visible = !cursor_visible;
+					DrawTextCursor(cursor_visible);
+					break;
+				case Message::KeyPush:
+					if (msg.arg.keyboard.press)
+						InputTextWindow(msg.arg.keyboard.ascii);
+					break;
+				case Message::WindowClose:
+					CloseLayer(msg.arg.window_close.layer_id);
+					DISABLE_INTERRUPT;
+					task_manager->Finish(0);
+					break;
+				default: break;
+			}
 		}
-		DISABLE_INTERRUPT;
-		task_manager->SendMsg(MainTaskID, MakeLayerMessage(taskID, layerID_text_window, LayerOperation::Draw, {}));
-		ENABLE_INTERRUPT;
+		DamageLayer(layerID_text_window);
 	}
 }
 
@@ -179,7 +193,9 @@ extern "C" void KernelMain(const FrameBufferConfig* frame_buffer_config_ptr, con
 	InitializeMemoryManager(memory_map);
 
 	InitializeTSS();
+	InitializeKernelStackPool();
 	InitializeSyscall();
+	InitializeFPU();
 
 	/* Initialize Interrupt Handler */
 	InitializeInterrupt();
@@ -192,7 +208,7 @@ extern "C" void KernelMain(const FrameBufferConfig* frame_buffer_config_ptr, con
 	InitializeLayer(); // kLayerManager Enabled
 	InitializeMainWindow();
 	//InitializeTextWindow();
-	kLayerManager->Draw({{0,0}, ScreenSize() });
+	DamageScreen({{0,0}, ScreenSize()});
 
 	/* Initialize Timer */
 	acpi::Initialize(*acpi_table);
@@ -200,12 +216,18 @@ extern "C" void KernelMain(const FrameBufferConfig* frame_buffer_config_ptr, con
 
 	const int kTimerHalfSec = kTimerFreq * 0.5;
 	DISABLE_INTERRUPT;
-	timer_manager->AddTimer(Timer(kTimerHalfSec, kTextboxCursorTimer, MainTaskID));
+	timer_manager->AddTimer(Timer(kTimerHalfSec, kTextboxCursorTimer, MainTaskID, kTimerHalfSec, kCursorBlinkSlack));
 	//timer_manager->AddTimer(Timer(kTimerFreq * 1, 24));
 	ENABLE_INTERRUPT;
 
 	InitTask();
 	Task& main_task = task_manager->CurrentTask();
+	InitializeWorkQueues(); // 이후로 레이어 합성은 kWorkHigh worker만 수행한다
+
+	const int kTickDisplayPeriod = kTimerFreq / 10;
+	DISABLE_INTERRUPT;
+	timer_manager->AddTimer(Timer(kTickDisplayPeriod, UpdateMainWindowTick, 0, kWorkHigh, kTickDisplayPeriod, 1));
+	ENABLE_INTERRUPT;
 	const uint64_t task_textwindow_id = task_manager->NewTask()
 		.InitContext(TaskTextWindow, 0)
 		.Wakeup()
@@ -222,83 +244,59 @@ extern "C" void KernelMain(const FrameBufferConfig* frame_buffer_config_ptr, con
 	LayerID_t layerID_mouse = InitializeMouse();
 	InitializeKeyboard();
 
-	char str[128];
+	std::array<Message, 32> msgs;
 
 	/* Interrupt Event Loop */
+	// xHCI 이벤트 처리와 화면 합성은 work queue로 옮겨졌으므로, main task는 메세지 분배만 한다
 	while (1) {
-		DISABLE_INTERRUPT;
-		const auto tick = timer_manager->CurrentTick();
-		ENABLE_INTERRUPT;
-
-		sprintf(str, "%010lu", tick);
-		FillRect(*win_mainwindow->InnerWriter(), {0, 0}, {font::FONT_WIDTH*10, font::FONT_HEIGHT}, {0xc6, 0xc6, 0xc6});
-		font::WriteString(*win_mainwindow->InnerWriter(), 0, 0, str, {0, 0, 0});
-		kLayerManager->Draw(layerID_mainwindow);
-
-		DISABLE_INTERRUPT;
-		auto msg = main_task.ReceiveMsg();
-		if (!msg) {
-			main_task.Sleep();
-			ENABLE_INTERRUPT;
-			continue;
-		}
-		ENABLE_INTERRUPT;
-
-		switch (msg->type) {
-			case Message::InterruptXHCI:
-				usb::xhci::ProcessEvents();
-				break;
-			case Message::TimerTimeout:
-				switch (msg->arg.timer.value) {
-					case kTextboxCursorTimer:
-						InterruptGuard([](){ timer_manager->AddTimer(Timer(kTimerHalfSec, kTextboxCursorTimer, MainTaskID)); });
-						DISABLE_INTERRUPT;
-						task_manager->SendMsg(task_textwindow_id, *msg);
-						ENABLE_INTERRUPT;
-						break;
-					default:
-						printk("[TIMEOUT] %lu tick(s) elapsed. value(%d) received.\n", msg->arg.timer.timeout, msg->arg.timer.value);
-						break;
-				} break;
-			case Message::KeyPush: {
-				if (msg->arg.keyboard.press && msg->arg.keyboard.keycode == 59 /* F2 */) {
-					task_manager->NewTask().InitContext(TaskTerminal, 0).Wakeup();
-				}
-
-				DISABLE_INTERRUPT;
-				auto task_it = layer_task_map->find(active_layer->GetActiveLayer());
-				ENABLE_INTERRUPT;
-				if (task_it != layer_task_map->end()) {
+		const size_t num_msgs = main_task.WaitMsgs(msgs.data(), msgs.size());
+		for (size_t i = 0; i < num_msgs; i++) {
+			const Message* msg = &msgs[i];
+			switch (msg->type) {
+				case Message::TimerTimeout:
+					switch (msg->arg.timer.value) {
+						case kTextboxCursorTimer:
+							task_manager->SendMsg(task_textwindow_id, *msg);
+							break;
+						default:
+							printk("[TIMEOUT] %lu tick(s) elapsed. value(%d) received.\n", msg->arg.timer.timeout, msg->arg.timer.value);
+							break;
+					} break;
+				case Message::KeyPush: {
+					if (msg->arg.keyboard.press && msg->arg.keyboard.keycode == 59 /* F2 */) {
+						task_manager->NewTask().InitContext(TaskTerminal, 0).Wakeup();
+					}
+
 					DISABLE_INTERRUPT;
-					task_manager->SendMsg(task_it->second, *msg);
+					auto task_it = layer_task_map->find(active_layer->GetActiveLayer());
 					ENABLE_INTERRUPT;
-				} else {
-					if (msg->arg.keyboard.ascii == 's') {
-						DISABLE_INTERRUPT;
-						auto pos = kLayerManager->GetPos(layerID_mouse);
-						auto layer = kLayerManager->FindLayerByPosition(pos, layerID_mouse);
-						auto layer_pos = layer->GetPos();
-						ENABLE_INTERRUPT;
-						auto px_pos_wincoord = pos - layer_pos;
-						auto color = layer->GetWindow()->At(px_pos_wincoord.x, px_pos_wincoord.y);
-
-						printk("color at (%d, %d): #%02x%02x%02x\n", pos.x, pos.y, color.r, color.g, color.b);
+					if (task_it != layer_task_map->end()) {
+						task_manager->SendMsg(task_it->second, *msg);
 					} else {
-						printk("unhandled key push: keycode %02x, ascii %02x\n",
-							msg->arg.keyboard.keycode,
-							msg->arg.keyboard.ascii);
-					}
+						if (msg->arg.keyboard.ascii == 's') {
+							DISABLE_INTERRUPT;
+							auto pos = kLayerManager->GetPos(layerID_mouse);
+							auto layer = kLayerManager->FindLayerByPosition(pos, layerID_mouse);
+							auto layer_pos = layer->GetPos();
+							ENABLE_INTERRUPT;
+							auto px_pos_wincoord = pos - layer_pos;
+							auto color = layer->GetWindow()->At(px_pos_wincoord.x, px_pos_wincoord.y);
+
+							printk("color at (%d, %d): #%02x%02x%02x\n", pos.x, pos.y, color.r, color.g, color.b);
+						} else {
+							printk("unhandled key push: keycode %02x, ascii %02x\n",
+								msg->arg.keyboard.keycode,
+								msg->arg.keyboard.ascii);
+						}
 					
-				}
-			} break;
-			case Message::Layer:
-				ProcessLayerMessage(*msg);
-				DISABLE_INTERRUPT;
-				task_manager->SendMsg(msg->src_task, Message{Message::LayerFinish});
-				ENABLE_INTERRUPT;
-				break;
-			default:
-				Log(kError, "Unknown message type: %d\n", msg->type);
+					}
+				} break;
+				case Message::Layer:
+					ProcessLayerMessage(*msg);
+					break;
+				default:
+					Log(kError, "Unknown message type: %d\n", msg->type);
+			}
 		}
 	}
 }
@@ -8,7 +8,6 @@ enum class LayerOperation {
 
 struct Message {
 	enum Type {
-		InterruptXHCI,
 		TimerTimeout,
 		KeyPush,
 		Layer,
@@ -18,6 +17,7 @@ struct Message {
 		WindowActive,
 		Pipe,
 		WindowClose,
+		Ping, // ctxbench
 	} type;
 	uint64_t src_task;
 	union {
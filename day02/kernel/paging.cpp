@@ -5,6 +5,9 @@
 #include "memory_manager.hpp"
 #include "paging.hpp"
 #include "error.hpp"
+#include "interrupt.hpp"
+#include "time_page.hpp"
+#include <map>
 
 namespace {
 	constexpr uint64_t PAGE_SIZE_4K = 4096;
@@ -17,6 +20,32 @@ namespace {
 	alignas(PAGE_SIZE_4K) std::array<uint64_t, 512> pml4_table;
 	alignas(PAGE_SIZE_4K) std::array<uint64_t, 512> pdp_table;
 	alignas(PAGE_SIZE_4K) std::array<PageTable, PAGE_DIR_COUNT> page_dir;
+
+	// fork로 공유된 cow 페이지(물리 주소)의 소유자 수. 2 이상일 때만 기록되며, 없으면 소유자가 하나 남은 것이다
+	std::map<uint64_t, uint32_t>* cow_owners;
+
+	void AddCoWOwner(uint64_t page) {
+		if (cow_owners == nullptr) {
+			cow_owners = new std::map<uint64_t, uint32_t>;
+		}
+		auto& n = (*cow_owners)[page];
+		n = n ? n + 1 : 2;
+	}
+
+	// 소유자를 하나 줄인다. 호출한 쪽이 마지막 소유자였으면 true
+	bool DropCoWOwner(uint64_t page) {
+		if (cow_owners == nullptr) {
+			return true;
+		}
+		auto it = cow_owners->find(page);
+		if (it == cow_owners->end()) {
+			return true;
+		}
+		if (--it->second == 1) {
+			cow_owners->erase(it);
+		}
+		return false;
+	}
 }
 
 void InitializePaging() {
@@ -38,7 +67,7 @@ void SetupIdentityPageTable() {
 	}
 
 	ResetCR3();
-	SetCR0(GetCR0() & 0xfffeffff); // allow non-restricted writing for cpl < 3 (superviser mode)
+	SetCR0(GetCR0() | kCR0WriteProtect); // 커널이 cow 페이지에 써도 fault가 발생해서 공유 중인 페이지를 덮어쓰지 않는다
 }
 
 WithError<PageMapEntry*> NewPageMap() {
@@ -66,14 +95,14 @@ WithError<PageMapEntry*> SetNewPageMapIfNotPresent(PageMapEntry* entry) {
 	return { entry->ptr(), Error::kSuccess };
 }
 
-WithError<size_t> SetupPageMap(PageMapEntry* page_map, int page_map_level, LinearAddress4Level addr, size_t num_4kpages, bool writeable) {
+WithError<size_t> SetupPageMap(PageMapEntry* page_map, int page_map_level, LinearAddress4Level addr, size_t num_4kpages, bool writeable, bool user = true) {
 	while (num_4kpages > 0) {
 		const auto entry_index = addr.get(page_map_level);
 		auto [child_map, err] = SetNewPageMapIfNotPresent(&page_map[entry_index]);
 		if (err) {
 			return { num_4kpages, err };
 		}
-		page_map[entry_index].bits.user = 1;
+		page_map[entry_index].bits.user = user;
 
 		if (page_map_level == 1) {
 			page_map[entry_index].bits.writeable = writeable; // do copy on write
@@ -81,7 +110,7 @@ WithError<size_t> SetupPageMap(PageMapEntry* page_map, int page_map_level, Linea
 		}
 		else {
 			page_map[entry_index].bits.writeable = 1;
-			auto [num_remain_pages, err] = SetupPageMap(child_map, page_map_level - 1, addr, num_4kpages, writeable);
+			auto [num_remain_pages, err] = SetupPageMap(child_map, page_map_level - 1, addr, num_4kpages, writeable, user);
 			if (err) {
 				return { num_4kpages, err };
 			}
@@ -105,6 +134,93 @@ Error SetupPageMaps(LinearAddress4Level addr, size_t num_4kpages, bool writeable
 	return SetupPageMap(pml4_table, 4, addr, num_4kpages, writeable).error;
 }
 
+namespace {
+	// 현재 CR3에서 addr의 page table 엔트리. 중간 단계의 page map이 없으면 만든다
+	WithError<PageMapEntry*> UserPageEntry(LinearAddress4Level addr) {
+		auto table = reinterpret_cast<PageMapEntry*>(GetCR3());
+		for (int lvl = 4; lvl > 1; --lvl) {
+			auto& entry = table[addr.get(lvl)];
+			auto [ child_map, err ] = SetNewPageMapIfNotPresent(&entry);
+			if (err) {
+				return { nullptr, err };
+			}
+			entry.bits.user = 1;
+			entry.bits.writeable = 1;
+			table = child_map;
+		}
+		return { &table[addr.get(1)], MakeError(Error::kSuccess) };
+	}
+}
+
+Error MapSharedPage(LinearAddress4Level addr, void* page) {
+	auto [ entry, err ] = UserPageEntry(addr);
+	if (err) {
+		return err;
+	}
+
+	// 읽기 전용이고 cow가 아닌 페이지는 CleanPageMap이 해제하지 않는다
+	entry->data = 0;
+	entry->SetPtr(reinterpret_cast<PageMapEntry*>(page));
+	entry->bits.present = 1;
+	entry->bits.user = 1;
+	InvalidateTLB(addr.value);
+	return MakeError(Error::kSuccess);
+}
+
+Error MapSharedFrames(LinearAddress4Level addr, void* frames, size_t num_4kpages) {
+	InterruptDisabler guard; // 같은 주소 공간의 다른 스레드와 함께 page map을 만들지 않도록 한다
+	auto frame = reinterpret_cast<uint8_t*>(frames);
+	for (size_t i = 0; i < num_4kpages; i++) {
+		auto [ entry, err ] = UserPageEntry(addr);
+		if (err) {
+			UnmapSharedFrames(GetCR3(), LinearAddress4Level{addr.value - i * 4096}, i); // 이미 매핑한 부분을 되돌린다
+			return err;
+		}
+		entry->data = 0;
+		entry->SetPtr(reinterpret_cast<PageMapEntry*>(frame + i * 4096));
+		entry->bits.present = 1;
+		entry->bits.writeable = 1;
+		entry->bits.user = 1;
+		entry->bits.shared = 1;
+		InvalidateTLB(addr.value);
+		addr.value += 4096;
+	}
+	return MakeError(Error::kSuccess);
+}
+
+void UnmapSharedFrames(uint64_t cr3, LinearAddress4Level addr, size_t num_4kpages) {
+	InterruptDisabler guard;
+	// 다른 주소 공간의 TLB 항목은 CR3를 바꿀 때 비워지므로 현재 CR3일 때만 무효화한다
+	const bool current = cr3 == GetCR3();
+	for (size_t i = 0; i < num_4kpages; i++, addr.value += 4096) {
+		auto table = reinterpret_cast<PageMapEntry*>(cr3);
+		for (int lvl = 4; lvl > 1 && table; --lvl) {
+			const auto& entry = table[addr.get(lvl)];
+			table = entry.bits.present ? entry.ptr() : nullptr;
+		}
+		if (table && table[addr.get(1)].bits.shared) {
+			table[addr.get(1)].data = 0;
+			if (current) {
+				InvalidateTLB(addr.value);
+			}
+		}
+	}
+}
+
+bool IsSharedPage(LinearAddress4Level addr) {
+	auto table = reinterpret_cast<const PageMapEntry*>(GetCR3());
+	for (int lvl = 4; lvl > 1 && table; --lvl) {
+		const auto& entry = table[addr.get(lvl)];
+		table = entry.bits.present && !entry.bits.huge_page ? entry.ptr() : nullptr;
+	}
+	return table && table[addr.get(1)].bits.present && table[addr.get(1)].bits.shared;
+}
+
+Error SetupKernelPageMaps(LinearAddress4Level addr, size_t num_4kpages) {
+	auto kernel_pml4 = reinterpret_cast<PageMapEntry*>(&pml4_table[0]);
+	return SetupPageMap(kernel_pml4, 4, addr, num_4kpages, true, false).error;
+}
+
 Error CleanPageMap(PageMapEntry* page_map, int page_map_level) {
 	for (int i = 0; i < 512; i++) {
 		auto entry = page_map[i];
@@ -118,8 +234,12 @@ Error CleanPageMap(PageMapEntry* page_map, int page_map_level) {
 			}
 		}
 
-		if (entry.bits.writeable) { // only free copied pages
-			const auto entry_addr = reinterpret_cast<uintptr_t>(entry.ptr());
+		const auto entry_addr = reinterpret_cast<uintptr_t>(entry.ptr());
+		bool owned = entry.bits.writeable && !entry.bits.shared; // only free copied pages
+		if (page_map_level == 1 && entry.bits.cow) {
+			owned = DropCoWOwner(entry_addr);
+		}
+		if (owned) {
 			const FrameID entry_frame{ entry_addr / BytesPerFrame };
 			if (auto err = memory_manager->Free(entry_frame, 1)) {
 				return err;
@@ -144,9 +264,26 @@ Error CleanPageMaps(LinearAddress4Level addr) {
 	return memory_manager->Free(pdp_frame, 1);
 }
 
+Error CleanUserPageMaps() {
+	auto pml4_table = reinterpret_cast<PageMapEntry*>(GetCR3());
+	InterruptDisabler guard; // cow 소유자 수를 fault 처리와 함께 갱신한다
+	for (int i = 256; i < 512; i++) {
+		if (!pml4_table[i].bits.present) {
+			continue;
+		}
+		LinearAddress4Level addr{kUserSpaceBegin};
+		addr.bits.PML4 = i;
+		if (auto err = CleanPageMaps(addr)) {
+			return err;
+		}
+	}
+	return MakeError(Error::kSuccess);
+}
+
 Error CleanTempPML4(uint64_t pml4, int start) {
 	auto pml4_table = reinterpret_cast<PageMapEntry*>(pml4);
 	for (int i = start; i < 512; i++) {
+		if (!pml4_table[i].bits.present) continue;
 		auto pdp_table = pml4_table[i].ptr();
 		pml4_table[i].data = 0;
 		if (auto err = CleanPageMap(pdp_table, 3)) {
@@ -232,13 +369,46 @@ Error CopyOnePage(uint64_t vaddr) {
 	return SetPageContent(reinterpret_cast<PageMapEntry*>(GetCR3()), 4, LinearAddress4Level{vaddr}, p);
 }
 
+Error CopyOnWrite(uint64_t vaddr) {
+	// 시간 정보 페이지는 읽기 전용이다. 복사해주면 앱은 다시는 갱신되지 않는 사본을 읽게 된다
+	if ((vaddr & ~0xfffull) == TIME_PAGE_ADDR) {
+		return MakeError(Error::kBadAddress);
+	}
+	const LinearAddress4Level addr{vaddr};
+	InterruptDisabler guard; // 같은 주소 공간의 다른 스레드, fork와 함께 페이지 테이블을 갱신하지 않도록 한다
+
+	auto table = reinterpret_cast<PageMapEntry*>(GetCR3());
+	for (int lvl = 4; lvl > 1; --lvl) {
+		if (!table[addr.get(lvl)].bits.present) {
+			return MakeError(Error::kNoSuchEntry);
+		}
+		table = table[addr.get(lvl)].ptr();
+	}
+	auto& entry = table[addr.get(1)];
+	if (!entry.bits.present) {
+		return MakeError(Error::kNoSuchEntry);
+	}
+	if (entry.bits.writeable) { // 다른 스레드가 먼저 처리했다
+		return MakeError(Error::kSuccess);
+	}
+
+	if (entry.bits.cow) {
+		entry.bits.cow = 0;
+		if (DropCoWOwner(reinterpret_cast<uint64_t>(entry.ptr()))) { // 다른 주소 공간은 이미 복사본을 가졌다
+			entry.bits.writeable = 1;
+			InvalidateTLB(vaddr);
+			return MakeError(Error::kSuccess);
+		}
+	}
+	return CopyOnePage(vaddr);
+}
+
 Error HandlePageFault(uint64_t error_code, uint64_t cr2) {
 	auto& task = task_manager->CurrentTask();
 	const bool present = (error_code >> 0) & 1;
 	const bool rw = (error_code >> 1) & 1;
-	const bool user = (error_code >> 2) & 1;
-	if (present && rw && user) {
-		return CopyOnePage(cr2);	
+	if (present && rw && cr2 >= kUserSpaceBegin) { // 시스템콜 중 커널이 user 페이지에 쓴 경우도 포함한다
+		return CopyOnWrite(cr2);
 	} else if (present) {
 		return MakeError(Error::kAlreadyAllocated);
 	}
@@ -247,12 +417,35 @@ Error HandlePageFault(uint64_t error_code, uint64_t cr2) {
 		return SetupPageMaps(LinearAddress4Level{cr2}, 1, true);
 	}
 	if (auto m = FindFileMapping(task.FileMaps(), cr2)) {
-		return PreparePageCache(*task.files[m->fd], *m, cr2);
+		return PreparePageCache(*task.Files()[m->fd], *m, cr2);
 	}
 	
 	return MakeError(Error::kIndexOutOfRange);
 }
 
+WithError<uint64_t> LinearToPhysical(uint64_t vaddr, bool writeable) {
+	const LinearAddress4Level addr{vaddr};
+	auto table = reinterpret_cast<const PageMapEntry*>(GetCR3());
+	for (int lvl = 4; lvl >= 1; --lvl) {
+		const auto& entry = table[addr.get(lvl)];
+		if (!entry.bits.present) {
+			return { 0, MakeError(Error::kNoSuchEntry) };
+		}
+		if (lvl == 1 || entry.bits.huge_page) { // identity map은 2 MiB 페이지를 사용한다
+			if (writeable && !entry.bits.writeable && entry.bits.user) {
+				if (auto err = CopyOnWrite(vaddr)) {
+					return { 0, err };
+				}
+				return LinearToPhysical(vaddr, false);
+			}
+			const uint64_t page_bytes = PAGE_SIZE_4K << (9 * (lvl - 1));
+			return { (entry.bits.addr << 12 & ~(page_bytes - 1)) | (vaddr & (page_bytes - 1)), MakeError(Error::kSuccess) };
+		}
+		table = entry.ptr();
+	}
+	return { 0, MakeError(Error::kNoSuchEntry) };
+}
+
 Error CopyPageMaps(PageMapEntry* dst, const PageMapEntry* src, int pagemap_lvl, int start) {
 	if (pagemap_lvl == 1) {
 		for (int i = start; i < 512; i++) {
@@ -275,4 +468,54 @@ Error CopyPageMaps(PageMapEntry* dst, const PageMapEntry* src, int pagemap_lvl,
 		}
 	}
 	return MakeError(Error::kSuccess);
-}
\ No newline at end of file
+}
+namespace {
+	Error ForkPageMap(PageMapEntry* dst, PageMapEntry* src, int pagemap_lvl, int start) {
+		for (int i = start; i < 512; i++) {
+			if (!src[i].bits.present) continue;
+
+			if (pagemap_lvl == 1) {
+				if (src[i].bits.shared) { // 창 surface는 부모의 창에 속하므로 자식에게는 매핑하지 않는다
+					continue;
+				}
+				if (src[i].bits.writeable) {
+					src[i].bits.writeable = 0;
+					src[i].bits.cow = 1;
+				}
+				if (src[i].bits.cow) {
+					AddCoWOwner(reinterpret_cast<uint64_t>(src[i].ptr()));
+				}
+				dst[i] = src[i];
+				continue;
+			}
+
+			auto [ table, err ] = NewPageMap();
+			if (err) return err;
+			dst[i] = src[i];
+			dst[i].SetPtr(table);
+			if (auto err = ForkPageMap(table, src[i].ptr(), pagemap_lvl - 1, 0)) {
+				return err;
+			}
+		}
+		return MakeError(Error::kSuccess);
+	}
+}
+
+WithError<PageMapEntry*> ForkPML4() {
+	auto [ pml4, err ] = NewPageMap();
+	if (err) {
+		return { nullptr, err };
+	}
+	const auto cur_pml4 = reinterpret_cast<PageMapEntry*>(GetCR3());
+	memcpy(pml4, cur_pml4, 256 * sizeof(uint64_t)); // copy kernel space to new pml4
+
+	InterruptDisabler guard; // 복제하는 동안 같은 주소 공간의 다른 스레드가 쓰지 않도록 한다
+	err = ForkPageMap(pml4, cur_pml4, 4, 256);
+	SetCR3(GetCR3()); // 읽기 전용으로 바뀐 현재 주소 공간의 TLB를 비운다
+	if (err) {
+		// 이미 복제된 부분의 cow 공유 횟수도 함께 되돌린다
+		CleanTempPML4(reinterpret_cast<uint64_t>(pml4), 256);
+		return { nullptr, err };
+	}
+	return { pml4, err };
+}
@@ -17,7 +17,9 @@ union PageMapEntry {
 		uint64_t dirty : 1;
 		uint64_t huge_page : 1;
 		uint64_t global : 1;
-		uint64_t : 3;
+		uint64_t cow : 1;	// (OS 전용 비트) fork로 공유된 페이지. 쓰기 fault에서 복사하거나 마지막 소유자면 그대로 쓰기를 허용한다
+		uint64_t shared : 1;	// (OS 전용 비트) 커널이 소유한 페이지를 쓰기 가능으로 매핑했다 (창 surface). 해제하지 않고 fork한 자식에게 물려주지 않는다
+		uint64_t : 1;
 
 		uint64_t addr : 40;
 		uint64_t : 12;
@@ -60,12 +62,55 @@ union LinearAddress4Level {
 	}
 };
 
+constexpr uint64_t kUserSpaceBegin = 0xffff'8000'0000'0000; // PML4[256..511]
+constexpr uint64_t kCR0WriteProtect = 1u << 16; // 커널도 읽기 전용 페이지에 쓰면 fault가 발생한다
+
 void InitializePaging();
 void SetupIdentityPageTable();
 Error SetupPageMaps(LinearAddress4Level addr, size_t num_4kpages, bool writeable);
 Error CleanPageMaps(LinearAddress4Level addr);
+/**
+ * @brief 현재 CR3의 addr에 커널이 소유한 페이지를 user 읽기 전용으로 매핑합니다 (time_page.hpp 등)
+ */
+Error MapSharedPage(LinearAddress4Level addr, void* page);
+/**
+ * @brief 현재 CR3의 addr부터 커널이 소유한 연속된 프레임 frames를 user 쓰기 가능으로 매핑합니다 (window_surface.hpp).
+ * 페이지에 shared 비트를 붙이므로 앱이 종료되어도 프레임은 해제되지 않습니다
+ */
+Error MapSharedFrames(LinearAddress4Level addr, void* frames, size_t num_4kpages);
+/**
+ * @brief MapSharedFrames로 매핑한 페이지를 cr3 주소 공간에서 제거합니다.
+ * 현재 CR3가 아니어도 되므로 다른 Task(fork한 자식 등)나 앱 종료 처리에서도 호출할 수 있습니다
+ */
+void UnmapSharedFrames(uint64_t cr3, LinearAddress4Level addr, size_t num_4kpages);
+/** @brief 현재 CR3에서 addr가 MapSharedFrames로 매핑된 페이지면 true */
+bool IsSharedPage(LinearAddress4Level addr);
+/**
+ * @brief 커널 PML4(identity map)에 supervisor 전용 페이지를 매핑합니다.
+ * SetupPML4는 PML4의 하위 256개 엔트리를 복사하므로, 앱 PML4를 만들기 전에 PDPT가 생성된 영역은 모든 주소 공간에서 공유됩니다.
+ */
+Error SetupKernelPageMaps(LinearAddress4Level addr, size_t num_4kpages);
 Error CleanTempPML4(uint64_t pml4, int start);
 WithError<PageMapEntry*> SetupPML4(Task& cur_task);
 Error FreePML4(Task& cur_task);
 Error HandlePageFault(uint64_t error_code, uint64_t cr2);
-Error CopyPageMaps(PageMapEntry* dst, const PageMapEntry* src, int pagemap_lvl, int start);
\ No newline at end of file
+/**
+ * @brief 현재 CR3의 페이지 테이블을 따라가 vaddr의 물리 주소를 구합니다.
+ * writeable이 true면 읽기 전용(copy-on-write) 페이지를 먼저 복사해서, 이후 쓰기로 물리 주소가 바뀌지 않게 합니다.
+ * @return 매핑되지 않은 주소면 kNoSuchEntry
+ */
+WithError<uint64_t> LinearToPhysical(uint64_t vaddr, bool writeable = false);
+Error CopyPageMaps(PageMapEntry* dst, const PageMapEntry* src, int pagemap_lvl, int start);
+/**
+ * @brief 커널 영역은 현재 CR3와 공유하고 user 영역은 copy-on-write로 복제한 새 PML4를 만듭니다 (fork). CR3는 바꾸지 않습니다.
+ * 쓰기 가능한 페이지는 양쪽 모두 읽기 전용 + cow로 바뀌고 공유 횟수가 기록되며, 먼저 쓰는 쪽이 복사본을 갖습니다.
+ */
+WithError<PageMapEntry*> ForkPML4();
+/**
+ * @brief 현재 CR3의 user 영역(PML4[256..511])의 페이지와 페이지 테이블을 모두 해제합니다. cow 페이지는 마지막 소유자일 때만 해제됩니다
+ */
+Error CleanUserPageMaps();
+/**
+ * @brief 읽기 전용 user 페이지에 대한 쓰기를 처리합니다. 다른 주소 공간과 공유 중이면 복사하고, 아니면 쓰기를 허용합니다
+ */
+Error CopyOnWrite(uint64_t vaddr);
\ No newline at end of file
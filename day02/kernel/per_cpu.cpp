@@ -0,0 +1,3 @@
+#include "per_cpu.hpp"
+
+extern "C" PerCPU per_cpu { &per_cpu, nullptr, 0, 0 };
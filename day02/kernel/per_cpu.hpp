@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+class Task;
+
+/*
+ * CPU별 데이터 (CPU는 하나뿐이다).
+ * SyscallEntry는 swapgs로 GS base를 이 블록으로 바꿔서 C++ 함수를 호출하지 않고 커널 스택을 찾는다.
+ * 인터럽트 핸들러는 swapgs를 하지 않으므로 SyscallEntry는 스택을 바꾸자마자 GS base를 되돌리며,
+ * 그 외의 커널 코드는 per_cpu를 직접 참조한다.
+ */
+struct PerCPU {
+	PerCPU* self;			// $00
+	Task* current_task;		// $08 실행 중인 Task (Task 전환 시 인터럽트 금지 상태에서 갱신)
+	uint64_t kernel_stack;	// $10 시스템콜이 사용할 스택 (current_task의 os_stack_ptr)
+	uint64_t user_rsp;		// $18 SyscallEntry가 스택을 바꾸는 동안 user rsp를 보관
+};
+
+// asmfunc.asm의 PERCPU_* 오프셋과 일치해야 한다
+static_assert(offsetof(PerCPU, current_task) == 0x08);
+static_assert(offsetof(PerCPU, kernel_stack) == 0x10);
+static_assert(offsetof(PerCPU, user_rsp) == 0x18);
+
+extern "C" PerCPU per_cpu;
+
+/**
+ * @brief 현재 Task를 반환합니다. per_cpu.current_task는 하나의 포인터이고 선점되더라도 같은 Task로 돌아오므로,
+ * TaskManager::CurrentTask와 달리 인터럽트를 금지하지 않고 호출할 수 있습니다.
+ */
+inline Task& CPUCurrentTask() {
+	return *per_cpu.current_task;
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <cstddef>
 #include <array>
+#include <atomic>
 #include "error.hpp"
 #include "interrupt.hpp"
 
@@ -35,6 +36,73 @@ private:
 	size_t rear = 0;
 };
 
+/**
+ * @brief 크기가 고정된 lock-free multi-producer single-consumer 큐 (Vyukov bounded queue).
+ * 각 칸의 seq가 (위치)면 비어 있고 (위치 + 1)이면 값이 채워진 상태이다.
+ * push는 인터럽트를 끄지 않고 Task와 인터럽트 핸들러 어디에서나 호출할 수 있으며, pop은 한 Task에서만 호출해야 한다.
+ * producer가 칸을 예약한 뒤 값을 쓰기 전에 선점되면, 그 칸이 채워질 때까지 consumer에게는 큐가 비어 있는 것으로 보인다.
+ */
+template <typename T, size_t N>
+class MPSCQueue {
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of two");
+public:
+	MPSCQueue() {
+		for (size_t i = 0; i < N; i++) {
+			cells[i].seq.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	// 큐가 가득 찬 경우 false를 반환한다
+	bool try_push(const T& x) {
+		size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+		Cell* cell;
+		while (true) {
+			cell = &cells[pos & (N - 1)];
+			const size_t seq = cell->seq.load(std::memory_order_acquire);
+			const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+			if (diff == 0) {
+				if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+			} else if (diff < 0) {
+				return false;
+			} else {
+				pos = enqueue_pos.load(std::memory_order_relaxed);
+			}
+		}
+		cell->data = x;
+		cell->seq.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	// 꺼낼 값이 없는 경우 false를 반환한다 (consumer 전용)
+	bool try_pop(T& x) {
+		Cell& cell = cells[dequeue_pos & (N - 1)];
+		if (cell.seq.load(std::memory_order_acquire) != dequeue_pos + 1) return false;
+		x = cell.data;
+		cell.seq.store(dequeue_pos + N, std::memory_order_release);
+		dequeue_pos++;
+		return true;
+	}
+
+	// consumer 전용. 맨 앞 칸이 예약만 되고 아직 채워지지 않은 경우에도 true를 반환한다
+	bool empty() const {
+		return cells[dequeue_pos & (N - 1)].seq.load(std::memory_order_acquire) != dequeue_pos + 1;
+	}
+	bool full() const {
+		const size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+		return static_cast<intptr_t>(cells[pos & (N - 1)].seq.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos) < 0;
+	}
+	constexpr size_t capacity() const { return N; }
+
+private:
+	struct Cell {
+		std::atomic<size_t> seq;
+		T data;
+	};
+	std::array<Cell, N> cells;
+	std::atomic<size_t> enqueue_pos {0};
+	size_t dequeue_pos {0};
+};
+
 // T가 동적 할당된 경우 POP 시 container 내부에 존재하기 때문에 유의
 template <typename T, size_t N>
 struct ArrayPriorityQueue {
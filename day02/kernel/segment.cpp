@@ -6,11 +6,15 @@
 
 namespace {
 	std::array<SegmentDescriptor, 7> gdt;
-	std::array<uint32_t, 26> tss;
 
 	static_assert((kTSS >> 3) + 1 < gdt.size());
 }
 
+extern "C" {
+	// CallApp(asmfunc.asm)이 user mode로 진입할 때 rsp0를 직접 갱신한다
+	std::array<uint32_t, 26> tss;
+}
+
 void SetCodeSegment(SegmentDescriptor& desc, DescriptorType type, unsigned int descriptor_privilege_level, uint32_t base, uint32_t limit) {
 	desc.data = 0;
 
@@ -56,6 +60,11 @@ void InitializeSegmentation() {
 	SetSegRegs(kKernelSS, kKernelCS);
 }
 
+void SetTSSRsp0(uint64_t rsp0) {
+	tss[1] = rsp0 & 0xffffffff;
+	tss[2] = rsp0 >> 32;
+}
+
 void InitializeTSS() {
 	auto alloc_stack = [](size_t num_4kframes) -> uintptr_t {
 		auto stack = memory_manager->Allocate(num_4kframes);
@@ -73,6 +82,7 @@ void InitializeTSS() {
 
 	set_tss(1, alloc_stack(8)); // rsp0
 	set_tss(7 + 2 * kISTForTimer, alloc_stack(8)); // ist1
+	set_tss(7 + 2 * kISTForDoubleFault, alloc_stack(4)); // ist2
 
 	uint64_t tss_addr = reinterpret_cast<uint64_t>(&tss[0]);
 	SetSystemSegment(gdt[kTSS >> 3], DescriptorType::TSSAvailable, 0, tss_addr & 0xffffffff, sizeof(tss)-1);
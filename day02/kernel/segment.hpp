@@ -37,7 +37,13 @@ constexpr uint16_t kKernelDS = 0;
 constexpr uint16_t kTSS = 5 << 3;
 
 constexpr uint16_t kISTForTimer = 1;
+constexpr uint16_t kISTForDoubleFault = 2; // 커널 스택 overflow로 #PF를 처리할 스택이 없을 때 사용
 
 void SetupSegments();
 void InitializeSegmentation();
 void InitializeTSS();
+/**
+ * @brief user mode에서 인터럽트가 발생했을 때 사용할 커널 스택을 설정합니다.
+ * 앱 Task로 전환할 때마다 해당 Task의 os_stack_ptr로 바뀌므로, 여러 앱 Task가 같은 스택을 덮어쓰지 않습니다
+ */
+void SetTSSRsp0(uint64_t rsp0);
@@ -0,0 +1,104 @@
+#include "stack_pool.hpp"
+#include "paging.hpp"
+#include "task.hpp"
+#include "logger.hpp"
+#include "interrupt.hpp"
+#include <cstdlib>
+
+KernelStackPool* kernel_stack_pool;
+
+namespace {
+	constexpr int kNumPrewarmStacks = 4;
+}
+
+KernelStackPool::KernelStackPool() {
+	for (int c = 0; c < kNumClasses; c++) {
+		classes[c].next_slot = ClassBegin(c);
+	}
+}
+
+int KernelStackPool::SizeClass(size_t bytes) {
+	int c = 0;
+	while (c < kNumClasses && ClassBytes(c) < bytes) {
+		c++;
+	}
+	return c;
+}
+
+WithError<KernelStack> KernelStackPool::Allocate(size_t bytes) {
+	const int c = SizeClass(bytes);
+	if (c >= kNumClasses) {
+		return { {}, MakeError(Error::kIndexOutOfRange) };
+	}
+
+	InterruptDisabler guard; // Task 종료(인터럽트 금지)와 Task 생성(인터럽트 허용) 양쪽에서 호출된다
+	auto& cls = classes[c];
+	KernelStack stack{0, ClassBytes(c)};
+	if (cls.free_head) {
+		stack.bottom = cls.free_head;
+		cls.free_head = *reinterpret_cast<uint64_t*>(stack.bottom);
+		--cls.num_free;
+		++pool_hits;
+	} else {
+		const uint64_t bottom = cls.next_slot + kGuardBytes;
+		if (bottom + stack.bytes > ClassBegin(c + 1)) {
+			return { {}, MakeError(Error::kNoEnoughMemory) };
+		}
+		if (auto err = SetupKernelPageMaps(LinearAddress4Level{bottom}, stack.bytes / kMinStackBytes)) {
+			return { {}, err };
+		}
+		stack.bottom = bottom;
+		cls.next_slot = bottom + stack.bytes;
+		mapped_bytes += stack.bytes;
+		++pool_misses;
+	}
+	++live;
+	return { stack, MakeError(Error::kSuccess) };
+}
+
+void KernelStackPool::Free(const KernelStack& stack) {
+	if (stack.bottom == 0) {
+		return;
+	}
+
+	InterruptDisabler guard;
+	auto& cls = classes[SizeClass(stack.bytes)];
+	*reinterpret_cast<uint64_t*>(stack.bottom) = cls.free_head;
+	cls.free_head = stack.bottom;
+	++cls.num_free;
+	--live;
+}
+
+bool KernelStackPool::IsGuardPage(uint64_t addr) const {
+	if (addr < kRegionBegin || addr >= ClassBegin(kNumClasses)) {
+		return false;
+	}
+	const int c = (addr - kRegionBegin) / kClassRegionBytes;
+	return (addr - ClassBegin(c)) % (kGuardBytes + ClassBytes(c)) < kGuardBytes;
+}
+
+KernelStackStat KernelStackPool::Stat() const {
+	KernelStackStat stat{live, 0, mapped_bytes, pool_hits, pool_misses};
+	for (const auto& cls : classes) {
+		stat.pooled += cls.num_free;
+	}
+	return stat;
+}
+
+void InitializeKernelStackPool() {
+	kernel_stack_pool = new KernelStackPool;
+
+	// 여기서 처음 매핑하면서 PML4[1]의 PDPT가 만들어지고, 이후 생성되는 앱 PML4에도 그대로 복사된다
+	KernelStack stacks[kNumPrewarmStacks];
+	for (auto& stack : stacks) {
+		auto [s, err] = kernel_stack_pool->Allocate(Task::kDefaultStackBytes);
+		if (err) {
+			Log(kError, "failed to map kernel stack: %s\n", err.Name());
+			exit(1);
+		}
+		stack = s;
+	}
+	for (const auto& stack : stacks) {
+		kernel_stack_pool->Free(stack);
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include "error.hpp"
+
+/* Task의 커널 스택. bottom 바로 아래에는 매핑되지 않은 guard page가 있어 overflow 시 즉시 fault가 발생한다 */
+struct KernelStack {
+	uint64_t bottom {0}; // 사용 가능한 가장 낮은 주소 (0이면 할당되지 않은 상태)
+	size_t bytes {0};
+
+	uint64_t Top() const { return bottom + bytes; }
+};
+
+struct KernelStackStat {
+	size_t live;			// Task가 사용 중인 스택 수
+	size_t pooled;			// free list에서 재사용을 기다리는 스택 수
+	size_t mapped_bytes;	// 스택에 매핑된 물리 메모리 (guard page 제외)
+	uint64_t pool_hits;		// free list에서 꺼내서 할당한 횟수
+	uint64_t pool_misses;	// 새로 매핑해서 할당한 횟수
+};
+
+/**
+ * @brief 커널 스택 전용 가상 주소 영역(PML4[1])을 관리합니다.
+ * 크기 class(4 KiB ~ 1 MiB, 2의 거듭제곱)마다 32 GiB의 영역을 두고 [guard page | stack] 슬롯을 순서대로 잘라 쓴다.
+ * 반납된 스택은 매핑을 유지한 채 class별 free list에 들어가므로, 재할당은 리스트에서 하나 꺼내는 것으로 끝난다.
+ */
+class KernelStackPool {
+public:
+	static constexpr uint64_t kRegionBegin = 0x0000'0080'0000'0000; // identity map(PML4[0]) 바로 다음 PML4 엔트리
+	static constexpr uint64_t kClassRegionBytes = 0x0000'0008'0000'0000; // 32 GiB
+	static constexpr size_t kGuardBytes = 4096;
+	static constexpr size_t kMinStackBytes = 4096;
+	static constexpr int kNumClasses = 9; // 4 KiB, 8 KiB, ..., 1 MiB
+	static constexpr size_t kMaxStackBytes = kMinStackBytes << (kNumClasses - 1);
+
+	KernelStackPool();
+
+	/**
+	 * @brief bytes 이상의 크기를 갖는 스택을 할당합니다. 크기는 2의 거듭제곱 페이지 수로 올림됩니다
+	 * @return 할당된 스택. 크기가 kMaxStackBytes를 넘거나 물리 메모리가 부족하면 에러를 반환합니다
+	 */
+	WithError<KernelStack> Allocate(size_t bytes);
+	/**
+	 * @brief 스택을 free list에 반납합니다. 매핑은 해제하지 않습니다
+	 */
+	void Free(const KernelStack& stack);
+	/**
+	 * @brief addr가 커널 스택의 guard page에 속하는지 확인합니다 (fault handler에서 overflow 판별용)
+	 */
+	bool IsGuardPage(uint64_t addr) const;
+	KernelStackStat Stat() const;
+
+private:
+	struct ClassState {
+		uint64_t free_head {0}; // 반납된 스택의 bottom. 다음 원소의 bottom은 스택의 첫 8바이트에 저장된다
+		uint64_t next_slot {0}; // 아직 한 번도 사용하지 않은 다음 슬롯
+		size_t num_free {0};
+	};
+	std::array<ClassState, kNumClasses> classes {};
+	size_t live {0};
+	size_t mapped_bytes {0};
+	uint64_t pool_hits {0}, pool_misses {0};
+
+	static int SizeClass(size_t bytes);
+	static constexpr size_t ClassBytes(int c) { return kMinStackBytes << c; }
+	static constexpr uint64_t ClassBegin(int c) { return kRegionBegin + c * kClassRegionBytes; }
+};
+
+extern KernelStackPool* kernel_stack_pool;
+
+/**
+ * @brief 커널 스택 영역을 준비합니다. 앱의 PML4가 만들어지기 전(InitTask 이전)에 호출해야 합니다.
+ */
+void InitializeKernelStackPool();
@@ -7,10 +7,24 @@
 #include "font.hpp"
 #include "app_event.hpp"
 #include "keyboard.hpp"
+#include "futex.hpp"
+#include "per_cpu.hpp"
+#include "syscall_ring.hpp"
+#include "paging.hpp"
+#include "fpu.hpp"
+#include "uaccess.hpp"
+#include "syscall_trace.hpp"
+#include "iovec.hpp"
+#include "win_blit.hpp"
+#include "win_surface.hpp"
+#include "win_draw.hpp"
 #include <cstdint>
 #include <cstring>
+#include <cstdio>
+#include <cstdlib>
 #include <cerrno>
 #include <array>
+#include <iterator>
 #include <cmath>
 #include <fcntl.h>
 
@@ -18,7 +32,8 @@ void InitializeSyscall() {
 	WriteMSR(kIA32_EFER, 0x0501u); // enable syscall
 	WriteMSR(kIA32_LSTAR, reinterpret_cast<uint64_t>(SyscallEntry)); // register syscalls
 	WriteMSR(kIA32_STAR, static_cast<uint64_t>(8) << 32 | static_cast<uint64_t>(16 | 3) << 48); // set (CS, SS) to (8, 8+8) on syscall | (16+16 | 3, 16+8 | 3) on sysret
-	WriteMSR(kIA32_FMASK, 0);
+	WriteMSR(kIA32_FMASK, kRFlagsIF); // SyscallEntry는 커널 스택으로 바꿀 때까지 인터럽트를 금지한 채로 실행된다
+	WriteMSR(kIA32_KERNEL_GS_BASE, reinterpret_cast<uint64_t>(&per_cpu)); // user mode에서 swapgs하면 GS base가 된다
 }
 
 namespace syscall {
@@ -45,6 +60,11 @@ to see if the requested bytes are mapped, or else you can just access them and h
 Linux switched to doing the latter from version 2.6 onwards.
 
 */
+	constexpr int kSpawnMaxArgs = 32; // RunApp의 argv 크기
+	constexpr size_t kMaxStringBytes = 1024; // 시스템콜이 받는 문자열의 최대 길이 (NUL 제외)
+	constexpr size_t kIOChunkBytes = 4096; // 파일 I/O 시스템콜이 커널 스택의 버퍼를 거쳐 user 버퍼와 주고받는 단위
+	constexpr size_t kNoOffset = SIZE_MAX; // ReadToUser/WriteFromUser: 파일 위치를 사용한다
+
 	bool VaildatePointer(const void* p) {
 		return reinterpret_cast<uintptr_t>(p) >= 0xffff'8000'0000'0000; // cannoical address check (true if user space)
 	}
@@ -52,17 +72,26 @@ Linux switched to doing the latter from version 2.6 onwards.
 		return p >= 0xffff'8000'0000'0000;
 	}
 
+	// user 문자열 s를 buf로 복사한다. 성공하면 0, 실패하면 errno (읽을 수 없으면 EFAULT, buf에 들어가지 않으면 E2BIG)
+	template <size_t N>
+	int CopyStringFromUser(char (&buf)[N], const char* s) {
+		const int64_t len = StrncpyFromUser(buf, s, N);
+		if (len < 0) {
+			return EFAULT;
+		}
+		if (static_cast<size_t>(len) == N) {
+			return E2BIG;
+		}
+		return 0;
+	}
+
 	SYSCALL(LogString) {
 		if (arg1 != kError && arg1 != kWarn && arg1 != kInfo && arg1 != kDebug) {
 			return { 0, EINVAL };
 		}
-		if (!VaildatePointer(arg2)) {
-			return { 0, EFAULT };
-		}
-		const char* s = reinterpret_cast<const char*>(arg2);
-
-		if (strlen(s) > 1024) {
-			return { 0, E2BIG };
+		char s[kMaxStringBytes + 1];
+		if (int err = CopyStringFromUser(s, reinterpret_cast<const char*>(arg2))) {
+			return { 0, err };
 		}
 		Log(static_cast<LogLevel>(arg1), "%s", s);
 		return { 0, 0 };
@@ -76,60 +105,171 @@ Linux switched to doing the latter from version 2.6 onwards.
 	//	return { 0, 0 };
 	//}
 
-	SYSCALL(PutString) {
-		if (!VaildatePointer(arg2)) {
-			return { 0, EFAULT };
+	::FileDescriptor* FindFD(Task& task, int fd) {
+		if (fd < 0 || fd >= task.Files().size()) {
+			return nullptr;
 		}
+		return task.Files()[fd].get();
+	}
 
-		const int fd = arg1;
-		const char* s = reinterpret_cast<const char*>(arg2);
-		const size_t len = arg3;		
+	/*
+	 * fd에서 읽은 데이터를 user 버퍼 buf로 옮긴다. offset이 kNoOffset이면 파일 위치에서 읽고(Read), 아니면 offset부터 읽는다(Load).
+	 * 파이프/터미널은 한 번의 Read가 요청을 다 채우지 못하면 다음 Read에서 잠들 수 있으므로 거기서 멈춘다
+	 */
+	Result ReadToUser(::FileDescriptor& fd, uint8_t* buf, size_t count, size_t offset) {
+		if (!AccessOK(buf, count)) {
+			return { 0, EFAULT };
+		}
+		std::array<uint8_t, kIOChunkBytes> kbuf;
+		size_t total = 0;
+		while (total < count) {
+			const size_t chunk = std::min(count - total, kbuf.size());
+			const size_t n = offset == kNoOffset
+				? fd.Read(kbuf.data(), chunk)
+				: fd.Load(kbuf.data(), chunk, offset + total);
+			if (CopyToUser(buf + total, kbuf.data(), n)) {
+				return { total, EFAULT };
+			}
+			total += n;
+			if (n < chunk) {
+				break;
+			}
+		}
+		return { total, 0 };
+	}
 
-		if (len > 1024) {
-			return { 0, E2BIG };
+	/*
+	 * user 버퍼 buf의 데이터를 fd에 쓴다. offset이 kNoOffset이면 파일 위치에 쓰고(Write), 아니면 offset부터 쓴다(Store).
+	 * 파일 끝이 fat::kMaxFileBytes를 넘게 되면 EFBIG, 볼륨이 가득 차서 한 바이트도 쓰지 못하면 ENOSPC
+	 */
+	Result WriteFromUser(::FileDescriptor& fd, const uint8_t* buf, size_t count, size_t offset) {
+		if (!AccessOK(buf, count)) {
+			return { 0, EFAULT };
+		}
+		if (fd.Seekable() && count > 0) {
+			const size_t start = offset == kNoOffset ? fd.Offset() : offset;
+			if (start > fat::kMaxFileBytes || count > fat::kMaxFileBytes - start) {
+				return { 0, EFBIG };
+			}
+		}
+		std::array<uint8_t, kIOChunkBytes> kbuf;
+		size_t total = 0;
+		while (total < count) {
+			const size_t chunk = std::min(count - total, kbuf.size());
+			if (CopyFromUser(kbuf.data(), buf + total, chunk)) {
+				return { total, EFAULT };
+			}
+			const size_t n = offset == kNoOffset
+				? fd.Write(kbuf.data(), chunk)
+				: fd.Store(kbuf.data(), chunk, offset + total);
+			total += n;
+			if (n < chunk) {
+				break;
+			}
 		}
+		if (fd.Seekable() && total == 0 && count > 0) {
+			return { 0, ENOSPC };
+		}
+		return { total, 0 };
+	}
 
-		__asm__("cli");
-		auto& task = task_manager->CurrentTask();
-		__asm__("sti");
+	SYSCALL(PutString) {
+		const int fd = arg1;
+		const auto buf = reinterpret_cast<const uint8_t*>(arg2);
+		const size_t len = arg3;
 
-		if (fd < 0 || fd >= task.files.size() || !task.files[fd]) {
+		auto file = FindFD(CPUCurrentTask(), fd);
+		if (!file) {
 			return { 0, EBADF };
 		}
-
-		auto n = task.files[fd]->Write(s, len);
-		return { n, 0 };
+		return WriteFromUser(*file, buf, len, kNoOffset);
 	}
 
 	SYSCALL(Exit) {
-		__asm__("cli");
-		auto& task = task_manager->CurrentTask();
-		__asm__("sti");
+		auto& task = CPUCurrentTask();
 
 		return { task.os_stack_ptr, static_cast<int>(arg1) };
 	}
 
-	SYSCALL(OpenWindow) {
-		if (!VaildatePointer(arg5)) {
-			return { 0, EFAULT };
+	namespace {
+		// win의 내부 영역을 WindowSurface로 만들어 현재 앱의 주소 공간에 매핑하고 usurface에 정보를 채운다
+		int AttachSurface(TitleBarWindow& win, WinSurface* usurface) {
+			const auto size = win.InnerSize();
+			if (size.x <= 0 || size.y <= 0) {
+				return EINVAL;
+			}
+			auto [ surface, err ] = WindowSurface::New(size, kScreenConfig.pixel_format);
+			if (err) {
+				return ENOMEM;
+			}
+
+			// MapFile처럼 파일 매핑 영역의 아래쪽에 주소를 할당한다
+			auto& task = CPUCurrentTask();
+			const uint64_t vaddr = task.FileMapEnd() - WindowSurface::kNumBuffers * surface->BufferBytes();
+			if (surface->Map(vaddr)) {
+				return ENOMEM;
+			}
+			task.SetFileMapEnd(vaddr);
+
+			WinSurface info{};
+			for (int i = 0; i < WindowSurface::kNumBuffers; i++) {
+				info.buffers[i] = reinterpret_cast<uint32_t*>(vaddr + i * surface->BufferBytes());
+			}
+			info.width = size.x;
+			info.height = size.y;
+			info.stride = size.x;
+			// BGR 형식은 메모리에 B, G, R 순서이므로 uint32_t로 읽으면 0x00RRGGBB가 된다
+			info.format = kScreenConfig.pixel_format == kPixelBGRResv8BitPerColor ? WIN_SURFACE_XRGB8888 : WIN_SURFACE_XBGR8888;
+			info.back = surface->Back();
+			if (!PutUser(usurface, info)) {
+				surface->Unmap();
+				return EFAULT;
+			}
+
+			win.SetSurface(std::move(surface), TitleBarWindow::TopLeftMargin);
+			return 0;
 		}
 
-		const int w = arg1, h = arg2, x = arg3, y = arg4;
-		const auto title = reinterpret_cast<const char*>(arg5);
-		const auto win = std::make_shared<TitleBarWindow>(title, w, h, kScreenConfig.pixel_format);
+		Result DoOpenWindow(int w, int h, int x, int y, const char* utitle, WinSurface* usurface) {
+			char title[kMaxStringBytes + 1];
+			if (int err = CopyStringFromUser(title, utitle)) {
+				return { 0, err };
+			}
 
-		__asm__("cli");
-		const auto layerID = kLayerManager->NewLayer().SetWindow(win).SetDraggable(true).SetPosAbsolute({x,y}).ID();
-		active_layer->Activate(layerID);
-		
-		const auto taskID = task_manager->CurrentTask().ID();
-		layer_task_map->insert(std::make_pair(layerID, taskID));
-		__asm__("sti");
+			const auto win = std::make_shared<TitleBarWindow>(title, w, h, kScreenConfig.pixel_format);
+			if (usurface) {
+				if (int err = AttachSurface(*win, usurface)) {
+					return { 0, err };
+				}
+			}
 
-		return {layerID, 0};
+			__asm__("cli");
+			const auto layerID = kLayerManager->NewLayer().SetWindow(win).SetDraggable(true).SetPosAbsolute({x,y}).ID();
+			active_layer->Activate(layerID);
+			
+			const auto taskID = task_manager->CurrentTask().ID();
+			layer_task_map->insert(std::make_pair(layerID, taskID));
+			__asm__("sti");
+
+			return {layerID, 0};
+		}
+	}
+
+	SYSCALL(OpenWindow) {
+		return DoOpenWindow(arg1, arg2, arg3, arg4, reinterpret_cast<const char*>(arg5), nullptr);
+	}
+
+	SYSCALL(OpenWindowSurface) {
+		const auto usurface = reinterpret_cast<WinSurface*>(arg6);
+		if (usurface == nullptr) {
+			return { 0, EFAULT };
+		}
+		return DoOpenWindow(arg1, arg2, arg3, arg4, reinterpret_cast<const char*>(arg5), usurface);
 	}
 
 	namespace {
+		constexpr uint64_t kLayerNoDraw = uint64_t{1} << 32; // LAYER_NO_DRAW (apps/syscall.h)
+
 		template <class Func, class... Args>
 		Result DoWinFunc(Func f, uint64_t layerID_w_flags, Args... args) {
 			const auto layer_flags = static_cast<uint32_t>(layerID_w_flags >> 32);
@@ -146,9 +286,7 @@ Linux switched to doing the latter from version 2.6 onwards.
 			}
 			
 			if ((layer_flags & 1) == 0) {
-				__asm__("cli");
-				kLayerManager->Draw(layerID);
-				__asm__("sti");
+				DamageLayer(layerID);
 			}
 
 			return res;
@@ -156,20 +294,240 @@ Linux switched to doing the latter from version 2.6 onwards.
 	}
 
 	SYSCALL(WinWriteString) {
+		char s[kMaxStringBytes + 1];
+		if (int err = CopyStringFromUser(s, reinterpret_cast<const char*>(arg5))) {
+			return { 0, err };
+		}
 		return DoWinFunc([](Window& win, int x, int y, uint32_t color, const char* s) {
-			if (!VaildatePointer(s)) return Result {0, EFAULT};
 			font::WriteString(*win.Writer(), {x, y}, s, ToColor(color));
 			return Result {0, 0};
-		}, arg1, arg2, arg3, arg4, reinterpret_cast<const char*>(arg5));
+		}, arg1, arg2, arg3, arg4, static_cast<const char*>(s));
 	}
 
 	SYSCALL(WinFillRect) {
 		return DoWinFunc([](Window& win, int x, int y, int w, int h, uint32_t color) {
-			FillRect(*win.Writer(), {Vector2D<int>{x,y}, Vector2D<int>{w,h}}, ToColor(color));
+			win.FillRect({Vector2D<int>{x,y}, Vector2D<int>{w,h}}, color);
 			return Result {0, 0};
 		}, arg1, arg2, arg3, arg4, arg5, arg6);
 	}
 
+	namespace {
+		/**
+		 * @brief user 이미지 uimage를 창의 (x, y)에 복사합니다. clip(창 좌표, 창 안쪽이어야 함) 밖은 잘라냅니다
+		 * @param drawn 실제로 쓴 영역
+		 * @return errno
+		 */
+		int BlitToWindow(Window& win, int x, int y, const WinBlitImage* uimage, const Rect<int>& clip, Rect<int>& drawn) {
+			drawn = {{0, 0}, {0, 0}};
+			WinBlitImage image;
+			if (!GetUser(image, uimage)) {
+				return EFAULT;
+			}
+			const int64_t stride = image.stride ? image.stride : image.width;
+			if (image.width < 0 || image.height < 0 || stride < image.width) {
+				return EINVAL;
+			}
+			std::optional<uint32_t> color_key;
+			if (image.flags & WIN_BLIT_COLOR_KEY) {
+				color_key = image.color_key;
+			}
+
+			const auto clip_end = clip.pos + clip.size;
+			const int x0 = std::max(x, clip.pos.x), y0 = std::max(y, clip.pos.y);
+			const int x1 = std::min<int64_t>(static_cast<int64_t>(x) + image.width, clip_end.x);
+			const int y1 = std::min<int64_t>(static_cast<int64_t>(y) + image.height, clip_end.y);
+			if (x0 >= x1 || y0 >= y1) {
+				return 0;
+			}
+
+			// 한 줄을 256픽셀씩 커널 스택으로 복사한 뒤 변환해서 쓴다 (최소 스택 4KiB에 맞춘 크기)
+			std::array<uint32_t, 256> row;
+			for (int py = y0; py < y1; py++) {
+				const uint32_t* src = image.pixels + (py - y) * stride + (x0 - x);
+				for (int px = x0; px < x1; px += row.size()) {
+					const int n = std::min<int>(x1 - px, row.size());
+					if (CopyFromUser(row.data(), src + (px - x0), sizeof(uint32_t) * n)) {
+						drawn = {{x0, y0}, {x1 - x0, py - y0 + 1}};
+						return EFAULT;
+					}
+					win.WritePixels({px, py}, row.data(), n, color_key);
+				}
+			}
+			drawn = {{x0, y0}, {x1 - x0, y1 - y0}};
+			return 0;
+		}
+	}
+
+	SYSCALL(WinBlit) {
+		const auto layer_flags = static_cast<uint32_t>(arg1 >> 32);
+		const auto layerID = static_cast<uint32_t>(arg1);
+		const auto uimage = reinterpret_cast<const WinBlitImage*>(arg4);
+
+		// 레이어 전체 대신 실제로 쓴 영역만 다시 그린다
+		Rect<int> drawn{{0, 0}, {0, 0}};
+		const auto res = DoWinFunc([&drawn](Window& win, int x, int y, const WinBlitImage* uimage) {
+			const int err = BlitToWindow(win, x, y, uimage, {{0, 0}, win.Size()}, drawn);
+			return Result {0, err};
+		}, layerID | kLayerNoDraw, arg2, arg3, uimage);
+
+		// 중간에 실패해도 이미 쓴 부분은 화면에 반영한다
+		if (res.error != EBADF && (layer_flags & 1) == 0 && drawn.size.x > 0 && drawn.size.y > 0) {
+			DamageLayer(layerID, drawn);
+		}
+		return res;
+	}
+
+	namespace {
+		// clip 밖의 픽셀은 버리는 Writer (WinDraw)
+		class ClipWriter : public PixelWriter {
+		public:
+			ClipWriter(Window& win, const Rect<int>& clip) : win{win}, clip{clip} {}
+			virtual void Write(Vector2D<int> pos, const PixelColor& c) override {
+				const auto rel = pos - clip.pos;
+				if (0 <= rel.x && rel.x < clip.size.x && 0 <= rel.y && rel.y < clip.size.y) {
+					win.Write(pos, c);
+				}
+			}
+			virtual int Width() const override { return win.Width(); }
+			virtual int Height() const override { return win.Height(); }
+		private:
+			Window& win;
+			const Rect<int>& clip;
+		};
+
+		// p0에서 p1까지 끝점을 포함해 선을 긋는다 (Bresenham)
+		void DrawLine(PixelWriter& writer, Vector2D<int> p0, Vector2D<int> p1, const PixelColor& c) {
+			const int dx = std::abs(p1.x - p0.x), sx = p0.x < p1.x ? 1 : -1;
+			const int dy = -std::abs(p1.y - p0.y), sy = p0.y < p1.y ? 1 : -1;
+			int err = dx + dy;
+			for (;;) {
+				writer.Write(p0, c);
+				if (p0.x == p1.x && p0.y == p1.y) {
+					break;
+				}
+				const int e2 = 2 * err;
+				if (e2 >= dy) {
+					err += dy;
+					p0.x += sx;
+				}
+				if (e2 <= dx) {
+					err += dx;
+					p0.y += sy;
+				}
+			}
+		}
+
+		// 문자열이 차지하는 칸 수 (반각 1칸, 전각 2칸)
+		int TextColumns(const char* s) {
+			int columns = 0;
+			while (*s) {
+				const auto [ u32, bytes ] = font::ConvertUTF8to32(s);
+				columns += font::IsHankaku(u32) ? 1 : 2;
+				s += bytes;
+			}
+			return columns;
+		}
+
+		bool ValidDrawCmd(const WinDrawCmd& cmd) {
+			auto in_range = [](int32_t v) { return -WIN_DRAW_MAX_COORD <= v && v <= WIN_DRAW_MAX_COORD; };
+			return cmd.op < WIN_DRAW_NUM_OPS &&
+				in_range(cmd.x) && in_range(cmd.y) && in_range(cmd.w) && in_range(cmd.h);
+		}
+
+		/**
+		 * @brief 검사를 마친 명령 하나를 실행합니다
+		 * @param clip 현재 clip 영역 (WIN_DRAW_CLIP이 바꾼다)
+		 * @param damage 그린 영역을 합친다
+		 * @return errno
+		 */
+		int ExecDrawCmd(Window& win, const WinDrawCmd& cmd, Rect<int>& clip, Rect<int>& damage) {
+			const Rect<int> window_area{{0, 0}, win.Size()};
+			const Vector2D<int> pos{cmd.x, cmd.y};
+			switch (cmd.op) {
+				case WIN_DRAW_CLIP:
+					clip = (cmd.w < 0 || cmd.h < 0) ? window_area : (window_area & Rect<int>{pos, {cmd.w, cmd.h}});
+					return 0;
+				case WIN_DRAW_FILL_RECT: {
+					if (cmd.w <= 0 || cmd.h <= 0) {
+						return 0;
+					}
+					const auto area = clip & Rect<int>{pos, {cmd.w, cmd.h}};
+					win.FillRect(area, cmd.color);
+					damage = damage | area;
+					return 0;
+				}
+				case WIN_DRAW_LINE: {
+					const Vector2D<int> end{cmd.w, cmd.h};
+					ClipWriter writer{win, clip};
+					DrawLine(writer, pos, end, ToColor(cmd.color));
+					const auto top_left = ElementMin(pos, end);
+					damage = damage | (clip & Rect<int>{top_left, ElementMax(pos, end) - top_left + Vector2D<int>{1, 1}});
+					return 0;
+				}
+				case WIN_DRAW_TEXT: {
+					char s[WIN_DRAW_MAX_TEXT + 1];
+					const auto len = StrncpyFromUser(s, static_cast<const char*>(cmd.data), sizeof(s));
+					if (len < 0) {
+						return EFAULT;
+					}
+					if (len == sizeof(s)) {
+						return E2BIG;
+					}
+					ClipWriter writer{win, clip};
+					font::WriteString(writer, pos, s, ToColor(cmd.color));
+					damage = damage | (clip & Rect<int>{pos, {TextColumns(s) * font::FONT_WIDTH, font::FONT_HEIGHT}});
+					return 0;
+				}
+				case WIN_DRAW_BLIT: {
+					Rect<int> drawn;
+					const int err = BlitToWindow(win, cmd.x, cmd.y, static_cast<const WinBlitImage*>(cmd.data), clip, drawn);
+					damage = damage | drawn;
+					return err;
+				}
+			}
+			return EINVAL;
+		}
+	}
+
+	SYSCALL(WinDraw) {
+		const auto layer_flags = static_cast<uint32_t>(arg1 >> 32);
+		const auto layerID = static_cast<uint32_t>(arg1);
+		const auto ucmds = reinterpret_cast<const WinDrawCmd*>(arg2);
+		const size_t num_cmds = arg3;
+		if (num_cmds > WIN_DRAW_MAX_CMDS) {
+			return { 0, E2BIG };
+		}
+
+		// 명령을 묶음 단위로 커널 스택에 복사해서 한 번에 검사한 뒤 실행하고, 그린 영역의 합집합만 다시 그린다
+		Rect<int> damage{{0, 0}, {0, 0}};
+		const auto res = DoWinFunc([&damage, ucmds, num_cmds](Window& win) {
+			constexpr size_t kBatch = 32; // BlitToWindow의 줄 버퍼와 합쳐 2KiB 남짓 (최소 스택 4KiB)
+			std::array<WinDrawCmd, kBatch> cmds;
+			Rect<int> clip{{0, 0}, win.Size()};
+			for (size_t done = 0; done < num_cmds; ) {
+				const size_t n = std::min(num_cmds - done, kBatch);
+				if (CopyFromUser(cmds.data(), ucmds + done, n * sizeof(WinDrawCmd))) {
+					return Result {done, EFAULT};
+				}
+				if (!std::all_of(cmds.begin(), cmds.begin() + n, ValidDrawCmd)) {
+					return Result {done, EINVAL};
+				}
+				for (size_t i = 0; i < n; i++, done++) {
+					if (int err = ExecDrawCmd(win, cmds[i], clip, damage)) {
+						return Result {done, err};
+					}
+				}
+			}
+			return Result {num_cmds, 0};
+		}, layerID | kLayerNoDraw);
+
+		// 중간에 실패해도 이미 그린 부분은 화면에 반영한다
+		if (res.error != EBADF && (layer_flags & 1) == 0 && damage.size.x > 0 && damage.size.y > 0) {
+			DamageLayer(layerID, damage);
+		}
+		return res;
+	}
+
 	SYSCALL(GetCurrentTick) {
 		__asm__("cli");
 		auto tick = timer_manager->CurrentTick();
@@ -224,6 +582,29 @@ Linux switched to doing the latter from version 2.6 onwards.
 		}, arg1, arg2, arg3, arg4, arg5, arg6);
 	}
 
+	SYSCALL(WinCommit) {
+		const auto layer_flags = static_cast<uint32_t>(arg1 >> 32);
+		const auto layerID = static_cast<uint32_t>(arg1);
+		const int x = arg2, y = arg3, w = arg4, h = arg5;
+
+		// 레이어 전체 대신 damage 영역만 다시 그리도록 DoWinFunc에는 LAYER_NO_DRAW를 넘긴다
+		Rect<int> damage{{0, 0}, {0, 0}};
+		const auto res = DoWinFunc([&damage, x, y, w, h](Window& win) {
+			auto surface = win.Surface();
+			if (surface == nullptr) {
+				return Result {0, EINVAL};
+			}
+			const auto area = win.SurfaceArea();
+			damage = (w < 0 || h < 0) ? area : (area & Rect<int>{area.pos + Vector2D<int>{x, y}, {w, h}});
+			return Result {static_cast<uint64_t>(surface->Commit()), 0};
+		}, layerID | kLayerNoDraw);
+
+		if (res.error == 0 && (layer_flags & 1) == 0 && damage.size.x > 0 && damage.size.y > 0) {
+			DamageLayer(layerID, damage);
+		}
+		return res;
+	}
+
 	SYSCALL(CloseWindow) {
 		const unsigned int layer_id = static_cast<uint32_t>(arg1);
 		const auto layer = kLayerManager->FindLayer(layer_id);
@@ -234,82 +615,167 @@ Linux switched to doing the latter from version 2.6 onwards.
 
 		const auto layer_pos = layer->GetPos();
 		const auto win_size = layer->GetWindow()->Size();
+		if (auto surface = layer->GetWindow()->Surface()) {
+			surface->Unmap(); // 닫힌 창의 버퍼에 앱이 더 이상 쓰지 못하게 한다
+		}
 
 		__asm__("cli");
 		active_layer->Activate(0);
 		kLayerManager->RemoveLayer(layer_id);
-		kLayerManager->Draw({ layer_pos, win_size });
+		DamageScreen({ layer_pos, win_size });
 		layer_task_map->erase(layer_id);
 		__asm__("sti");
 
 		return { 0, 0 };
 	}
 
-	SYSCALL(ReadEvent) {
-		if (!VaildatePointer(arg1)) {
-			return { 0, EFAULT };
+	// 앱에 전달할 이벤트로 변환한다. 앱과 관계없는 메세지면 false
+	bool ToAppEvent(const Message& msg, AppEvent& event) {
+		switch (msg.type) {
+			case Message::KeyPush:
+				if (msg.arg.keyboard.keycode == 20 /* Q key */ && msg.arg.keyboard.modifier & (kLControlBitMask | kRControlBitMask)) {
+					event.type = AppEvent::kQuit;
+				}
+				else {
+					event.type = AppEvent::kKeyPush;
+					event.arg.keypush.modifier = msg.arg.keyboard.modifier;
+					event.arg.keypush.keycode = msg.arg.keyboard.keycode;
+					event.arg.keypush.ascii = msg.arg.keyboard.ascii;
+					event.arg.keypush.press = msg.arg.keyboard.press;
+				}
+				return true;
+			case Message::MouseMove:
+				event.type = AppEvent::kMouseMove;
+				event.arg.mouse_move.x = msg.arg.mouse_move.x;
+				event.arg.mouse_move.y = msg.arg.mouse_move.y;
+				event.arg.mouse_move.dx = msg.arg.mouse_move.dx;
+				event.arg.mouse_move.dy = msg.arg.mouse_move.dy;
+				event.arg.mouse_move.buttons = msg.arg.mouse_move.buttons;
+				return true;
+			case Message::MouseButton:
+				event.type = AppEvent::kMouseButton;
+				event.arg.mouse_button.x = msg.arg.mouse_button.x;
+				event.arg.mouse_button.y = msg.arg.mouse_button.y;
+				event.arg.mouse_button.press = msg.arg.mouse_button.press;
+				event.arg.mouse_button.button = msg.arg.mouse_button.button;
+				return true;
+			case Message::TimerTimeout:
+				if (msg.arg.timer.value < 0) {
+					event.type = AppEvent::kTimerTimeout;
+					event.arg.timer.timeout = msg.arg.timer.timeout;
+					event.arg.timer.value = -msg.arg.timer.value;
+					return true;
+				}
+				return false;
+			case Message::WindowClose:
+				event.type = AppEvent::kQuit;
+				return true;
+			default:
+				Log(kInfo, "uncaught event type: %u\n", msg.type);
+				return false;
 		}
+	}
 
-		const auto app_events = reinterpret_cast<AppEvent*>(arg1);
-		const size_t len = arg2;
+	namespace {
+		// ReadEvent의 타임아웃 Timer 값. 커널 Timer 값(작은 양수, kTaskTimerValue)과 겹치지 않는 양수이므로 ToAppEvent는 무시한다
+		constexpr int kReadEventTimeoutBase = 0x4000'0000;
+		int read_event_timeout_seq = 0; // 호출마다 값을 바꿔서 취소하지 못한 이전 호출의 타임아웃 메세지와 구분한다
+
+		// 버튼 상태가 같은 연속된 MouseMove를 last에 합친다
+		bool CoalesceMouseMove(AppEvent& last, const AppEvent& event) {
+			if (last.type != AppEvent::kMouseMove || event.type != AppEvent::kMouseMove ||
+			    last.arg.mouse_move.buttons != event.arg.mouse_move.buttons) {
+				return false;
+			}
+			last.arg.mouse_move.x = event.arg.mouse_move.x;
+			last.arg.mouse_move.y = event.arg.mouse_move.y;
+			last.arg.mouse_move.dx += event.arg.mouse_move.dx;
+			last.arg.mouse_move.dy += event.arg.mouse_move.dy;
+			return true;
+		}
 
-		__asm__("cli");
-		auto& task = task_manager->CurrentTask();
-		__asm__("sti");
+		Result DoReadEvent(AppEvent* app_events, size_t len, unsigned int flags, int timeout_ms) {
+			if (len > SIZE_MAX / sizeof(AppEvent) || !AccessOK(app_events, len * sizeof(AppEvent))) {
+				return { 0, EFAULT };
+			}
+
+			auto& task = CPUCurrentTask();
+
+			// 기다리는 시간에 제한이 있으면 그 시각에 이 Task로 타임아웃 메세지를 보낸다
+			int timeout_value = 0;
+			TimerID_t timer = kInvalidTimerID;
+			if (timeout_ms > 0) {
+				__asm__("cli");
+				timeout_value = kReadEventTimeoutBase + (read_event_timeout_seq++ & 0x0fff'ffff);
+				const unsigned long ticks = std::max(static_cast<unsigned long>(timeout_ms) * kTimerFreq / 1000, 1ul);
+				timer = timer_manager->AddTimer(Timer{timer_manager->CurrentTick() + ticks, timeout_value, task.ID()});
+				__asm__("sti");
+			}
 
-		size_t i = 0;
-		while (i < len) {
-			auto msg = task.Wait();
+			// 이벤트가 하나도 없을 때만 sleep하고, 그 뒤로는 이미 쌓여있는 메세지로 app_events를 최대한 채워서 반환한다.
+			// MouseMove를 합칠 수 있도록 마지막 이벤트(last)는 한 칸 늦게 app_events에 쓴다
+			std::array<Message, 32> msgs;
+			AppEvent last;
+			size_t num_last = 0; // last가 있으면 1
+			size_t i = 0;
+			bool timed_out = false;
+			int err = 0;
+			while (i + num_last < len && !timed_out && err == 0) {
+				const size_t max_msgs = std::min(len - i - num_last, msgs.size()); // 메세지 하나는 최대 1개의 이벤트가 된다
+				const size_t num_msgs = i + num_last == 0 && timeout_ms != READ_EVENT_NO_WAIT
+					? task.WaitMsgs(msgs.data(), max_msgs)
+					: task.ReceiveMsgs(msgs.data(), max_msgs);
+				if (num_msgs == 0) {
+					break;
+				}
 
-			switch (msg.type) {
-				case Message::KeyPush:
-					if (msg.arg.keyboard.keycode == 20 /* Q key */ && msg.arg.keyboard.modifier & (kLControlBitMask | kRControlBitMask)) {
-						app_events[i++].type = AppEvent::kQuit;
+				for (size_t j = 0; j < num_msgs && err == 0; j++) {
+					const auto& msg = msgs[j];
+					if (timeout_value && msg.type == Message::TimerTimeout && msg.arg.timer.value == timeout_value) {
+						timed_out = true;
+						continue;
 					}
-					else {
-						app_events[i].type = AppEvent::kKeyPush;
-						app_events[i].arg.keypush.modifier = msg.arg.keyboard.modifier;
-						app_events[i].arg.keypush.keycode = msg.arg.keyboard.keycode;
-						app_events[i].arg.keypush.ascii = msg.arg.keyboard.ascii;
-						app_events[i].arg.keypush.press = msg.arg.keyboard.press;
-						++i;
+					AppEvent event;
+					if (!ToAppEvent(msg, event)) {
+						continue;
 					}
-					break;
-				case Message::MouseMove:
-					app_events[i].type = AppEvent::kMouseMove;
-					app_events[i].arg.mouse_move.x = msg.arg.mouse_move.x;
-					app_events[i].arg.mouse_move.y = msg.arg.mouse_move.y;
-					app_events[i].arg.mouse_move.dx = msg.arg.mouse_move.dx;
-					app_events[i].arg.mouse_move.dy = msg.arg.mouse_move.dy;
-					app_events[i].arg.mouse_move.buttons = msg.arg.mouse_move.buttons;
-					++i;
-					break;
-				case Message::MouseButton:
-					app_events[i].type = AppEvent::kMouseButton;
-					app_events[i].arg.mouse_button.x = msg.arg.mouse_button.x;
-					app_events[i].arg.mouse_button.y = msg.arg.mouse_button.y;
-					app_events[i].arg.mouse_button.press = msg.arg.mouse_button.press;
-					app_events[i].arg.mouse_button.button = msg.arg.mouse_button.button;
-					++i;
-					break;
-				case Message::TimerTimeout:
-					if (msg.arg.timer.value < 0) {
-						app_events[i].type = AppEvent::kTimerTimeout;
-						app_events[i].arg.timer.timeout = msg.arg.timer.timeout;
-						app_events[i].arg.timer.value = -msg.arg.timer.value;
+					if (num_last && (flags & READ_EVENT_COALESCE_MOUSE) && CoalesceMouseMove(last, event)) {
+						continue;
+					}
+					if (num_last) {
+						if (!PutUser(&app_events[i], last)) {
+							err = EFAULT;
+							break;
+						}
 						++i;
 					}
-					break;
-				case Message::WindowClose:
-					app_events[i].type = AppEvent::kQuit;
+					last = event;
+					num_last = 1;
+				}
+			}
+
+			if (timer != kInvalidTimerID && !timed_out) {
+				__asm__("cli");
+				timer_manager->CancelTimer(timer); // 이미 만료되었으면 남은 메세지는 다음 호출에서 무시된다
+				__asm__("sti");
+			}
+			if (err == 0 && num_last) {
+				if (PutUser(&app_events[i], last)) {
 					++i;
-					break;
-				default:
-					Log(kInfo, "uncaught event type: %u\n", msg.type);
+				} else {
+					err = EFAULT;
+				}
 			}
+			return { i, err };
 		}
+	}
+
+	SYSCALL(ReadEvent) {
+		return DoReadEvent(reinterpret_cast<AppEvent*>(arg1), arg2, 0, READ_EVENT_WAIT_FOREVER);
+	}
 
-		return { i, 0 };
+	SYSCALL(ReadEventTimeout) {
+		return DoReadEvent(reinterpret_cast<AppEvent*>(arg1), arg2, arg3, arg4);
 	}
 
 	SYSCALL(CreateTimer) {
@@ -318,30 +784,59 @@ Linux switched to doing the latter from version 2.6 onwards.
 		if (timer_value <= 0) {
 			return { 0, EINVAL };
 		}
+		const auto timer_id = reinterpret_cast<TimerID_t*>(arg4);
+		if (timer_id && !AccessOK(timer_id, sizeof(TimerID_t))) {
+			return { 0, EFAULT };
+		}
 
-		__asm__("cli");
-		const uint64_t task_id = task_manager->CurrentTask().ID();
-		__asm__("sti");
+		const uint64_t task_id = CPUCurrentTask().ID();
 
 		unsigned long timeout = arg3 * kTimerFreq / 1000;
+		unsigned long period = 0;
+		const unsigned long slack = (mode >> 16) * kTimerFreq / 1000;
 		if (mode & 1) {
 			timeout += timer_manager->CurrentTick();
 		}
+		if (mode & 2) {
+			period = std::max(arg3 * kTimerFreq / 1000, 1ul);
+		}
 
 		__asm__("cli");
-		timer_manager->AddTimer(Timer{timeout, -timer_value, task_id});
+		const TimerID_t id = timer_manager->AddTimer(Timer{timeout, -timer_value, task_id, period, slack});
 		__asm__("sti");
+		if (timer_id && !PutUser(timer_id, id)) {
+			__asm__("cli");
+			timer_manager->CancelTimer(id);
+			__asm__("sti");
+			return { 0, EFAULT };
+		}
 		return { timeout * 1000 / kTimerFreq, 0 };
 	}
 
+	SYSCALL(CancelTimer) {
+		const TimerID_t timer_id = arg1;
+
+		__asm__("cli");
+		const uint64_t task_id = task_manager->CurrentTask().ID();
+		const Timer* timer = timer_manager->FindTimer(timer_id);
+		// 다른 Task의 Timer나 커널 Timer는 취소할 수 없다
+		if (timer == nullptr || timer->TaskID() != task_id || timer->Value() >= 0) {
+			__asm__("sti");
+			return { 0, EINVAL };
+		}
+		timer_manager->CancelTimer(timer_id);
+		__asm__("sti");
+		return { 0, 0 };
+	}
+
 	size_t AllocateFD(Task& task) {
-		const size_t num_files = task.files.size();
+		const size_t num_files = task.Files().size();
 		for (size_t i = 0; i < num_files; ++i) {
-			if (!task.files[i]) {
+			if (!task.Files()[i]) {
 				return i;
 			}
 		}
-		task.files.emplace_back();
+		task.Files().emplace_back();
 		return num_files;
 	}
 
@@ -356,14 +851,12 @@ Linux switched to doing the latter from version 2.6 onwards.
 	}
 
 	SYSCALL(OpenFile) {
-		if (!VaildatePointer(arg1)) {
-			return { 0, EFAULT };
+		char path[kMaxStringBytes + 1];
+		if (int err = CopyStringFromUser(path, reinterpret_cast<const char*>(arg1))) {
+			return { 0, err };
 		}
-		const auto path = reinterpret_cast<const char*>(arg1);
 		const int flags = arg2;
-		__asm__("cli");
-		auto& task = task_manager->CurrentTask();
-		__asm__("sti");
+		auto& task = CPUCurrentTask();
 
 		if (strcmp(path, "@stdin") == 0) {
 			return { 0, 0 };
@@ -383,34 +876,152 @@ Linux switched to doing the latter from version 2.6 onwards.
 		}
 
 		size_t fd = AllocateFD(task);
-		task.files[fd] = std::make_unique<fat::FileDescriptor>(*file);
+		task.Files()[fd] = std::make_unique<fat::FileDescriptor>(*file);
 		return { fd, 0 };
 	}
 
 	SYSCALL(ReadFile) {
-		if (!VaildatePointer(arg2)) {
-			return { 0, EFAULT };
+		const int fd = arg1;
+		const auto buf = reinterpret_cast<uint8_t*>(arg2);
+		const size_t count = arg3;
+
+		auto file = FindFD(CPUCurrentTask(), fd);
+		if (!file) {
+			return { 0, EBADF };
 		}
+		return ReadToUser(*file, buf, count, kNoOffset);
+	}
+
+	SYSCALL(PRead) {
 		const int fd = arg1;
-		const auto buf = reinterpret_cast<void*>(arg2);
-		size_t count = arg3;
+		const auto buf = reinterpret_cast<uint8_t*>(arg2);
+		const size_t count = arg3, offset = arg4;
 
-		__asm__("cli");
-		auto& task = task_manager->CurrentTask();
-		__asm__("sti");
+		auto file = FindFD(CPUCurrentTask(), fd);
+		if (!file) {
+			return { 0, EBADF };
+		}
+		if (!file->Seekable()) {
+			return { 0, ESPIPE };
+		}
+		if (static_cast<int64_t>(offset) < 0) {
+			return { 0, EINVAL };
+		}
+		return ReadToUser(*file, buf, count, offset);
+	}
+
+	SYSCALL(PWrite) {
+		const int fd = arg1;
+		const auto buf = reinterpret_cast<const uint8_t*>(arg2);
+		const size_t count = arg3, offset = arg4;
+
+		auto file = FindFD(CPUCurrentTask(), fd);
+		if (!file) {
+			return { 0, EBADF };
+		}
+		if (!file->Seekable()) {
+			return { 0, ESPIPE };
+		}
+		if (static_cast<int64_t>(offset) < 0) {
+			return { 0, EINVAL };
+		}
+		return WriteFromUser(*file, buf, count, offset);
+	}
+
+	SYSCALL(Seek) {
+		const int fd = arg1;
+		const int64_t offset = arg2;
+		const int whence = arg3;
 
-		if (fd < 0 || fd >= task.files.size() || !task.files[fd])
+		auto file = FindFD(CPUCurrentTask(), fd);
+		if (!file) {
 			return { 0, EBADF };
-		
-		size_t n = task.files[fd]->Read(buf, count);
-		return { n, 0 };
+		}
+		if (!file->Seekable()) {
+			return { 0, ESPIPE };
+		}
+
+		int64_t base;
+		switch (whence) {
+			case SEEK_SET: base = 0; break;
+			case SEEK_CUR: base = file->Offset(); break;
+			case SEEK_END: base = file->Size(); break;
+			default: return { 0, EINVAL };
+		}
+		int64_t new_offset;
+		if (__builtin_add_overflow(base, offset, &new_offset)) {
+			return { 0, EOVERFLOW };
+		}
+		if (new_offset < 0) {
+			return { 0, EINVAL };
+		}
+		file->SetOffset(new_offset);
+		return { static_cast<uint64_t>(new_offset), 0 };
+	}
+
+	SYSCALL(CloseFile) {
+		const int fd = arg1;
+		auto& task = CPUCurrentTask();
+		if (!FindFD(task, fd)) {
+			return { 0, EBADF };
+		}
+		// 매핑된 파일의 페이지는 page fault 때 fd로 읽어오므로 닫을 수 없다
+		for (const auto& m : task.FileMaps()) {
+			if (m.fd == fd) {
+				return { 0, EBUSY };
+			}
+		}
+		task.Files()[fd].reset();
+		return { 0, 0 };
+	}
+
+	namespace {
+		// iov의 버퍼를 차례로 f(file, base, len)로 처리한다. 버퍼를 다 채우지 못하면 거기서 멈춘다
+		template <class Func>
+		Result DoVectoredIO(uint64_t fd, uint64_t iov_addr, uint64_t iovcnt, Func f) {
+			const auto iov = reinterpret_cast<const IOVec*>(iov_addr);
+			if (iovcnt > IOV_MAX_COUNT) {
+				return { 0, EINVAL };
+			}
+			auto file = FindFD(CPUCurrentTask(), fd);
+			if (!file) {
+				return { 0, EBADF };
+			}
+
+			uint64_t total = 0;
+			for (size_t i = 0; i < iovcnt; i++) {
+				IOVec v;
+				if (!GetUser(v, &iov[i])) {
+					return { total, EFAULT };
+				}
+				const auto res = f(*file, reinterpret_cast<uint8_t*>(v.base), v.len);
+				total += res.value;
+				if (res.error) {
+					return { total, res.error };
+				}
+				if (res.value < v.len) {
+					break;
+				}
+			}
+			return { total, 0 };
+		}
+	}
+
+	SYSCALL(ReadV) {
+		return DoVectoredIO(arg1, arg2, arg3, [](::FileDescriptor& file, uint8_t* buf, size_t len) {
+			return ReadToUser(file, buf, len, kNoOffset);
+		});
+	}
+
+	SYSCALL(WriteV) {
+		return DoVectoredIO(arg1, arg2, arg3, [](::FileDescriptor& file, uint8_t* buf, size_t len) {
+			return WriteFromUser(file, buf, len, kNoOffset);
+		});
 	}
 
 	SYSCALL(DemandPages) {
 		const size_t num_pages = arg1;
-		__asm__("cli");
-		auto& task = task_manager->CurrentTask();
-		__asm__("sti");
+		auto& task = CPUCurrentTask();
 
 		const uint64_t dp_end = task.DPagingEnd();
 		task.SetDPagingEnd(dp_end + 4096 * num_pages);
@@ -420,28 +1031,385 @@ Linux switched to doing the latter from version 2.6 onwards.
 	SYSCALL(MapFile) {
 		const int fd = arg1;
 		size_t* file_size = reinterpret_cast<size_t*>(arg2);
-		__asm__("cli");
-		auto& task = task_manager->CurrentTask();
-		__asm__("sti");
+		auto& task = CPUCurrentTask();
 
-		if (fd < 0 || fd >= task.files.size() || !task.files[fd]) {
+		if (fd < 0 || fd >= task.Files().size() || !task.Files()[fd]) {
 			return { 0, EBADF };
 		}
 
-		*file_size = task.files[fd]->Size();
+		const size_t size = task.Files()[fd]->Size();
+		if (!PutUser(file_size, size)) {
+			return { 0, EFAULT };
+		}
 		const uint64_t vaddr_end = task.FileMapEnd();
-		const uint64_t vaddr_begin = (vaddr_end - *file_size) & ~static_cast<uint64_t>(0xfff);
+		const uint64_t vaddr_begin = (vaddr_end - size) & ~static_cast<uint64_t>(0xfff);
 		task.SetFileMapEnd(vaddr_begin);
 		task.FileMaps().push_back(FileMapping{ fd, vaddr_begin, vaddr_end });
 		return { vaddr_begin, 0 };
 	}
 
+	SYSCALL(GetTaskUsage) {
+		const auto usage = reinterpret_cast<TaskUsage*>(arg1);
+
+		__asm__("cli");
+		const TaskUsage current = task_manager->CurrentUsage();
+		__asm__("sti");
+		if (!PutUser(usage, current)) {
+			return { 0, EFAULT };
+		}
+		return { tsc_freq, 0 };
+	}
+
+	int FutexErrno(const Error& err) {
+		switch (err.GetCode()) {
+			case Error::kSuccess: return 0;
+			case Error::kTryAgain: return EAGAIN;
+			case Error::kInvalidFormat: return EINVAL;
+			case Error::kNoEnoughMemory: return ENOMEM;
+			default: return EFAULT;
+		}
+	}
+
+	SYSCALL(FutexWait) {
+		const auto uaddr = reinterpret_cast<const uint32_t*>(arg1);
+		if (!VaildatePointer(uaddr)) {
+			return { 0, EFAULT };
+		}
+		const uint32_t val = arg2;
+		return { 0, FutexErrno(::FutexWait(uaddr, val)) };
+	}
+
+	SYSCALL(FutexWake) {
+		const auto uaddr = reinterpret_cast<const uint32_t*>(arg1);
+		const int n = arg2;
+		if (!VaildatePointer(uaddr)) {
+			return { 0, EFAULT };
+		}
+		if (n < 0) {
+			return { 0, EINVAL };
+		}
+		auto [ woken, err ] = ::FutexWake(uaddr, n);
+		return { static_cast<uint64_t>(woken), FutexErrno(err) };
+	}
+
+	namespace {
+		struct ThreadStart {
+			uint64_t entry, arg, stack_top;
+		};
+
+		// 스레드 Task의 entry point. 앱을 시작한 Task의 주소 공간에서 entry(0, arg)를 실행한다
+		void TaskAppThread(TaskID_t task_id, int64_t data) {
+			const auto start = *reinterpret_cast<ThreadStart*>(data);
+			delete reinterpret_cast<ThreadStart*>(data);
+
+			__asm__("cli");
+			Task& task = task_manager->CurrentTask();
+			task_manager->AccountCurrentTask(true);
+			__asm__("sti");
+			const int ret = CallApp(0, reinterpret_cast<char**>(start.arg), 3 << 3 | 3, start.entry, start.stack_top, &task.os_stack_ptr);
+
+			__asm__("cli");
+			task_manager->AccountCurrentTask(false);
+			timer_manager->CancelAppTimers(task_id);
+			auto& space = task.Space();
+			if (--space.num_threads == 0 && space.exit_waiter) {
+				task_manager->Wakeup(space.exit_waiter);
+			}
+			task_manager->Finish(ret);
+		}
+	}
+
+	SYSCALL(ThreadCreate) {
+		const uint64_t entry = arg1, arg = arg2, stack_top = arg3, fs_base = arg4;
+		if (!VaildatePointer(entry) || !VaildatePointer(stack_top) || (fs_base && !VaildatePointer(fs_base))) {
+			return { 0, EFAULT };
+		}
+
+		auto& task = CPUCurrentTask();
+
+		// CR3는 InitContext에서 현재 CR3(이 앱의 PML4)로 설정된다
+		const auto start = new ThreadStart{entry, arg, (stack_top & ~0xful) - 8};
+		Task& thread = task_manager->NewTask()
+			.InitContext(TaskAppThread, reinterpret_cast<int64_t>(start))
+			.ShareSpace(task)
+			.SetFSBase(fs_base);
+
+		__asm__("cli");
+		auto& space = task.Space();
+		space.threads.push_back(thread.ID());
+		++space.num_threads;
+		thread.Wakeup();
+		__asm__("sti");
+		return { thread.ID(), 0 };
+	}
+
+	SYSCALL(ThreadJoin) {
+		const TaskID_t thread_id = arg1;
+
+		__asm__("cli");
+		auto& task = task_manager->CurrentTask();
+		auto& threads = task.Space().threads;
+		auto it = std::find(threads.begin(), threads.end(), thread_id);
+		if (thread_id == task.ID()) {
+			__asm__("sti");
+			return { 0, EDEADLK };
+		}
+		if (it == threads.end()) { // 다른 앱의 Task이거나 이미 join된 스레드
+			__asm__("sti");
+			return { 0, ESRCH };
+		}
+		threads.erase(it);
+		auto [ exit_code, err ] = task_manager->WaitFinish(thread_id, true);
+		if (err) { // 앱이 종료 중이다. 남은 스레드는 ReleaseAppSpace가 회수한다
+			threads.push_back(thread_id);
+			__asm__("sti");
+			return { 0, EINTR };
+		}
+		__asm__("sti");
+		return { static_cast<uint64_t>(exit_code), 0 };
+	}
+
+	SYSCALL(SetFSBase) {
+		const uint64_t fs_base = arg1;
+		if (fs_base && !VaildatePointer(fs_base)) {
+			return { 0, EFAULT };
+		}
+
+		__asm__("cli");
+		task_manager->SetCurrentFSBase(fs_base);
+		__asm__("sti");
+		return { 0, 0 };
+	}
+
+	namespace {
+		// SyscallFork가 커널 스택에 저장한 user 레지스터
+		struct ForkFrame {
+			uint64_t rbx, r12, r13, r14, r15;
+			const uint64_t* user_frame; // SyscallEntry가 커널 스택에 저장한 syscall index, r11(rflags), rcx(rip), rbp, rsp
+		};
+
+		// fork로 만든 Task의 entry point. 부모와 같은 위치에서 user mode를 재개한다
+		void TaskForkChild(TaskID_t task_id, int64_t data) {
+			const auto regs = *reinterpret_cast<std::array<uint64_t, 9>*>(data);
+			delete reinterpret_cast<std::array<uint64_t, 9>*>(data);
+
+			__asm__("cli");
+			Task& task = task_manager->CurrentTask();
+			task_manager->AccountCurrentTask(true);
+			__asm__("sti");
+			const int ret = ResumeApp(regs.data(), &task.os_stack_ptr);
+
+			__asm__("cli");
+			task_manager->AccountCurrentTask(false);
+			__asm__("sti");
+			if (auto err = ReleaseAppSpace(task)) {
+				Log(kError, "failed to release forked task %lu: %s\n", task_id, err.Name());
+			}
+			__asm__("cli");
+			task_manager->Finish(ret);
+		}
+	}
+
+	// fork: asmfunc.asm의 SyscallFork가 user 레지스터를 모아서 호출한다
+	extern "C" Result DoFork(const ForkFrame* frame) {
+		const auto user = frame->user_frame;
+		const auto regs = new std::array<uint64_t, 9>{
+			user[2], user[1], user[4], // rip, rflags, rsp
+			frame->rbx, user[3], frame->r12, frame->r13, frame->r14, frame->r15,
+		};
+
+		auto [ pml4, err ] = ForkPML4();
+		if (err) {
+			delete regs;
+			return { 0, ENOMEM };
+		}
+
+		Task& parent = CPUCurrentTask();
+		Task& child = task_manager->NewTask()
+			.InitContext(TaskForkChild, reinterpret_cast<int64_t>(regs))
+			.SetFSBase(parent.FSBase());
+		child.Context().cr3 = reinterpret_cast<uint64_t>(pml4);
+
+		// 파일 디스크립터는 부모와 공유하고, 가상 메모리 영역 정보는 복사한다 (스레드는 복제되지 않는다)
+		auto& space = child.Space();
+		const auto& parent_space = parent.Space();
+		space.files = parent_space.files;
+		space.dpaging_begin = parent_space.dpaging_begin;
+		space.dpaging_end = parent_space.dpaging_end;
+		space.file_map_end = parent_space.file_map_end;
+		space.file_maps = parent_space.file_maps;
+
+		__asm__("cli");
+		if (fpu_owner == &parent.Context()) { // 부모의 최신 FPU 상태는 레지스터에 있다
+			SaveFPUState(child.Context().fpu_area);
+		} else {
+			memcpy(child.Context().fpu_area, parent.Context().fpu_area, fpu_area_size);
+		}
+		parent.Space().children.push_back(child.ID());
+		child.Wakeup();
+		__asm__("sti");
+		return { child.ID(), 0 };
+	}
+	extern "C" SYSCALL(SyscallFork);
+
+	SYSCALL(WaitChild) {
+		const TaskID_t child_id = arg1;
+
+		__asm__("cli");
+		auto& children = task_manager->CurrentTask().Space().children;
+		auto it = std::find(children.begin(), children.end(), child_id);
+		if (it == children.end()) { // fork로 만든 자식이 아니거나 이미 wait한 Task
+			__asm__("sti");
+			return { 0, ECHILD };
+		}
+		children.erase(it);
+		auto [ exit_code, err ] = task_manager->WaitFinish(child_id, true);
+		if (err) { // 앱이 종료 중이다. 자식은 ReleaseAppSpace가 Detach한다
+			children.push_back(child_id);
+			__asm__("sti");
+			return { 0, EINTR };
+		}
+		__asm__("sti");
+		return { static_cast<uint64_t>(exit_code), 0 };
+	}
+
+	SYSCALL(Spawn) {
+		const auto argv = reinterpret_cast<const char* const*>(arg2);
+		const auto ufds = reinterpret_cast<const int*>(arg3);
+
+		char path[kMaxStringBytes + 1];
+		if (int err = CopyStringFromUser(path, reinterpret_cast<const char*>(arg1))) {
+			return { 0, err };
+		}
+		std::array<int, 3> fds { 0, 1, 2 };
+		if (ufds && CopyFromUser(fds.data(), ufds, sizeof(fds))) {
+			return { 0, EFAULT };
+		}
+
+		auto file = FindCommand(path);
+		if (!file) {
+			return { 0, ENOENT };
+		}
+
+		// argv[0]부터 공백으로 이어 붙인다. 앱의 argv는 RunApp이 다시 공백으로 나눠서 만든다
+		std::string command_line;
+		char arg[kMaxStringBytes + 1];
+		for (int i = 0; argv; i++) {
+			const char* uarg;
+			if (!GetUser(uarg, &argv[i])) {
+				return { 0, EFAULT };
+			}
+			if (!uarg) {
+				break;
+			}
+			if (i >= kSpawnMaxArgs) {
+				return { 0, E2BIG };
+			}
+			if (int err = CopyStringFromUser(arg, uarg)) {
+				return { 0, err };
+			}
+			if (i > 0) {
+				command_line += ' ';
+			}
+			command_line += arg;
+		}
+		if (command_line.empty()) {
+			command_line = path;
+		}
+
+		auto& task = CPUCurrentTask();
+		std::array<std::shared_ptr<::FileDescriptor>, 3> files;
+		for (int i = 0; i < 3; i++) {
+			const int fd = fds[i];
+			if (fd < 0 || fd >= task.Files().size() || !task.Files()[fd]) {
+				return { 0, EBADF };
+			}
+			files[i] = task.Files()[fd];
+		}
+
+		auto& child = task_manager->NewTask();
+		__asm__("cli");
+		task.Space().children.push_back(child.ID());
+		__asm__("sti");
+		SpawnApp(child, file, std::move(command_line), std::move(files));
+		return { child.ID(), 0 };
+	}
+
+	// 아무 일도 하지 않는 시스템콜. 시스템콜 왕복 시간 측정에도 사용한다 (apps/syscallbench)
+	SYSCALL(GetTaskID) {
+		return { CPUCurrentTask().ID(), 0 };
+	}
+
+	Result DispatchRingEntry(const SyscallRingEntry& e);
+
+	SYSCALL(RingEnter) {
+		const auto ring = reinterpret_cast<SyscallRing*>(arg1);
+		SyscallRing hdr;
+		if (CopyFromUser(&hdr, ring, sizeof(hdr))) {
+			return { 0, EFAULT };
+		}
+		const uint32_t sq_cap = hdr.sq_capacity, cq_cap = hdr.cq_capacity;
+		if (sq_cap == 0 || (sq_cap & (sq_cap - 1)) || cq_cap == 0 || (cq_cap & (cq_cap - 1))) {
+			return { 0, EINVAL };
+		}
+
+		// head/tail은 앱의 다른 스레드와 공유하므로 한 번의 4바이트 접근으로 읽고 쓴다.
+		// x86에서는 일반 load/store가 acquire/release이므로 tail을 읽은 뒤에 읽는 항목은 앱이 채운 값이다
+		uint32_t sq_tail;
+		if (!GetUser32(&ring->sq_tail, sq_tail)) {
+			return { 0, EFAULT };
+		}
+		uint32_t sq_head = hdr.sq_head;
+		uint32_t cq_tail = hdr.cq_tail;
+		if (sq_tail - sq_head > sq_cap) {
+			return { 0, EINVAL };
+		}
+
+		uint64_t num_done = 0;
+		while (sq_head != sq_tail) {
+			// completion을 넣을 자리가 없으면 멈추고, 앱이 completion을 꺼낸 뒤 다시 제출하게 한다
+			uint32_t cq_head;
+			if (!GetUser32(&ring->cq_head, cq_head)) {
+				return { num_done, EFAULT };
+			}
+			if (cq_tail - cq_head >= cq_cap) {
+				break;
+			}
+
+			SyscallRingEntry e;
+			if (!GetUser(e, &hdr.sqes[sq_head & (sq_cap - 1)])) {
+				return { num_done, EFAULT };
+			}
+			const auto res = DispatchRingEntry(e);
+			++sq_head;
+			++num_done;
+			if (res.error || (e.flags & SYSCALL_RING_SKIP_SUCCESS) == 0) {
+				const SyscallRingCompletion c { e.user_data, res.value, res.error, 0 };
+				if (!PutUser(&hdr.cqes[cq_tail & (cq_cap - 1)], c)) {
+					return { num_done, EFAULT };
+				}
+				++cq_tail;
+				if (!PutUser32(&ring->cq_tail, cq_tail)) {
+					return { num_done, EFAULT };
+				}
+			}
+			if (!PutUser32(&ring->sq_head, sq_head)) {
+				return { num_done, EFAULT };
+			}
+		}
+
+		if (num_done == 0 && sq_head != sq_tail) {
+			return { 0, EBUSY };
+		}
+		return { num_done, 0 };
+	}
+
 	#undef SYSCALL
 }
 
 using SyscallType = syscall::Result (uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t);
 
-extern "C" std::array<SyscallType*, 0x10> syscall_table {
+extern "C" SyscallType* syscall_table[] {
 	/* 0x00 */ syscall::LogString,
 	/* 0x01 */ syscall::PutString,
 	/* 0x02 */ syscall::Exit,
@@ -458,4 +1426,43 @@ extern "C" std::array<SyscallType*, 0x10> syscall_table {
 	/* 0x0d */ syscall::ReadFile,
 	/* 0x0e */ syscall::DemandPages,
 	/* 0x0f */ syscall::MapFile,
-};
\ No newline at end of file
+	/* 0x10 */ syscall::CancelTimer,
+	/* 0x11 */ syscall::GetTaskUsage,
+	/* 0x12 */ syscall::FutexWait,
+	/* 0x13 */ syscall::FutexWake,
+	/* 0x14 */ syscall::ThreadCreate,
+	/* 0x15 */ syscall::ThreadJoin,
+	/* 0x16 */ syscall::SetFSBase,
+	/* 0x17 */ syscall::SyscallFork,
+	/* 0x18 */ syscall::WaitChild,
+	/* 0x19 */ syscall::Spawn,
+	/* 0x1a */ syscall::GetTaskID,
+	/* 0x1b */ syscall::RingEnter,
+	/* 0x1c */ syscall::PRead,
+	/* 0x1d */ syscall::PWrite,
+	/* 0x1e */ syscall::Seek,
+	/* 0x1f */ syscall::CloseFile,
+	/* 0x20 */ syscall::ReadV,
+	/* 0x21 */ syscall::WriteV,
+	/* 0x22 */ syscall::WinBlit,
+	/* 0x23 */ syscall::OpenWindowSurface,
+	/* 0x24 */ syscall::WinCommit,
+	/* 0x25 */ syscall::WinDraw,
+	/* 0x26 */ syscall::ReadEventTimeout,
+};
+static_assert(std::size(syscall_table) == kNumSyscalls, "kNumSyscalls (syscall_trace.hpp) must match syscall_table");
+
+namespace syscall {
+	// 링의 항목을 시스템콜 하나로 실행한다. SyscallEntry의 스택 프레임이 필요한 시스템콜은 실행할 수 없다
+	Result DispatchRingEntry(const SyscallRingEntry& e) {
+		const uint64_t op = e.op & 0x7fff'ffff;
+		if (op >= std::size(syscall_table)) {
+			return { 0, ENOSYS };
+		}
+		const auto f = syscall_table[op];
+		if (f == Exit || f == SyscallFork || f == RingEnter) {
+			return { 0, EINVAL };
+		}
+		return f(e.args[0], e.args[1], e.args[2], e.args[3], e.args[4], e.args[5]);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#ifdef __cplusplus
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 배치 시스템콜 링 (SyscallRingEnter). io_uring처럼 앱 메모리에 있는 submission/completion 링을 커널과 공유한다.
+ * 앱은 sqes[sq_tail & (sq_capacity - 1)]을 채우고 sq_tail을 증가시킨 뒤 SyscallRingEnter 한 번으로 모두 제출한다.
+ * 커널은 sq_head부터 제출된 순서대로 실행하고, 결과를 cqes[cq_tail & (cq_capacity - 1)]에 넣은 뒤 cq_tail을 증가시킨다.
+ * head/tail은 계속 증가하는 값이며, 각 링의 용량은 2의 거듭제곱이어야 한다.
+ */
+
+#define SYSCALL_RING_SKIP_SUCCESS 1u // 성공하면 completion을 만들지 않는다 (그리기 명령 등)
+#define SYSCALL_COUNT 0x27 // 시스템콜 수 (syscall.asm, syscall_table). apps/ring.h의 RING_OP_* 목록과 맞춰야 한다
+
+struct SyscallRingEntry {
+	uint64_t op;		// 시스템콜 번호 (syscall.asm의 번호, 0x8000'0000 비트는 무시)
+	uint32_t flags;		// SYSCALL_RING_*
+	uint32_t reserved;
+	uint64_t args[6];
+	uint64_t user_data;	// completion에 그대로 복사된다
+};
+
+struct SyscallRingCompletion {
+	uint64_t user_data;
+	uint64_t value;
+	int32_t error;
+	uint32_t reserved;
+};
+
+struct SyscallRing {
+	uint32_t sq_head;	// 커널이 증가
+	uint32_t sq_tail;	// 앱이 증가
+	uint32_t cq_head;	// 앱이 증가
+	uint32_t cq_tail;	// 커널이 증가
+	uint32_t sq_capacity, cq_capacity;
+	struct SyscallRingEntry* sqes;
+	struct SyscallRingCompletion* cqes;
+};
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,163 @@
+#include "syscall_trace.hpp"
+#include "task.hpp"
+#include "per_cpu.hpp"
+#include "interrupt.hpp"
+#include "asmfunc.h"
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+
+extern "C" uint8_t syscall_trace_enabled = 0;
+
+namespace {
+	struct SyscallInfo {
+		const char* name;
+		int num_args;
+	};
+
+	// syscall_table (syscall.cpp)과 같은 순서
+	constexpr SyscallInfo syscall_info[] {
+		/* 0x00 */ { "LogString", 2 },
+		/* 0x01 */ { "PutString", 3 },
+		/* 0x02 */ { "Exit", 1 },
+		/* 0x03 */ { "OpenWindow", 5 },
+		/* 0x04 */ { "WinWriteString", 5 },
+		/* 0x05 */ { "WinFillRect", 6 },
+		/* 0x06 */ { "GetCurrentTick", 0 },
+		/* 0x07 */ { "WinRedraw", 1 },
+		/* 0x08 */ { "WinDrawLine", 6 },
+		/* 0x09 */ { "CloseWindow", 1 },
+		/* 0x0a */ { "ReadEvent", 2 },
+		/* 0x0b */ { "CreateTimer", 4 },
+		/* 0x0c */ { "OpenFile", 2 },
+		/* 0x0d */ { "ReadFile", 3 },
+		/* 0x0e */ { "DemandPages", 1 },
+		/* 0x0f */ { "MapFile", 2 },
+		/* 0x10 */ { "CancelTimer", 1 },
+		/* 0x11 */ { "GetTaskUsage", 1 },
+		/* 0x12 */ { "FutexWait", 2 },
+		/* 0x13 */ { "FutexWake", 2 },
+		/* 0x14 */ { "ThreadCreate", 4 },
+		/* 0x15 */ { "ThreadJoin", 1 },
+		/* 0x16 */ { "SetFSBase", 1 },
+		/* 0x17 */ { "Fork", 0 },
+		/* 0x18 */ { "WaitChild", 1 },
+		/* 0x19 */ { "Spawn", 3 },
+		/* 0x1a */ { "GetTaskID", 0 },
+		/* 0x1b */ { "RingEnter", 1 },
+		/* 0x1c */ { "PRead", 4 },
+		/* 0x1d */ { "PWrite", 4 },
+		/* 0x1e */ { "Seek", 3 },
+		/* 0x1f */ { "CloseFile", 1 },
+		/* 0x20 */ { "ReadV", 3 },
+		/* 0x21 */ { "WriteV", 3 },
+		/* 0x22 */ { "WinBlit", 4 },
+		/* 0x23 */ { "OpenWindowSurface", 6 },
+		/* 0x24 */ { "WinCommit", 5 },
+		/* 0x25 */ { "WinDraw", 3 },
+		/* 0x26 */ { "ReadEventTimeout", 4 },
+	};
+	static_assert(std::size(syscall_info) == kNumSyscalls, "syscall_info must list every entry of syscall_table");
+
+	bool stats_enabled = false;
+	int num_traced = 0; // 추적 링이 붙은 Task 수
+	SyscallStats global_stats {};
+
+	void UpdateTraceEnabled() {
+		syscall_trace_enabled = stats_enabled || num_traced > 0;
+	}
+
+	size_t HistBucket(uint64_t cycles) {
+		if (cycles == 0) {
+			return 0;
+		}
+		return std::min<size_t>(63 - __builtin_clzll(cycles), kSyscallHistBuckets - 1);
+	}
+
+	void Account(SyscallStats& s, uint64_t nr, uint64_t cycles, int error) {
+		++s.count[nr];
+		if (error) {
+			++s.errors[nr];
+		}
+		s.total_cycles[nr] += cycles;
+		++s.hist[nr][HistBucket(cycles)];
+	}
+}
+
+const char* SyscallName(uint64_t nr) {
+	return nr < kNumSyscalls ? syscall_info[nr].name : "?";
+}
+
+int SyscallNumArgs(uint64_t nr) {
+	return nr < kNumSyscalls ? syscall_info[nr].num_args : 6;
+}
+
+void SetSyscallStatsEnabled(bool enabled) {
+	InterruptDisabler guard;
+	stats_enabled = enabled;
+	UpdateTraceEnabled();
+}
+
+bool SyscallStatsEnabled() {
+	return stats_enabled;
+}
+
+SyscallStats GetSyscallStats(bool reset) {
+	InterruptDisabler guard;
+	const SyscallStats stats = global_stats;
+	if (reset) {
+		memset(&global_stats, 0, sizeof(global_stats));
+	}
+	return stats;
+}
+
+void StartSyscallTrace(Task& task) {
+	if (!task.syscall_stats) {
+		task.syscall_stats = std::make_unique<SyscallStats>();
+	}
+	auto trace = task.syscall_trace ? std::move(task.syscall_trace) : std::make_unique<SyscallTrace>();
+	memset(task.syscall_stats.get(), 0, sizeof(SyscallStats));
+	trace->recorded = 0;
+
+	InterruptDisabler guard;
+	task.syscall_trace = std::move(trace);
+	++num_traced;
+	UpdateTraceEnabled();
+}
+
+std::unique_ptr<SyscallTrace> StopSyscallTrace(Task& task) {
+	InterruptDisabler guard;
+	if (!task.syscall_trace) {
+		return nullptr;
+	}
+	--num_traced;
+	UpdateTraceEnabled();
+	return std::move(task.syscall_trace);
+}
+
+// SyscallEntry가 syscall_trace_enabled일 때 시스템콜 함수가 반환한 직후에 호출한다 (인터럽트 허용 상태)
+extern "C" void SyscallTraceEnd(const SyscallTraceFrame* frame, uint64_t value, int error) {
+	const uint64_t cycles = ReadTSC() - frame->start_tsc;
+	const uint64_t nr = frame->nr;
+	if (nr >= kNumSyscalls) {
+		return;
+	}
+
+	// 이 경로에서는 할당하지 않는다. Task별 통계는 StartSyscallTrace가 미리 할당한 추적 중인 Task만 모은다
+	Task& task = CPUCurrentTask();
+	InterruptDisabler guard;
+	if (stats_enabled) {
+		Account(global_stats, nr, cycles, error);
+	}
+	if (task.syscall_stats && task.syscall_trace) {
+		Account(*task.syscall_stats, nr, cycles, error);
+	}
+	if (auto trace = task.syscall_trace.get()) {
+		auto& e = trace->entries[trace->recorded++ % SyscallTrace::kCapacity];
+		e.nr = nr;
+		e.error = error;
+		memcpy(e.args, frame->args, sizeof(e.args));
+		e.value = value;
+		e.cycles = cycles;
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <memory>
+#include "syscall_ring.hpp"
+
+class Task;
+
+/*
+ * 시스템콜 통계와 추적 (sysstat, strace 명령어).
+ * syscall_trace_enabled가 0이면 SyscallEntry는 분기 하나만 더 실행하고, 1이면 시스템콜 전후의 TSC를 재서 SyscallTraceEnd를 호출한다.
+ * 통계는 시스템콜마다 호출 수, 에러 수, 사이클 합계, log2(사이클) 히스토그램을 모은다. 전역 통계는 sysstat on일 때, Task별 통계는 추적 중일 때만 모은다.
+ * 추적 링이 붙은 Task는 시스템콜마다 번호, 인자, 결과, 소요 시간을 기록한다.
+ */
+
+constexpr size_t kNumSyscalls = SYSCALL_COUNT; // syscall_table 크기
+constexpr size_t kSyscallHistBuckets = 32; // bucket b: [2^b, 2^(b+1)) 사이클 (마지막 bucket은 그 이상 전부)
+
+struct SyscallStats {
+	std::array<uint64_t, kNumSyscalls> count;
+	std::array<uint64_t, kNumSyscalls> errors;
+	std::array<uint64_t, kNumSyscalls> total_cycles;
+	std::array<std::array<uint32_t, kSyscallHistBuckets>, kNumSyscalls> hist;
+};
+
+struct SyscallTraceEntry {
+	uint32_t nr;
+	int32_t error;
+	uint64_t args[6];
+	uint64_t value;
+	uint64_t cycles;
+};
+
+/* Task별 추적 링. 가득 차면 오래된 항목을 덮어쓴다 */
+struct SyscallTrace {
+	static constexpr size_t kCapacity = 256;
+	std::array<SyscallTraceEntry, kCapacity> entries;
+	uint64_t recorded; // 지금까지 기록한 항목 수 (entries[recorded % kCapacity]에 다음 항목을 쓴다)
+};
+
+// SyscallEntry가 SyscallTraceEnd에 넘기는 스택 프레임 (asmfunc.asm의 .traced)
+struct SyscallTraceFrame {
+	uint64_t start_tsc;
+	uint64_t nr;
+	uint64_t args[6];
+};
+
+extern "C" uint8_t syscall_trace_enabled;
+
+/** @brief 시스템콜 이름. 범위를 벗어나면 "?" */
+const char* SyscallName(uint64_t nr);
+/** @brief 시스템콜이 사용하는 인자 수 (strace 출력용) */
+int SyscallNumArgs(uint64_t nr);
+
+/** @brief 전역 통계 수집을 켜고 끕니다 (sysstat on/off) */
+void SetSyscallStatsEnabled(bool enabled);
+bool SyscallStatsEnabled();
+/** @brief 전역 통계의 사본을 반환합니다. reset이 true면 전역 통계를 0으로 되돌립니다 */
+SyscallStats GetSyscallStats(bool reset);
+
+/**
+ * @brief task의 시스템콜을 추적 링에 기록하기 시작합니다. 기존 기록과 Task별 통계는 지워집니다.
+ * task에서 실행하는 앱의 시스템콜만 기록되며 스레드와 fork/spawn한 자식은 포함하지 않습니다
+ */
+void StartSyscallTrace(Task& task);
+/** @brief 추적을 멈추고 기록된 추적 링을 반환합니다. Task별 통계(task.syscall_stats)는 남겨둡니다 */
+std::unique_ptr<SyscallTrace> StopSyscallTrace(Task& task);
+
+extern "C" void SyscallTraceEnd(const SyscallTraceFrame* frame, uint64_t value, int error);
@@ -2,11 +2,51 @@
 #include "timer.hpp"
 #include "asmfunc.h"
 #include "segment.hpp"
+#include "fpu.hpp"
+#include "stack_pool.hpp"
+#include "logger.hpp"
+#include "per_cpu.hpp"
+#include <cstdlib>
 #include <cstring>
 #include <cstdint>
+#include <cstddef>
 #include <algorithm>
+#include <csignal>
 
 TaskManager* task_manager;
+MailboxStat mailbox_stat;
+extern "C" TaskContext* fpu_owner = nullptr;
+extern "C" uint64_t fpu_trap_count = 0;
+
+namespace {
+	constexpr uint64_t kCR0TaskSwitched = 1u << 3;
+
+	// next가 FPU 레지스터의 주인이 아니면 CR0.TS를 설정해서 처음 FPU를 사용할 때 #NM이 발생하도록 한다
+	void ArmFPUTrap(Task& next) {
+		const uint64_t cr0 = GetCR0();
+		const uint64_t new_cr0 = fpu_owner == &next.Context()
+			? cr0 & ~kCR0TaskSwitched
+			: cr0 | kCR0TaskSwitched;
+		if (new_cr0 != cr0) {
+			SetCR0(new_cr0);
+		}
+	}
+
+	uint64_t loaded_fs_base = 0;
+
+	// next가 앱을 실행 중이면 user mode 인터럽트용 스택(rsp0)과 TLS(FS base)를 next의 것으로 바꾼다
+	void LoadUserState(Task& next) {
+		per_cpu.current_task = &next;
+		per_cpu.kernel_stack = next.os_stack_ptr;
+		if (next.os_stack_ptr) {
+			SetTSSRsp0(next.os_stack_ptr);
+		}
+		if (next.FSBase() != loaded_fs_base) {
+			loaded_fs_base = next.FSBase();
+			WriteMSR(kIA32_FS_BASE, loaded_fs_base);
+		}
+	}
+}
 
 void InitTask() {
 	task_manager = new TaskManager;
@@ -15,21 +55,39 @@ void InitTask() {
 	timer_manager->AddTimer(Timer(
 		timer_manager->CurrentTick() + kTaskTimerPeriod,
 		kTaskTimerValue,
-		MainTaskID
+		MainTaskID,
+		kTaskTimerPeriod
 	));
 	ENABLE_INTERRUPT;
 }
 
 Task::Task(TaskID_t id) : id(id) {
+	fpu_area_buf.resize(fpu_area_size + kFPUAreaAlign - 1);
+	const uintptr_t buf_addr = reinterpret_cast<uintptr_t>(fpu_area_buf.data());
+	context.fpu_area = reinterpret_cast<uint8_t*>((buf_addr + kFPUAreaAlign - 1) & ~(kFPUAreaAlign - 1));
+	InitFPUArea(context.fpu_area);
+}
 
+// TaskManager::Finish에서 호출될 때는 아직 이 스택 위에서 실행 중이지만, 인터럽트가 금지된 채로 바로 다른 Task로 전환되므로
+// 반납된 스택이 그 사이에 재사용되지는 않는다
+Task::~Task() {
+	kernel_stack_pool->Free(stack);
 }
 
-Task& Task::InitContext(TaskFunc* f, int64_t data) {
-	const size_t stack_size = kDefaultStackBytes / sizeof(decltype(stack)::value_type);
-	stack.resize(stack_size);
-	uint64_t stack_begin = reinterpret_cast<uint64_t>(&stack[stack_size]);
+Task& Task::InitContext(TaskFunc* f, int64_t data, size_t stack_bytes) {
+	if (stack.bytes < stack_bytes || stack.bytes >= 2 * stack_bytes) {
+		kernel_stack_pool->Free(stack);
+		auto [new_stack, err] = kernel_stack_pool->Allocate(stack_bytes);
+		if (err) {
+			Log(kError, "failed to allocate kernel stack (%lu bytes): %s\n", stack_bytes, err.Name());
+			exit(1);
+		}
+		stack = new_stack;
+	}
+	uint64_t stack_begin = stack.Top();
 
-	memset(&context, 0, sizeof(TaskContext));
+	memset(&context, 0, offsetof(TaskContext, fpu_area));
+	InitFPUArea(context.fpu_area);
 	context.rip = reinterpret_cast<uint64_t>(f);
 	context.rdi = id; // 1st arg
 	context.rsi = data; // 2st arg
@@ -40,33 +98,114 @@ Task& Task::InitContext(TaskFunc* f, int64_t data) {
 	context.ss = kKernelSS;
 	context.rsp = (stack_begin & ~0xFlu) - 8; // x64 stack 16bit-alignment restrictions (minus 8 to trick cpp compiler as if the task had been launched from "call" op)
 
-	*reinterpret_cast<uint32_t*>(&context.fxsave_area[24]) = 0x1F80; // mxcsr register
-
 	return *this;
 }
 
-void Task::SendMsg(const Message& msg) {
-	msgs.push_back(msg);
-	this->Wakeup();
+namespace {
+	// SendMsg가 인터럽트를 금지한 시각 begin부터 지금까지를 msgbench의 최대값에 반영한다
+	void RecordIrqOff(uint64_t begin) {
+		mailbox_stat.max_irq_off_cycles = std::max(mailbox_stat.max_irq_off_cycles, ReadTSC() - begin);
+	}
+}
+
+Error Task::SendMsg(const Message& msg) {
+	while (true) {
+		InterruptDisabler guard;
+		const uint64_t begin = ReadTSC();
+		if (auto err = PushMsg(msg, guard.WasEnabled()); err.Cause() != Error::kTryAgain) {
+			RecordIrqOff(begin);
+			return err;
+		}
+	}
+}
+
+Error Task::PushMsg(const Message& msg, bool can_wait) {
+	if (!msgs.push(msg)) {
+		++usage.msgs_received;
+		// 수신 Task는 sleep하기 전에 인터럽트를 금지한 채로 메일박스를 다시 확인하므로, running인 경우에는 깨울 필요가 없다
+		if (!running) {
+			this->Wakeup();
+		}
+		return MAKE_ERROR(Error::kSuccess);
+	}
+
+	Task& sender = task_manager->CurrentTask();
+	// main task와 kWorkHigh worker(최상위 레벨)는 다른 Task를 기다리지 않는다
+	if (!can_wait || &sender == this || sender.Level() == TaskManager::kTaskMaxLevel) {
+		++usage.msgs_dropped;
+		++mailbox_stat.dropped;
+		return MAKE_ERROR(Error::kFull);
+	}
+	mailbox_waiters.push_back(&sender);
+	++mailbox_stat.blocked;
+	sender.Sleep(); // 이 Task가 메세지를 꺼내거나 종료하면 깨어난다
+	return MAKE_ERROR(Error::kTryAgain);
 }
 
 std::optional<Message> Task::ReceiveMsg() {
-	if (msgs.empty()) return std::nullopt;
-	auto m = msgs.front();
-	msgs.pop_front();
+	Message m;
+	if (ReceiveMsgs(&m, 1) == 0) return std::nullopt;
 	return m;
 }
 
-Message Task::Wait() {
-	DISABLE_INTERRUPT;
-	auto msg = this->ReceiveMsg();
-	if (msg)
-		return *msg;
+size_t Task::ReceiveMsgs(Message* out, size_t len) {
+	size_t n = 0;
+	while (n < len && put_back_begin < put_back_end) {
+		out[n++] = put_back[put_back_begin++];
+	}
+	if (n < len) {
+		InterruptDisabler guard;
+		while (n < len && !msgs.empty()) {
+			out[n++] = msgs.front();
+			msgs.pop();
+		}
+		// 메일박스에 자리가 생겼으므로 기다리던 송신 Task를 한 번에 깨운다
+		if (n > 0 && !mailbox_waiters.empty()) {
+			for (Task* sender : mailbox_waiters) {
+				sender->Wakeup();
+			}
+			mailbox_waiters.clear();
+		}
+	}
+	if (n == 0) return 0;
 
-	this->Sleep();
-	msg = this->ReceiveMsg();
-	ENABLE_INTERRUPT;
-	return *msg;
+	if (len > 1) {
+		++mailbox_stat.batches;
+		mailbox_stat.batched_msgs += n;
+	}
+	return n;
+}
+
+void Task::PutBackMsgs(const Message* in, size_t len) {
+	// 이전에 되돌린 메세지가 남아있으면 그보다 앞에 놓는다
+	const size_t remaining = put_back_end - put_back_begin;
+	len = std::min(len, kMaxPutBack - remaining);
+	memmove(&put_back[len], &put_back[put_back_begin], remaining * sizeof(Message));
+	std::copy_n(in, len, put_back.begin());
+	put_back_begin = 0;
+	put_back_end = len + remaining;
+}
+
+std::optional<Message> Task::Wait() {
+	Message msg;
+	if (WaitMsgs(&msg, 1) == 0) return std::nullopt;
+	return msg;
+}
+
+size_t Task::WaitMsgs(Message* out, size_t len) {
+	while (true) {
+		if (const size_t n = this->ReceiveMsgs(out, len)) {
+			return n;
+		}
+
+		InterruptDisabler guard;
+		if (msgs.empty() && put_back_begin == put_back_end) {
+			if (space->exiting) {
+				return 0;
+			}
+			this->Sleep();
+		}
+	}
 }
 
 Task& Task::Sleep() {
@@ -83,37 +222,158 @@ TaskManager::TaskManager() {
 	running[this->current_lvl].push_back(&NewTask()
 		.SetLevel(this->current_lvl)
 		.SetRunning(true)
+		.SetFixedLevel(true)
 	);
+	fpu_owner = &CurrentTask().Context(); // 부팅 이후 사용 중이던 FPU 레지스터는 main task의 것이다
+	per_cpu.current_task = &CurrentTask();
 
 	// underflow를 방지하기 위해 IDLE task(유휴 테스크)를 추가한다
-	running[0].push_back(&NewTask()
-		.InitContext([](uint64_t, int64_t) { while (true) __asm__("hlt"); }, 0xdeadbeef)
+	idle_task = &NewTask()
+		.InitContext([](uint64_t, int64_t) { while (true) __asm__("hlt"); }, 0xdeadbeef, 2 * 4096)
 		.SetLevel(0)
 		.SetRunning(true)
-	);
+		.SetFixedLevel(true);
+	running[0].push_back(idle_task);
+
+	last_account_tsc = ReadTSC();
 }
 
 Task& TaskManager::NewTask() {
+	InterruptDisabler guard; // 인터럽트 핸들러의 SendMsg가 tasks를 탐색한다
 	++latest_id;
 	return *tasks.emplace_back(new Task(latest_id));
 }
 
-void TaskManager::SwitchTask(const TaskContext& current_ctx) {
+void TaskManager::SwitchTask(const TaskContext& current_ctx, bool rotate) {
 	TaskContext& task_ctx = CurrentTask().Context();
-	memcpy(&task_ctx, &current_ctx, sizeof(TaskContext));
-	Task* current_task = RotateCurrentRunningQueue(false);
+	memcpy(&task_ctx, &current_ctx, offsetof(TaskContext, fpu_area));
+
+	Task* current_task = &CurrentTask();
+	if (rotate) {
+		RotateCurrentRunningQueue(false);
+	} else {
+		SelectRunningLevel();
+	}
+
 	if (&CurrentTask() != current_task) {
+		// 인터럽트 핸들러가 FPU 레지스터를 덮어썼을 수 있으므로 레지스터 대신 저장된 상태를 사용한다
+		// (인터럽트 진입 시 fpu_area에 저장되었거나, 핸들러의 #NM에서 fpu_area로부터 복원된 상태)
+		if (fpu_owner == &task_ctx) {
+			fpu_owner = nullptr;
+		}
+		AccountSwitch(current_task);
+		ArmFPUTrap(CurrentTask());
+		LoadUserState(CurrentTask());
 		RestoreContext(&CurrentTask().Context());
 	}
 }
 
+void TaskManager::OnTaskTimer(const TaskContext& current_ctx) {
+	if (++this->sched_ticks % kBoostPeriod == 0) {
+		Boost();
+	}
+
+	Task& task = CurrentTask();
+	if (++task.slice_used < TimeSlice(task.Level())) {
+		if (this->lvl_changed) {
+			SwitchTask(current_ctx, false);
+		}
+		return;
+	}
+
+	task.slice_used = 0;
+	if (!task.FixedLevel() && task.Level() > kMLFQMinLevel) {
+		task.SetLevel(task.Level() - 1); // RotateCurrentRunningQueue에서 큐를 옮긴다
+	}
+	SwitchTask(current_ctx);
+}
+
+void TaskManager::Boost() {
+	for (auto& task : tasks) {
+		if (task->FixedLevel() || task->Level() == kMLFQMaxLevel) continue;
+
+		task->slice_used = 0;
+		if (task->Running()) {
+			ChangeRunningLevel(task.get(), kMLFQMaxLevel);
+		} else {
+			task->SetLevel(kMLFQMaxLevel);
+		}
+	}
+}
+
+size_t TaskManager::Snapshot(TaskStat* stats, size_t len) {
+	ChargeElapsed(CurrentTask());
+
+	size_t i = 0;
+	for (; i < len && i < tasks.size(); i++) {
+		const Task& task = *tasks[i];
+		stats[i] = {
+			task.ID(), task.Level(), task.Running(), task.FixedLevel(),
+			task.SliceUsed(), TimeSlice(task.Level()), task.usage
+		};
+	}
+	return i;
+}
+
+void TaskManager::AccountCurrentTask(bool user_mode) {
+	Task& task = CurrentTask();
+	ChargeElapsed(task);
+	task.user_mode = user_mode;
+}
+
+const TaskUsage& TaskManager::CurrentUsage() {
+	Task& task = CurrentTask();
+	ChargeElapsed(task);
+	return task.usage;
+}
+
+void TaskManager::ChargeElapsed(Task& task) {
+	const uint64_t now = ReadTSC();
+	const uint64_t elapsed = now - last_account_tsc;
+	last_account_tsc = now;
+
+	if (&task == idle_task) {
+		task.usage.idle_cycles += elapsed;
+	} else if (task.user_mode) {
+		task.usage.user_cycles += elapsed;
+	} else {
+		task.usage.kernel_cycles += elapsed;
+	}
+}
+
+void TaskManager::AccountSwitch(Task* prev) {
+	if (prev) {
+		ChargeElapsed(*prev);
+	} else {
+		last_account_tsc = ReadTSC();
+	}
+	++CurrentTask().usage.ctx_switches;
+}
+
+void TaskManager::Reschedule() {
+	if (!this->lvl_changed) return;
+
+	Task* current_task = &CurrentTask();
+	SelectRunningLevel();
+	if (&CurrentTask() != current_task) {
+		AccountSwitch(current_task);
+		ArmFPUTrap(CurrentTask());
+		LoadUserState(CurrentTask());
+		SwitchContext(&CurrentTask().Context(), &current_task->Context());
+	}
+}
+
 Task* TaskManager::RotateCurrentRunningQueue(bool current_sleep) {
 	auto& q = running[this->current_lvl];
 	Task* current_task = q.front();
 	q.pop_front();
 
 	if (!current_sleep) {
-		q.push_back(current_task);
+		// OnTaskTimer에서 레벨이 낮아진 경우 해당 레벨의 큐로 옮겨간다
+		running[current_task->Level()].push_back(current_task);
+		if (current_task->Level() != this->current_lvl) {
+			this->lvl_changed = true;
+		}
 	}
 
 	// 현재 레벨의 Task 큐가 비어있으면 상위 레벨부터 하위 레벨 순으로 큐를 선택한다
@@ -121,6 +381,11 @@ Task* TaskManager::RotateCurrentRunningQueue(bool current_sleep) {
 		this->lvl_changed = true;
 	}
 
+	SelectRunningLevel();
+	return current_task;
+}
+
+void TaskManager::SelectRunningLevel() {
 	// 현재 큐가 빈 경우 OR 상위 레벨의 Task가 Wakeup을 받은 경우
 	if (this->lvl_changed) {
 		this->lvl_changed = false;
@@ -130,8 +395,6 @@ Task* TaskManager::RotateCurrentRunningQueue(bool current_sleep) {
 			this->current_lvl--;
 		}
 	}
-
-	return current_task;
 }
 
 const Task& TaskManager::CurrentTask() const {
@@ -142,13 +405,21 @@ Task& TaskManager::CurrentTask() {
 }
 
 Error TaskManager::SendMsg(TaskID_t task_id, const Message& msg) {
-	auto it = std::find_if(tasks.begin(), tasks.end(), [task_id](const auto& task) { return task_id == task->ID(); });
-
-	if (it == tasks.end())
-		return MAKE_ERROR(Error::kNoSuchTask);
-
-	(*it)->SendMsg(msg);
-	return MAKE_ERROR(Error::kSuccess);
+	// 찾기와 넣기를 같은 인터럽트 금지 구간에서 하므로 그 사이에 수신 Task가 종료될 수 없다.
+	// backpressure로 sleep했다가 깨어나면 그동안 종료되었을 수 있으므로 다시 찾는다
+	while (true) {
+		InterruptDisabler guard;
+		const uint64_t begin = ReadTSC();
+		Task* task = FindTask(task_id);
+		if (task == nullptr) {
+			RecordIrqOff(begin);
+			return MAKE_ERROR(Error::kNoSuchTask);
+		}
+		if (auto err = task->PushMsg(msg, guard.WasEnabled()); err.Cause() != Error::kTryAgain) {
+			RecordIrqOff(begin);
+			return err;
+		}
+	}
 }
 
 void TaskManager::Sleep(Task* task) {
@@ -158,6 +429,14 @@ void TaskManager::Sleep(Task* task) {
 
 	if (task == running[this->current_lvl].front()) {
 		Task* current_task = RotateCurrentRunningQueue(true);
+		// 스스로 sleep한(메세지를 기다리는) Task는 interactive한 Task로 보고 레벨을 올린다
+		if (!task->FixedLevel() && task->Level() < kMLFQMaxLevel) {
+			task->SetLevel(task->Level() + 1);
+		}
+		task->slice_used = 0;
+		AccountSwitch(current_task);
+		ArmFPUTrap(CurrentTask());
+		LoadUserState(CurrentTask());
 		SwitchContext(&CurrentTask().Context(), &current_task->Context());
 		return;
 	}
@@ -166,12 +445,11 @@ void TaskManager::Sleep(Task* task) {
 }
 
 Error TaskManager::Sleep(TaskID_t id) {
-	auto it = std::find_if(tasks.begin(), tasks.end(), [id](const auto& task) { return id == task->ID(); });
-
-	if (it == tasks.end())
+	Task* task = FindTask(id);
+	if (task == nullptr)
 		return MAKE_ERROR(Error::kNoSuchTask);
 
-	Sleep(it->get());
+	Sleep(task);
 	return MAKE_ERROR(Error::kSuccess);
 }
 
@@ -188,20 +466,43 @@ void TaskManager::Wakeup(Task* task, int lvl) {
 	task->SetLevel(lvl);
 	task->SetRunning(true);
 	running[lvl].push_back(task);
+	++wakeup_count;
 	if (lvl > this->current_lvl)
 		this->lvl_changed = true;
 }
 
-Error TaskManager::Wakeup(TaskID_t id, int lvl) {
-	auto it = std::find_if(tasks.begin(), tasks.end(), [id](const auto& task) { return id == task->ID(); });
+void TaskManager::SetFixedLevel(Task* task, unsigned int lvl) {
+	InterruptDisabler guard;
+	task->SetFixedLevel(true);
+	if (task->Running()) {
+		ChangeRunningLevel(task, lvl);
+	} else {
+		task->SetLevel(lvl);
+	}
+}
 
-	if (it == tasks.end())
+void TaskManager::SetCurrentFSBase(uint64_t fs_base) {
+	CurrentTask().SetFSBase(fs_base);
+	LoadUserState(CurrentTask());
+}
+
+Error TaskManager::Wakeup(TaskID_t id, int lvl) {
+	Task* task = FindTask(id);
+	if (task == nullptr)
 		return MAKE_ERROR(Error::kNoSuchTask);
 
-	Wakeup(it->get(), lvl);
+	Wakeup(task, lvl);
 	return MAKE_ERROR(Error::kSuccess);
 }
 
+Task* TaskManager::FindTask(TaskID_t id) {
+	// NewTask는 ID가 증가하는 순서로 뒤에 추가하고, Finish의 erase는 순서를 유지한다
+	auto it = std::lower_bound(tasks.begin(), tasks.end(), id, [](const auto& task, TaskID_t id) { return task->ID() < id; });
+	if (it == tasks.end() || (*it)->ID() != id)
+		return nullptr;
+	return it->get();
+}
+
 void TaskManager::Erase(decltype(running)::value_type& task_grp, Task* task_to_erase) {
 	auto it = std::remove(task_grp.begin(), task_grp.end(), task_to_erase);
 	task_grp.erase(it, task_grp.end());
@@ -235,20 +536,34 @@ void TaskManager::Finish(int exit_code) {
 	Task* cur_task = RotateCurrentRunningQueue(true);
 
 	const auto task_id = cur_task->ID();
+	if (fpu_owner == &cur_task->Context()) {
+		fpu_owner = nullptr;
+	}
+	// 메일박스가 비기를 기다리던 송신 Task는 깨어나서 kNoSuchTask를 받는다
+	for (Task* sender : cur_task->mailbox_waiters) {
+		Wakeup(sender);
+	}
 	auto it = std::find_if(tasks.begin(), tasks.end(), [cur_task](const auto& t) { return t.get() == cur_task; });
 	tasks.erase(it);
 
-	finished_tasks[task_id] = exit_code;
+	if (auto it = detached_tasks.find(task_id); it != detached_tasks.end()) {
+		detached_tasks.erase(it);
+	} else {
+		finished_tasks[task_id] = exit_code;
+	}
 	if (auto it = waiter_tasks.find(task_id); it != waiter_tasks.end()) {
 		auto waiter = it->second;
 		waiter_tasks.erase(it);
 		Wakeup(waiter);
 	}
 
+	AccountSwitch(nullptr);
+	ArmFPUTrap(CurrentTask());
+	LoadUserState(CurrentTask());
 	RestoreContext(&CurrentTask().Context());
 }
 
-WithError<int> TaskManager::WaitFinish(TaskID_t task_id) {
+WithError<int> TaskManager::WaitFinish(TaskID_t task_id, bool interruptible) {
 	int exit_code;
 	Task* cur_task = &CurrentTask();
 	while (true) {
@@ -257,13 +572,53 @@ WithError<int> TaskManager::WaitFinish(TaskID_t task_id) {
 			finished_tasks.erase(it);
 			return { exit_code, MakeError(Error::kSuccess) };
 		}
+		// ReleaseAppSpace가 앱의 스레드를 깨우면 기다리기를 그만두고 시스템콜 복귀 시 종료된다
+		if (interruptible && cur_task->Space().exiting) {
+			if (auto it = waiter_tasks.find(task_id); it != waiter_tasks.end() && it->second == cur_task) {
+				waiter_tasks.erase(it);
+			}
+			return { 0, MakeError(Error::kInterrupted) };
+		}
 
 		waiter_tasks[task_id] = cur_task;
 		Sleep(cur_task);
 	}
 }
 
+void TaskManager::Detach(TaskID_t task_id) {
+	if (auto it = finished_tasks.find(task_id); it != finished_tasks.end()) {
+		finished_tasks.erase(it);
+	} else {
+		detached_tasks.insert(task_id);
+	}
+}
+
+// IntHandlerNM에서 FPU 상태를 복원할 콘텍스트를 얻기 위해 호출된다
+__attribute__((no_caller_saved_registers))
+extern "C" TaskContext* GetCurrentTaskContext(void) {
+	return &task_manager->CurrentTask().Context();
+}
+
+// 시스템콜 진입 직후에 호출된다 (SyscallEntry)
 __attribute__((no_caller_saved_registers))
-extern "C" uint64_t GetCurrentTaskOSStackPointer(void) {
-	return task_manager->CurrentTask().os_stack_ptr;
+extern "C" void OnSyscallEntry(void) {
+	++task_manager->CurrentTask().Usage().syscalls;
+	task_manager->AccountCurrentTask(false);
+}
+
+// 시스템콜 복귀 직전에 호출된다 (SyscallEntry)
+extern "C" void OnSyscallExit(void) {
+	DISABLE_INTERRUPT;
+	task_manager->Reschedule();
+	ExitIfAppExiting();
+	task_manager->AccountCurrentTask(true);
+	ENABLE_INTERRUPT;
+}
+
+void ExitIfAppExiting() {
+	Task& task = task_manager->CurrentTask();
+	if (task.Space().exiting && task.os_stack_ptr) {
+		__asm__("sti");
+		ExitApp(task.os_stack_ptr, 128 + SIGKILL);
+	}
 }
\ No newline at end of file
@@ -4,12 +4,17 @@
 #include <array>
 #include <deque>
 #include <map>
+#include <set>
 #include <vector>
 #include <memory>
 #include <optional>
 #include "error.hpp"
 #include "message.hpp"
 #include "fat.hpp"
+#include "task_usage.hpp"
+#include "stack_pool.hpp"
+#include "queue.hpp"
+#include "syscall_trace.hpp"
 
 struct FileMapping {
 	int fd;
@@ -17,11 +22,11 @@ struct FileMapping {
 };
 
 struct TaskContext {
-	uint64_t cr3, rip, rflags, reserved;				// $00
+	uint64_t cr3, rip, rflags, reserved;				// $00 (reserved: 인터럽트 진입 시 FPU 상태를 fpu_area에 저장했으면 1)
 	uint64_t cs, ss, fs, gs;							// $20
 	uint64_t rax, rbx, rcx, rdx, rdi, rsi, rsp, rbp;	// $40
 	uint64_t r8, r9, r10, r11, r12, r13, r14, r15;		// $80
-	std::array<uint8_t, 512> fxsave_area;				// $c0
+	uint8_t* fpu_area;									// $c0 (fxsave/xsave 영역, kFPUAreaAlign 정렬)
 } __attribute__((packed));
 
 using TaskID_t = uint64_t;
@@ -29,12 +34,38 @@ constexpr TaskID_t MainTaskID = 1;
 
 using TaskFunc = void(TaskID_t task_id, int64_t data);
 
+class Task;
 class TaskManager;
 
+/* 같은 주소 공간(CR3)을 공유하는 앱 Task(스레드)들이 함께 사용하는 상태 */
+struct AppSpace {
+	std::vector<std::shared_ptr<::FileDescriptor>> files {};
+	uint64_t dpaging_begin {0}, dpaging_end {0};
+	uint64_t file_map_end {0};
+	std::vector<FileMapping> file_maps {};
+	std::vector<TaskID_t> threads {};	// 아직 join되지 않은 스레드 (인터럽트 금지 상태에서만 접근)
+	int num_threads {0};				// 실행 중인 스레드 수 (앱을 시작한 Task 제외)
+	Task* exit_waiter {nullptr};		// num_threads가 0이 되기를 기다리는 Task
+	std::vector<TaskID_t> children {};	// fork로 만든 뒤 아직 wait하지 않은 자식 Task (인터럽트 금지 상태에서만 접근)
+	bool exiting {false};				// 앱을 시작한 Task가 종료되어 남은 스레드를 종료시키는 중 (ReleaseAppSpace)
+};
+
+/* 메일박스 통계 (msgbench) */
+struct MailboxStat {
+	uint64_t dropped;			// 메일박스가 가득 차서 버려진 메세지 수
+	uint64_t blocked;			// 송신 Task가 backpressure로 sleep한 횟수
+	uint64_t max_irq_off_cycles;	// SendMsg가 인터럽트를 금지한 가장 긴 시간 (수신 Task 찾기 포함, TSC 사이클)
+	uint64_t batches;			// ReceiveMsgs/WaitMsgs로 메세지를 하나 이상 꺼낸 횟수
+	uint64_t batched_msgs;		// 그렇게 꺼낸 메세지의 총 수
+};
+
+extern MailboxStat mailbox_stat;
+
 class Task {
 public:
-	static constexpr unsigned int kDefaultLvl = 1;
+	static constexpr unsigned int kDefaultLvl = 3; // 새 Task는 MLFQ의 최상위 레벨에서 시작한다
 	static constexpr size_t kDefaultStackBytes = 8 * 4096;
+	static constexpr size_t kMailboxCapacity = 256;
 
 private:
 	/**
@@ -43,65 +74,144 @@ private:
 	 */
 	Task(TaskID_t id);
 public:
+	~Task();
 	/**
 	 * @brief Task 객체의 TaskContext를 초기화하며, Task의 EntryPoint(시작 위치) 및 데이터를 지정합니다.
 	 * 
 	 * @param f Task의 entry point가 되는 함수
 	 * @param data 함수 f의 두번째 parameter에 주어질 값
+	 * @param stack_bytes 커널 스택 크기. 2의 거듭제곱 페이지 수로 올림되며 KernelStackPool::kMaxStackBytes 이하여야 합니다
 	 * @return *this가 반환됩니다
 	 */
-	Task& InitContext(TaskFunc* f, int64_t data);
+	Task& InitContext(TaskFunc* f, int64_t data, size_t stack_bytes = kDefaultStackBytes);
 	TaskID_t ID() const 			{ return id; }
 	unsigned int Level() const 		{ return lvl; }
 	bool Running() const 			{ return running; }
+	unsigned int SliceUsed() const 	{ return slice_used; }
+	bool FixedLevel() const 		{ return fixed_lvl; }
+	TaskUsage& Usage() 				{ return usage; }
 	TaskContext& Context()			{ return context; }
 
 	/**
-	 * @brief Task 객체에 Message를 등록합니다. 또한 Task가 Sleep 상태였던 경우, Running 상태가 됩니다
+	 * @brief Task 객체에 Message를 등록합니다. 또한 Task가 Sleep 상태였던 경우, Running 상태가 됩니다.
+	 * Task와 인터럽트 핸들러 어디에서나 호출할 수 있습니다 (메세지를 넣는 짧은 구간만 인터럽트를 금지합니다).
+	 * 메일박스가 가득 찬 경우 보내는 Task는 자리가 날 때까지 sleep합니다(backpressure).
+	 * 단, 인터럽트가 금지된 상태(인터럽트 핸들러 포함)이거나 자기 자신 또는 main task가 보내는 경우에는 기다리지 않고 메세지를 버립니다.
+	 * 호출하는 쪽이 이 Task가 종료되지 않음을 보장해야 하며, 그렇지 않으면 TaskManager::SendMsg를 사용합니다
 	 * @param msg 등록할 Message
+	 * @return 메세지를 버린 경우 kFull
 	 */
-	void SendMsg(const Message& msg);
+	Error SendMsg(const Message& msg);
 	/**
-	 * @brief Task 객체에 등록된 Message 중 1개를 꺼내옵니다.
+	 * @brief Task 객체에 등록된 Message 중 1개를 꺼내옵니다. 이 Task에서만 호출해야 합니다.
 	 * @return std::optional<Message>를 반환합니다. 등록된 Message가 없는 경우 std::nullopt를 반환합니다
 	 */
 	std::optional<Message> ReceiveMsg();
+	/**
+	 * @brief 메일박스에 이미 들어있는 Message를 최대 len개까지 한 번에 꺼냅니다. 기다리지 않으며 이 Task에서만 호출해야 합니다.
+	 * @return 꺼낸 Message의 수
+	 */
+	size_t ReceiveMsgs(Message* msgs, size_t len);
+	/**
+	 * @brief ReceiveMsgs/WaitMsgs로 꺼냈지만 처리하지 않은 Message를 메일박스 맨 앞에 되돌립니다 (최대 kMaxPutBack개).
+	 * 다음 ReceiveMsgs는 되돌린 Message부터 같은 순서로 꺼냅니다. 이 Task에서만 호출해야 합니다
+	 */
+	void PutBackMsgs(const Message* msgs, size_t len);
+	static constexpr size_t kMaxPutBack = 32;
 
-	Message Wait();
+	/**
+	 * @brief Message가 올 때까지 sleep한 뒤 꺼내옵니다. 호출 전의 인터럽트 허용 여부가 그대로 유지됩니다
+	 * @return 꺼낸 Message. 종료 중인 앱(AppSpace::exiting)의 스레드면 기다리지 않고 std::nullopt
+	 */
+	std::optional<Message> Wait();
+	/**
+	 * @brief Message가 하나 이상 들어올 때까지 sleep한 뒤, 그동안 쌓인 Message를 최대 len개(1 이상)까지 꺼냅니다
+	 * @return 꺼낸 Message의 수 (1 이상). 종료 중인 앱(AppSpace::exiting)의 스레드면 기다리지 않고 0
+	 */
+	size_t WaitMsgs(Message* msgs, size_t len);
 	Task& Sleep();
 	Task& Wakeup();
 
-	uint64_t DPagingBegin() const { return dpaging_begin; }
-	uint64_t DPagingEnd() const { return dpaging_end; }
-	void SetDPagingBegin(uint64_t v) { dpaging_begin = v; }
-	void SetDPagingEnd(uint64_t v) { dpaging_end = v; }
-	uint64_t FileMapEnd() const { return file_map_end; }
-	void SetFileMapEnd(uint64_t v) { file_map_end = v; }
-	std::vector<FileMapping>& FileMaps() { return file_maps; }
+	uint64_t DPagingBegin() const { return space->dpaging_begin; }
+	uint64_t DPagingEnd() const { return space->dpaging_end; }
+	void SetDPagingBegin(uint64_t v) { space->dpaging_begin = v; }
+	void SetDPagingEnd(uint64_t v) { space->dpaging_end = v; }
+	uint64_t FileMapEnd() const { return space->file_map_end; }
+	void SetFileMapEnd(uint64_t v) { space->file_map_end = v; }
+	std::vector<FileMapping>& FileMaps() { return space->file_maps; }
+	std::vector<std::shared_ptr<::FileDescriptor>>& Files() { return space->files; }
+	AppSpace& Space() { return *space; }
+	/**
+	 * @brief leader의 파일 테이블과 가상 메모리 영역을 공유하는 스레드로 만듭니다. leader는 이 Task보다 오래 살아있어야 합니다
+	 */
+	Task& ShareSpace(Task& leader) { space = leader.space; return *this; }
+	uint64_t FSBase() const { return fs_base; }
+	// user mode의 FS base(TLS). 이 Task로 전환될 때 IA32_FS_BASE에 로드된다
+	Task& SetFSBase(uint64_t v) { fs_base = v; return *this; }
 
-	std::vector<std::shared_ptr<::FileDescriptor>> files {};
-	uint64_t os_stack_ptr;
+	uint64_t os_stack_ptr {0}; // CallApp이 저장한 커널 스택 위치. 시스템콜과 user mode 인터럽트가 이 아래를 사용한다
+	std::unique_ptr<SyscallStats> syscall_stats {}; // StartSyscallTrace(strace)가 할당하고, 추적 중에만 모은다
+	std::unique_ptr<SyscallTrace> syscall_trace {}; // strace로 추적 중일 때만 할당된다
 private:
 	TaskID_t id;
-	std::vector<uint64_t> stack;
+	KernelStack stack {}; // kernel_stack_pool에서 할당 (main task는 부팅 스택을 그대로 사용)
+	std::vector<uint8_t> fpu_area_buf; // fpu_area_size + 정렬 여유분
 	alignas(16) TaskContext context;
-	std::deque<Message> msgs;
+	ArrayQueue<Message, kMailboxCapacity> msgs; // 메일박스 (인터럽트 금지 상태에서만 접근)
+	std::array<Message, kMaxPutBack> put_back; // PutBackMsgs로 되돌린 메세지 (수신 Task만 접근)
+	size_t put_back_begin {0}, put_back_end {0};
+	std::vector<Task*> mailbox_waiters; // 메일박스가 가득 차서 sleep한 송신 Task (인터럽트 금지 상태에서만 접근)
+	/**
+	 * @brief 인터럽트 금지 상태에서 메세지를 넣습니다. 메일박스가 가득 찼고 can_wait이면 자리가 나거나 이 Task가 종료될 때까지
+	 * 송신 Task를 sleep시킨 뒤 kTryAgain을 반환합니다 (이때 this는 이미 해제되었을 수 있습니다)
+	 */
+	Error PushMsg(const Message& msg, bool can_wait);
 	unsigned int lvl {kDefaultLvl};
 	bool running {false};
-	uint64_t dpaging_begin {0}, dpaging_end {0};
-	uint64_t file_map_end {0};
-	std::vector<FileMapping> file_maps {};
+	unsigned int slice_used {0}; // 현재 레벨에서 사용한 time slice (스케줄러 틱)
+	bool fixed_lvl {false}; // true인 경우 MLFQ에 의해 레벨이 바뀌지 않는다
+	TaskUsage usage {};
+	bool user_mode {false}; // CPU 시간을 user_cycles로 청구할지 여부
+	AppSpace own_space {};
+	AppSpace* space {&own_space}; // 스레드는 앱을 시작한 Task의 own_space를 가리킨다
+	uint64_t fs_base {0};
 
 	Task& SetLevel(int lvl) { this->lvl = lvl; return *this; }
 	Task& SetRunning(bool running) { this->running = running; return *this; }
+	Task& SetFixedLevel(bool fixed) { this->fixed_lvl = fixed; return *this; }
 
 	friend TaskManager;
 };
 
+/* Task의 상태 정보 (TaskManager::Snapshot) */
+struct TaskStat {
+	TaskID_t id;
+	unsigned int lvl;
+	bool running;
+	bool fixed_lvl;
+	unsigned int slice_used, slice;
+	TaskUsage usage;
+};
+
 class TaskManager {
 public:
-	// Task 레벨 (low priority)0 ~ 3(high priority)
-	static constexpr int kTaskMaxLevel = 3;
+	/*
+	 * Task 레벨 (low priority)0 ~ 4(high priority)
+	 * 0: 유휴 Task, 4: main task (고정)
+	 * 1 ~ 3: MLFQ 레벨. time slice를 모두 사용하면 한 단계 내려가고, 메세지를 기다리며 sleep하면 한 단계 올라간다.
+	 *        kBoostPeriod마다 모든 Task가 kMLFQMaxLevel로 올라간다 (starvation 방지).
+	 */
+	static constexpr int kTaskMaxLevel = 4;
+	static constexpr int kMLFQMinLevel = 1;
+	static constexpr int kMLFQMaxLevel = 3;
+	static constexpr unsigned long kBoostPeriod = 100; // 스케줄러 틱 (kTaskTimerPeriod 단위)
+	static_assert(Task::kDefaultLvl >= kMLFQMinLevel && Task::kDefaultLvl <= kMLFQMaxLevel);
+
+	// 레벨별 time slice (스케줄러 틱 단위). 낮은 레벨일수록 길다
+	static constexpr unsigned int TimeSlice(int lvl) {
+		constexpr unsigned int slices[kTaskMaxLevel+1] = { 1, 8, 4, 2, 2 };
+		return slices[lvl];
+	}
 
 	/* TaskManager를 초기화합니다 (진행 중이던 Context를 바탕으로 main task가 생성 및 등록되며, 유휴 Task가 1개 등록됩니다) */
 	TaskManager();
@@ -113,10 +223,24 @@ public:
 	/**
 	 * @brief Running 대기열에 있는 다음 Task로 Context 스위칭합니다
 	 * @param current_ctx 현재 콘텍스트
+	 * @param rotate false인 경우 현재 레벨의 대기열을 회전하지 않고, 더 높은 레벨의 Task가 있을 때만 전환합니다
 	 */
-	void SwitchTask(const TaskContext& current_ctx);
+	void SwitchTask(const TaskContext& current_ctx, bool rotate = true);
 	Task* RotateCurrentRunningQueue(bool current_sleep = false);
 
+	/**
+	 * @brief 스케줄러 틱마다 호출되며, 현재 Task의 time slice를 소모합니다. slice를 모두 사용한 경우 레벨을 낮추고 다음 Task로 전환합니다
+	 * @param current_ctx 현재 콘텍스트 (타이머 인터럽트에서 저장된 콘텍스트)
+	 */
+	void OnTaskTimer(const TaskContext& current_ctx);
+
+	// 현재 Task보다 높은 레벨의 Task가 깨어나서 스케줄링이 필요한지 여부
+	bool NeedResched() const { return lvl_changed; }
+	/**
+	 * @brief NeedResched()인 경우 더 높은 레벨의 Task로 즉시 전환합니다. 인터럽트가 비활성화된 상태에서 호출해야 합니다
+	 */
+	void Reschedule();
+
 	const Task& CurrentTask() const;
 	Task& CurrentTask();
 	Error SendMsg(TaskID_t task_id, const Message& msg);
@@ -125,19 +249,68 @@ public:
 	Error Sleep(TaskID_t id);
 	void Wakeup(Task* task, int lvl = -1);
 	Error Wakeup(TaskID_t id, int lvl = -1);
+	/**
+	 * @brief task를 lvl 레벨에 고정합니다. 고정된 Task는 MLFQ에 의해 레벨이 바뀌지 않습니다 (커널 worker Task 등)
+	 */
+	void SetFixedLevel(Task* task, unsigned int lvl);
+	/**
+	 * @brief 현재 Task의 FS base를 바꾸고 바로 로드합니다. 인터럽트가 비활성화된 상태에서 호출해야 합니다
+	 */
+	void SetCurrentFSBase(uint64_t fs_base);
 
 	void Finish(int exit_code);
-	WithError<int> WaitFinish(TaskID_t task_id);
+	/**
+	 * @brief task_id의 Task가 종료할 때까지 기다렸다가 종료 코드를 회수합니다. 인터럽트가 비활성화된 상태에서 호출해야 합니다
+	 * @param interruptible true면 현재 Task의 앱이 종료 중일 때(AppSpace::exiting) 기다리지 않고 kInterrupted를 반환합니다
+	 */
+	WithError<int> WaitFinish(TaskID_t task_id, bool interruptible = false);
+	/**
+	 * @brief 아무도 WaitFinish하지 않을 Task의 종료 코드를 버립니다. 이미 종료했으면 바로, 아니면 종료할 때 버립니다.
+	 * 인터럽트가 비활성화된 상태에서 호출해야 합니다
+	 */
+	void Detach(TaskID_t task_id);
+
+	// sleep 상태에서 running 상태로 전환된 횟수
+	uint64_t WakeupCount() const { return wakeup_count; }
+	/**
+	 * @brief 모든 Task의 상태를 복사합니다. 인터럽트가 비활성화된 상태에서 호출해야 합니다
+	 * @return 복사된 Task의 개수 (최대 len)
+	 */
+	size_t Snapshot(TaskStat* stats, size_t len);
+
+	/**
+	 * @brief 마지막 청구 시점 이후의 시간을 현재 Task에 청구하고, 이후의 시간을 청구할 모드를 설정합니다.
+	 * user mode로 진입/복귀하는 지점(CallApp, 시스템콜)에서 호출됩니다. 인터럽트가 비활성화된 상태에서 호출해야 합니다
+	 * @param user_mode true인 경우 이후의 시간은 user_cycles로 청구됩니다
+	 */
+	void AccountCurrentTask(bool user_mode);
+	// 현재 시각까지 청구된 현재 Task의 사용량 (인터럽트가 비활성화된 상태에서 호출해야 합니다)
+	const TaskUsage& CurrentUsage();
 private:
 	std::vector<std::unique_ptr<Task>> tasks {};
 	std::map<TaskID_t, int> finished_tasks {};
 	std::map<TaskID_t, Task*> waiter_tasks {};
+	std::set<TaskID_t> detached_tasks {}; // 종료 코드를 기록하지 않을 Task (Detach)
 	TaskID_t latest_id {0};
 	std::array<std::deque<Task*>, kTaskMaxLevel+1> running {}; // running[0] is the current context
 	int current_lvl {kTaskMaxLevel};
-	bool lvl_changed {false};
+	bool lvl_changed {false}; // need-resched flag (인터럽트 및 시스템콜 복귀 시 확인됨)
+	uint64_t wakeup_count {0};
+	unsigned long sched_ticks {0};
+	Task* idle_task {nullptr};
+	uint64_t last_account_tsc {0}; // 마지막으로 CPU 시간을 청구한 시각
 
 	void Erase(decltype(running)::value_type& task_grp, Task* task_to_erase);
+	// tasks는 ID 순서로 정렬되어 있으므로 이진 탐색한다. 없으면 nullptr (인터럽트 금지 상태에서 호출)
+	Task* FindTask(TaskID_t id);
+	// lvl_changed인 경우 Task가 있는 가장 높은 레벨을 current_lvl로 선택한다
+	void SelectRunningLevel();
+	// 모든 MLFQ Task를 kMLFQMaxLevel로 올린다
+	void Boost();
+	// last_account_tsc 이후의 시간을 task에 청구한다
+	void ChargeElapsed(Task& task);
+	// prev에서 현재 Task로 전환되기 직전에 호출된다 (prev가 종료된 경우 nullptr)
+	void AccountSwitch(Task* prev);
 
 	/**
 	 * @brief 현재 실행 중(running == true)인 task의 running 레벨을 변경합니다
@@ -150,4 +323,18 @@ private:
 
 extern TaskManager* task_manager;
 
+/**
+ * @brief 현재 Task가 종료 중인 앱(AppSpace::exiting)의 스레드면 user mode로 돌아가지 않고
+ * 종료 코드 128 + SIGKILL로 CallApp에서 반환합니다. 인터럽트가 금지된 상태에서 호출해야 합니다
+ */
+void ExitIfAppExiting();
+
+/*
+ * FPU/SSE 레지스터는 lazy하게 전환된다. 레지스터에는 fpu_owner의 상태가 들어있으며,
+ * 다른 Task로 전환할 때 CR0.TS를 설정해서 그 Task가 처음 FPU를 사용할 때 #NM(IntHandlerNM)에서
+ * fpu_owner의 상태를 저장하고 현재 Task의 상태를 복원한다.
+ */
+extern "C" TaskContext* fpu_owner; // 상태 저장 방식은 fpu.hpp 참고
+extern "C" uint64_t fpu_trap_count; // #NM 발생 횟수
+
 void InitTask();
@@ -0,0 +1,27 @@
+#pragma once
+
+#ifdef __cplusplus
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Task별 CPU 사용량 (커널 내부 및 SyscallGetTaskUsage에서 사용) */
+struct TaskUsage {
+	uint64_t user_cycles;   // user mode에서 소비한 TSC 사이클 (user mode에서 받은 인터럽트 처리 시간 포함)
+	uint64_t kernel_cycles; // kernel mode에서 소비한 TSC 사이클
+	uint64_t idle_cycles;   // 유휴 Task에서만 증가
+	uint64_t ctx_switches;  // 이 Task로 전환된 횟수
+	uint64_t page_faults;
+	uint64_t syscalls;
+	uint64_t msgs_received;
+	uint64_t msgs_dropped;  // 메일박스가 가득 차서 버려진 메세지
+};
+
+#ifdef __cplusplus
+}
+#endif
@@ -6,11 +6,14 @@
 #include "pci.hpp"
 #include "fat.hpp"
 #include "timer.hpp"
+#include "workqueue.hpp"
 #include "elf.h"
 #include "paging.hpp"
 #include "asmfunc.h"
 #include "keyboard.hpp"
 #include "memory_manager.hpp"
+#include "syscall_trace.hpp"
+#include "per_cpu.hpp"
 
 #include <cstring>
 #include <cstdio>
@@ -46,7 +49,173 @@ char* rtrim(char* s) {
 	return s;
 }
 
-fat::DirectoryEntry* FindCommand(const char* cmd, unsigned long dir_cluster = 0) {
+namespace {
+	constexpr int kTopRefreshTimer = 2;
+
+	uint64_t TotalCycles(const TaskUsage& u) {
+		return u.user_cycles + u.kernel_cycles + u.idle_cycles;
+	}
+
+	// ctxbench: 받은 Ping 메세지를 보낸 Task에게 돌려주는 것을 data회 반복한다
+	void TaskPingPong(TaskID_t task_id, int64_t data) {
+		DISABLE_INTERRUPT;
+		Task& task = task_manager->CurrentTask();
+		ENABLE_INTERRUPT;
+
+		for (int64_t i = 0; i < data;) {
+			const auto msg = task.Wait();
+			if (!msg) break;
+			if (msg->type != Message::Ping) continue;
+
+			task_manager->SendMsg(msg->src_task, Message{Message::Ping, task_id});
+			++i;
+		}
+
+		DISABLE_INTERRUPT;
+		task_manager->Finish(0);
+	}
+
+	// msgbench: Ping 메세지를 data개 받을 때까지 꺼내기만 한다
+	void TaskMsgSink(TaskID_t task_id, int64_t data) {
+		DISABLE_INTERRUPT;
+		Task& task = task_manager->CurrentTask();
+		ENABLE_INTERRUPT;
+
+		std::array<Message, 32> msgs;
+		for (int64_t i = 0; i < data;) {
+			const size_t num_msgs = task.WaitMsgs(msgs.data(), msgs.size());
+			if (num_msgs == 0) break;
+			for (size_t j = 0; j < num_msgs; j++) {
+				if (msgs[j].type == Message::Ping) ++i;
+			}
+		}
+
+		DISABLE_INTERRUPT;
+		task_manager->Finish(0);
+	}
+
+	// prev 스냅샷 이후의 사용량을 기준으로 Task별 CPU 점유율을 출력한다
+	void PrintTop(FileDescriptor& fd, const TaskStat* stats, size_t num_stats, const TaskStat* prev, size_t num_prev) {
+		auto delta = [&](const TaskStat& s) {
+			TaskUsage d = s.usage;
+			for (size_t i = 0; i < num_prev; i++) {
+				if (prev[i].id == s.id) {
+					d.user_cycles -= prev[i].usage.user_cycles;
+					d.kernel_cycles -= prev[i].usage.kernel_cycles;
+					d.idle_cycles -= prev[i].usage.idle_cycles;
+					break;
+				}
+			}
+			return d;
+		};
+
+		uint64_t user = 0, kernel = 0, idle = 0;
+		for (size_t i = 0; i < num_stats; i++) {
+			const auto d = delta(stats[i]);
+			user += d.user_cycles;
+			kernel += d.kernel_cycles;
+			idle += d.idle_cycles;
+		}
+		const uint64_t total = std::max(user + kernel + idle, 1ul);
+		PrintToFD(fd, "cpu: %3lu%% user, %3lu%% kernel, %3lu%% idle\n",
+			user * 100 / total, kernel * 100 / total, idle * 100 / total);
+
+		// TSC 주파수를 모르는 경우 Mcycles 단위로 출력한다
+		const uint64_t cycles_per_unit = tsc_freq ? std::max(tsc_freq / 1000, 1ul) : 1000000;
+		PrintToFD(fd, "  ID LV %%CPU %9s %9s %6s %5s %7s %6s\n",
+			tsc_freq ? "USER(ms)" : "USER(Mc)", tsc_freq ? "KERN(ms)" : "KERN(Mc)", "CSW", "PF", "SYSCALL", "MSGS");
+		for (size_t i = 0; i < num_stats; i++) {
+			const auto& s = stats[i];
+			PrintToFD(fd, "%4lu %2u %4lu %9lu %9lu %6lu %5lu %7lu %6lu\n",
+				s.id, s.lvl, TotalCycles(delta(s)) * 100 / total,
+				s.usage.user_cycles / cycles_per_unit, (s.usage.kernel_cycles + s.usage.idle_cycles) / cycles_per_unit,
+				s.usage.ctx_switches, s.usage.page_faults, s.usage.syscalls, s.usage.msgs_received);
+		}
+	}
+
+	// TSC 주파수를 모르는 경우 사이클 그대로 출력한다
+	const char* SyscallTimeUnit() {
+		return tsc_freq ? "ns" : "cyc";
+	}
+
+	uint64_t SyscallTime(uint64_t cycles) {
+		return tsc_freq ? cycles * 1000 / std::max(tsc_freq / 1000000, 1ul) : cycles;
+	}
+
+	// 히스토그램에서 p% 지점이 속한 bucket의 상한 (사이클)
+	uint64_t HistPercentile(const std::array<uint32_t, kSyscallHistBuckets>& hist, uint64_t count, int p) {
+		const uint64_t target = (count * p + 99) / 100;
+		uint64_t seen = 0;
+		for (size_t b = 0; b < hist.size(); b++) {
+			seen += hist[b];
+			if (seen >= target) {
+				return 2ul << b;
+			}
+		}
+		return 2ul << (hist.size() - 1);
+	}
+
+	void PrintSyscallStats(FileDescriptor& fd, const SyscallStats& stats) {
+		PrintToFD(fd, "%-15s %8s %6s %9s %9s %9s (%s)\n", "SYSCALL", "CALLS", "ERRORS", "AVG", "P50", "P99", SyscallTimeUnit());
+		for (size_t nr = 0; nr < kNumSyscalls; nr++) {
+			const uint64_t count = stats.count[nr];
+			if (count == 0) {
+				continue;
+			}
+			PrintToFD(fd, "%-15s %8lu %6lu %9lu %9lu %9lu\n", SyscallName(nr), count, stats.errors[nr],
+				SyscallTime(stats.total_cycles[nr] / count),
+				SyscallTime(HistPercentile(stats.hist[nr], count, 50)),
+				SyscallTime(HistPercentile(stats.hist[nr], count, 99)));
+		}
+	}
+
+	// 시스템콜 하나의 log2 히스토그램을 막대로 출력한다
+	void PrintSyscallHistogram(FileDescriptor& fd, const SyscallStats& stats, size_t nr) {
+		const auto& hist = stats.hist[nr];
+		const uint32_t max_count = *std::max_element(hist.begin(), hist.end());
+		if (max_count == 0) {
+			PrintToFD(fd, "no %s calls recorded\n", SyscallName(nr));
+			return;
+		}
+
+		constexpr int kBarWidth = 40;
+		PrintToFD(fd, "%s: %lu calls\n", SyscallName(nr), stats.count[nr]);
+		for (size_t b = 0; b < hist.size(); b++) {
+			if (hist[b] == 0) {
+				continue;
+			}
+			char bar[kBarWidth + 1];
+			const int len = std::max<int>(1, static_cast<uint64_t>(hist[b]) * kBarWidth / max_count);
+			memset(bar, '#', len);
+			bar[len] = 0;
+			PrintToFD(fd, "< %10lu %-3s %8u %s\n", SyscallTime(2ul << b), SyscallTimeUnit(), hist[b], bar);
+		}
+	}
+
+	// 추적 링의 항목을 오래된 순서로 출력한다. PrintToFD의 버퍼가 작으므로 인자는 하나씩 출력한다
+	void PrintSyscallTrace(FileDescriptor& fd, const SyscallTrace& trace) {
+		const uint64_t begin = trace.recorded > SyscallTrace::kCapacity ? trace.recorded - SyscallTrace::kCapacity : 0;
+		if (begin > 0) {
+			PrintToFD(fd, "(%lu earlier syscalls dropped)\n", begin);
+		}
+		for (uint64_t i = begin; i < trace.recorded; i++) {
+			const auto& e = trace.entries[i % SyscallTrace::kCapacity];
+			PrintToFD(fd, "%s(", SyscallName(e.nr));
+			for (int a = 0; a < SyscallNumArgs(e.nr); a++) {
+				PrintToFD(fd, a == 0 ? "%#lx" : ", %#lx", e.args[a]);
+			}
+			if (strcmp(SyscallName(e.nr), "Exit") == 0) {
+				PrintToFD(fd, ") = ?\n");
+			} else if (e.error) {
+				PrintToFD(fd, ") = %ld, errno %d <%lu %s>\n", e.value, e.error, SyscallTime(e.cycles), SyscallTimeUnit());
+			} else {
+				PrintToFD(fd, ") = %ld <%lu %s>\n", e.value, SyscallTime(e.cycles), SyscallTimeUnit());
+			}
+		}
+	}
+}
+
+fat::DirectoryEntry* FindCommand(const char* cmd, unsigned long dir_cluster) {
 	auto [ entry, post_slash ] = fat::FindFile(cmd, dir_cluster);
 	if (entry && (entry->dir_Attr == fat::ATTR_DIRECTORY || post_slash)) {
 		return nullptr;
@@ -67,6 +236,25 @@ fat::DirectoryEntry* FindCommand(const char* cmd, unsigned long dir_cluster = 0)
 }
 
 namespace {
+	/**
+	 * @brief command_line이 앱 하나를 실행하는 명령이면 그 앱 파일을 찾습니다.
+	 * 리다이렉션이나 파이프가 있거나, 앱이 아닌 명령(내장 명령 등)이면 nullptr를 반환합니다.
+	 */
+	const fat::DirectoryEntry* FindAppCommand(const char* command_line) {
+		if (!command_line || strpbrk(command_line, "|>")) {
+			return nullptr;
+		}
+		const char* end = command_line;
+		while (*end && !isspace(*end)) {
+			++end;
+		}
+		if (end == command_line) {
+			return nullptr;
+		}
+		const std::string command(command_line, end);
+		return FindCommand(command.c_str());
+	}
+
 	void DrawTerminal(PixelWriter& writer, Vector2D<int> pos, Vector2D<int> size) {
 		DrawTextbox(writer, pos, size, 0, 0xc6c6c6, 0x848484);
 	}
@@ -163,8 +351,12 @@ namespace {
 			auto src = reinterpret_cast<const uint8_t*>(ehdr) + phdr[i].p_offset;
 			auto paddings = phdr[i].p_memsz - phdr[i].p_filesz;
 
+			// 세그먼트는 읽기 전용으로 매핑되므로 복사하는 동안만 CR0.WP를 끈다
+			InterruptDisabler guard;
+			SetCR0(GetCR0() & ~kCR0WriteProtect);
 			memcpy(dst, src, phdr[i].p_filesz);
 			memset(dst + phdr[i].p_filesz, 0, paddings);
+			SetCR0(GetCR0() | kCR0WriteProtect);
 		}
 		return { last_addr, MakeError(Error::kSuccess) };
 	}
@@ -338,10 +530,7 @@ void Terminal::Print(const char* s, std::optional<size_t> len) {
 		Vector2D<int> draw_sz { window->InnerSize().x, cursor_after.y - cursor_before.y + font::FONT_HEIGHT };
 		Rect<int> draw_area { draw_pos, draw_sz };
 
-		Message msg = MakeLayerMessage(taskID, layerID, LayerOperation::DrawPartial, draw_area);
-		DISABLE_INTERRUPT;
-		task_manager->SendMsg(MainTaskID, msg);
-		ENABLE_INTERRUPT;
+		DamageLayer(layerID, draw_area);
 	}
 }
 
@@ -470,14 +659,17 @@ void Terminal::ExecuteLine() {
 
 		auto& subtask = task_manager->NewTask();
 		pipe_fd = std::make_shared<PipeDescriptor>(subtask);
-		// TODO : free somewhere!!!
-		auto term_args = new TerminalArgs{
-			subcommand, true, false,
-			{ pipe_fd, files[1], files[2] }	
-		};
+		const std::array<std::shared_ptr<FileDescriptor>, 3> sub_files{ pipe_fd, files[1], files[2] };
 		files[1] = pipe_fd;
 
-		subtask_id = subtask.InitContext(TaskTerminal, reinterpret_cast<int64_t>(term_args)).Wakeup().ID();
+		// 앱 하나만 실행하는 단계는 Terminal과 숨겨진 창 없이 바로 실행한다
+		if (auto sub_file = FindAppCommand(subcommand)) {
+			SpawnApp(subtask, sub_file, subcommand, sub_files);
+		} else {
+			auto term_args = new TerminalArgs{ subcommand, true, false, sub_files }; // TaskTerminal이 해제한다
+			subtask.InitContext(TaskTerminal, reinterpret_cast<int64_t>(term_args)).Wakeup();
+		}
+		subtask_id = subtask.ID();
 		(*layer_task_map)[layerID] = subtask_id;
 	}
 
@@ -563,19 +755,266 @@ void Terminal::ExecuteLine() {
 			DrawCursor(true);
 		}
 	} else if (strcmp(command, "noterm") == 0) {
-		// TODO : free somewhere!!!
-		auto term_args = new TerminalArgs{
-			first_arg, true, false,
-			{ files[0], files[1], files[2] }
-		};
-		task_manager->NewTask()
-			.InitContext(TaskTerminal, reinterpret_cast<int64_t>(term_args))
-			.Wakeup();
+		if (auto file = FindAppCommand(first_arg)) {
+			SpawnApp(task_manager->NewTask(), file, first_arg, files);
+		} else {
+			auto term_args = new TerminalArgs{ first_arg, true, false, files }; // TaskTerminal이 해제한다
+			task_manager->NewTask()
+				.InitContext(TaskTerminal, reinterpret_cast<int64_t>(term_args))
+				.Wakeup();
+		}
+	} else if (strcmp(command, "timerbench") == 0) {
+		const int num_timers = (first_arg && first_arg[0]) ? atoi(first_arg) : 100000;
+		if (num_timers <= 0) {
+			PrintToFD(stderr_, "usage: timerbench [num_timers]\n");
+			exit_code = 1;
+		} else {
+			const auto res = BenchmarkTimerManager(num_timers);
+			PrintToFD(stdout_, "%d outstanding timers\n", res.num_timers);
+			PrintToFD(stdout_, "insert: %lu cycles/op\n", res.insert_cycles / num_timers);
+			PrintToFD(stdout_, "cancel+insert: %lu cycles/op\n", res.churn_cycles / num_timers);
+			PrintToFD(stdout_, "cancel: %lu cycles/op\n", res.cancel_cycles / num_timers);
+		}
+	} else if (strcmp(command, "timerstat") == 0) {
+		static TimerStat prev_stat{};
+		static uint64_t prev_wakeups = 0;
+		static unsigned long prev_tick = 0;
+
+		DISABLE_INTERRUPT;
+		const auto stat = timer_manager->Stat();
+		const auto wakeups = task_manager->WakeupCount();
+		const auto tick = timer_manager->CurrentTick();
+		ENABLE_INTERRUPT;
+
+		// 이전 timerstat 호출 이후의 초당 발생 횟수
+		const unsigned long elapsed = std::max(tick - prev_tick, 1ul);
+		PrintToFD(stdout_, "timers: %lu outstanding\n", stat.num_timers);
+		PrintToFD(stdout_, "timer msgs/s: %lu\n", (stat.expired_timers - prev_stat.expired_timers) * kTimerFreq / elapsed);
+		PrintToFD(stdout_, "timer passes/s: %lu\n", (stat.wakeup_passes - prev_stat.wakeup_passes) * kTimerFreq / elapsed);
+		PrintToFD(stdout_, "task wakeups/s: %lu\n", (wakeups - prev_wakeups) * kTimerFreq / elapsed);
+
+		prev_stat = stat;
+		prev_wakeups = wakeups;
+		prev_tick = tick;
+	} else if (strcmp(command, "top") == 0) {
+		// 1초마다 갱신하며, 키를 누르거나 다른 이벤트가 오면 종료한다
+		const int refreshes = first_arg && first_arg[0] ? atoi(first_arg) : 10;
+		static std::array<TaskStat, 64> stats, prev_stats;
+
+		DISABLE_INTERRUPT;
+		Task& task = task_manager->CurrentTask();
+		size_t num_prev = task_manager->Snapshot(prev_stats.data(), prev_stats.size());
+		const TimerID_t refresh_timer = timer_manager->AddTimer(Timer{
+			timer_manager->CurrentTick() + kTimerFreq, kTopRefreshTimer, taskID, kTimerFreq
+		});
+		ENABLE_INTERRUPT;
+
+		bool quit = false;
+		for (int i = 0; i < refreshes && !quit; i++) {
+			while (true) {
+				const auto msg = task.Wait();
+				if (!msg) {
+					quit = true;
+					break;
+				}
+				if (msg->type == Message::TimerTimeout && msg->arg.timer.value == kTopRefreshTimer) {
+					break;
+				}
+				if (msg->type == Message::TimerTimeout || msg->type == Message::LayerFinish
+						|| (msg->type == Message::KeyPush && !msg->arg.keyboard.press)) {
+					continue;
+				}
+				if (msg->type != Message::KeyPush) { // 터미널이 처리하도록 다시 넣어둔다
+					task.SendMsg(*msg);
+				}
+				quit = true;
+				break;
+			}
+			if (quit) break;
+
+			DISABLE_INTERRUPT;
+			const size_t num_stats = task_manager->Snapshot(stats.data(), stats.size());
+			ENABLE_INTERRUPT;
+
+			const bool to_window = window && &stdout_ == original_stdout.get();
+			if (to_window) {
+				FillRect(*window->InnerWriter(), padding, vec_multiply(font::FONT_SIZE, {columns, rows}), gfx::color::BLACK);
+				cursor.y = 0;
+			}
+			PrintTop(stdout_, stats.data(), num_stats, prev_stats.data(), num_prev);
+			if (to_window) {
+				ReDraw();
+			}
+
+			prev_stats = stats;
+			num_prev = num_stats;
+		}
+
+		DISABLE_INTERRUPT;
+		timer_manager->CancelTimer(refresh_timer);
+		ENABLE_INTERRUPT;
+	} else if (strcmp(command, "ctxbench") == 0) {
+		// 두 Task가 메세지를 주고받으며 번갈아 실행될 때의 Context 스위칭 비용을 측정한다
+		const int round_trips = first_arg && first_arg[0] ? atoi(first_arg) : 10000;
+
+		DISABLE_INTERRUPT;
+		Task& task = task_manager->CurrentTask();
+		const TaskID_t partner_id = task_manager->NewTask().InitContext(TaskPingPong, round_trips, 2 * 4096).Wakeup().ID();
+		const uint64_t fpu_traps_begin = fpu_trap_count;
+		ENABLE_INTERRUPT;
+
+		const uint64_t tsc_begin = ReadTSC();
+		for (int i = 0; i < round_trips; i++) {
+			task_manager->SendMsg(partner_id, Message{Message::Ping, taskID});
+			for (auto msg = task.Wait(); msg && msg->type != Message::Ping; msg = task.Wait()) {}
+		}
+		const uint64_t elapsed = ReadTSC() - tsc_begin;
+
+		DISABLE_INTERRUPT;
+		task_manager->WaitFinish(partner_id);
+		const uint64_t fpu_traps = fpu_trap_count - fpu_traps_begin;
+		ENABLE_INTERRUPT;
+
+		if (round_trips > 0) {
+			PrintToFD(stdout_, "%lu cycles/switch (%d round trips), %lu fpu traps\n",
+				elapsed / (2 * round_trips), round_trips, fpu_traps);
+		}
+	} else if (strcmp(command, "msgbench") == 0) {
+		// 한 Task가 다른 Task의 메일박스에 메세지를 연속으로 보낼 때의 처리량 (가득 차면 backpressure로 sleep한다)
+		const int num_msgs = first_arg && first_arg[0] ? atoi(first_arg) : 100000;
+
+		DISABLE_INTERRUPT;
+		const MailboxStat stat_begin = mailbox_stat;
+		mailbox_stat.max_irq_off_cycles = 0;
+		const TaskID_t sink_id = task_manager->NewTask().InitContext(TaskMsgSink, num_msgs, 2 * 4096).Wakeup().ID();
+		ENABLE_INTERRUPT;
+
+		const uint64_t tsc_begin = ReadTSC();
+		for (int i = 0; i < num_msgs; i++) {
+			task_manager->SendMsg(sink_id, Message{Message::Ping, taskID});
+		}
+		DISABLE_INTERRUPT;
+		task_manager->WaitFinish(sink_id);
+		ENABLE_INTERRUPT;
+		const uint64_t elapsed = ReadTSC() - tsc_begin;
+
+		if (num_msgs > 0 && elapsed > 0) {
+			PrintToFD(stdout_, "%lu msgs/s, %lu cycles/msg (%d msgs)\n",
+				num_msgs * tsc_freq / elapsed, elapsed / num_msgs, num_msgs);
+		}
+		PrintToFD(stdout_, "blocked %lu, dropped %lu, max irq-off in SendMsg %lu cycles\n",
+			mailbox_stat.blocked - stat_begin.blocked, mailbox_stat.dropped - stat_begin.dropped,
+			mailbox_stat.max_irq_off_cycles);
+		if (const uint64_t batches = mailbox_stat.batches - stat_begin.batches) {
+			PrintToFD(stdout_, "%lu msgs per batch receive (avg)\n", (mailbox_stat.batched_msgs - stat_begin.batched_msgs) / batches);
+		}
+	} else if (strcmp(command, "ps") == 0) {
+		std::array<TaskStat, 64> stats;
+		DISABLE_INTERRUPT;
+		const size_t num_tasks = task_manager->Snapshot(stats.data(), stats.size());
+		ENABLE_INTERRUPT;
+
+		PrintToFD(stdout_, "  ID LV ST SLICE\n");
+		for (size_t i = 0; i < num_tasks; i++) {
+			const auto& s = stats[i];
+			PrintToFD(stdout_, "%4lu %2u%c %c  %u/%u\n",
+				s.id, s.lvl, s.fixed_lvl ? '*' : ' ', s.running ? 'R' : 'S', s.slice_used, s.slice);
+		}
+	} else if (strcmp(command, "latstat") == 0) {
+		// 마지막 latstat 호출 이후 xHCI 인터럽트부터 worker가 이벤트를 처리할 때까지의 지연
+		DISABLE_INTERRUPT;
+		const auto stat = xhci_latency;
+		xhci_latency = {};
+		ENABLE_INTERRUPT;
+
+		if (stat.count == 0) {
+			PrintToFD(stdout_, "no xhci interrupts\n");
+		} else if (tsc_freq == 0) {
+			PrintToFD(stdout_, "xhci irq->handler: %lu samples, avg %lu cycles, max %lu cycles\n",
+				stat.count, stat.total_cycles / stat.count, stat.max_cycles);
+		} else {
+			const unsigned long cycles_per_us = std::max(tsc_freq / 1000000, 1ul);
+			PrintToFD(stdout_, "xhci irq->handler: %lu samples, avg %lu us, max %lu us\n",
+				stat.count, stat.total_cycles / stat.count / cycles_per_us, stat.max_cycles / cycles_per_us);
+		}
+
+		// work queue별 QueueWork부터 work 함수가 시작될 때까지의 지연
+		const unsigned long cycles_per_us = std::max(tsc_freq / 1000000, 1ul);
+		PrintToFD(stdout_, "PRIO   QUEUED DROPPED EXECUTED AVG(us) MAX(us)\n");
+		for (int prio = 0; prio < kNumWorkPriorities; prio++) {
+			const auto wq = GetWorkQueueStat(static_cast<WorkPriority>(prio), true);
+			const auto& lat = wq.latency;
+			PrintToFD(stdout_, "%-6s %6lu %7lu %8lu %7lu %7lu\n",
+				WorkPriorityName(static_cast<WorkPriority>(prio)), wq.queued, wq.dropped, wq.executed,
+				lat.count ? lat.total_cycles / lat.count / cycles_per_us : 0, lat.max_cycles / cycles_per_us);
+		}
+	} else if (strcmp(command, "strace") == 0) {
+		char* sub_command = first_arg;
+		char* sub_arg = sub_command ? strchr(sub_command, ' ') : nullptr;
+		if (sub_arg) {
+			*sub_arg = 0;
+			do {
+				++sub_arg;
+			} while (isspace(*sub_arg));
+		}
+
+		auto file_entry = (sub_command && sub_command[0]) ? FindCommand(sub_command) : nullptr;
+		if (!sub_command || !sub_command[0]) {
+			PrintToFD(stderr_, "usage: strace <command> [args]\n");
+			exit_code = 1;
+		} else if (!file_entry) {
+			PrintToFD(stderr_, "no such command: %s\n", sub_command);
+			exit_code = 1;
+		} else {
+			// 앱은 이 Task에서 실행되므로 이 Task의 시스템콜을 추적하고, 앱이 끝난 뒤에 출력한다
+			Task& task = CPUCurrentTask();
+			StartSyscallTrace(task);
+			auto [excode, err] = ExecuteFile(file_entry, sub_command, sub_arg);
+			const auto trace = StopSyscallTrace(task);
+			if (err) {
+				PrintToFD(stderr_, "Error occurred while executing %s: %s\n", sub_command, err.Name());
+			}
+			PrintSyscallTrace(stdout_, *trace);
+			PrintSyscallStats(stdout_, *task.syscall_stats);
+			exit_code = excode;
+		}
+	} else if (strcmp(command, "sysstat") == 0) {
+		// sysstat [on|off|reset|<syscall>]: 전역 시스템콜 통계를 켜고 끄거나, 표 또는 시스템콜 하나의 히스토그램을 출력한다
+		if (first_arg && strcmp(first_arg, "on") == 0) {
+			SetSyscallStatsEnabled(true);
+		} else if (first_arg && strcmp(first_arg, "off") == 0) {
+			SetSyscallStatsEnabled(false);
+		} else {
+			const bool reset = first_arg && strcmp(first_arg, "reset") == 0;
+			const auto stats = GetSyscallStats(reset);
+			if (!SyscallStatsEnabled()) {
+				PrintToFD(stdout_, "syscall stats are off (sysstat on)\n");
+			}
+
+			if (first_arg && first_arg[0] && !reset) {
+				size_t nr = 0;
+				while (nr < kNumSyscalls && strcmp(SyscallName(nr), first_arg) != 0) {
+					++nr;
+				}
+				if (nr == kNumSyscalls) {
+					PrintToFD(stderr_, "usage: sysstat [on|off|reset|<syscall>]\n");
+					exit_code = 1;
+				} else {
+					PrintSyscallHistogram(stdout_, stats, nr);
+				}
+			} else {
+				PrintSyscallStats(stdout_, stats);
+			}
+		}
 	} else if (strcmp(command, "memstat") == 0) {
 		const auto p_stat = memory_manager->Stat();
 
 		PrintToFD(stdout_, "Phys used: %lu frames (%llu MiB)\n", p_stat.allocated_frames, p_stat.allocated_frames * BytesPerFrame / 1024 / 1024);
 		PrintToFD(stdout_, "Phys total: %lu frames (%llu MiB)\n", p_stat.total_frames, p_stat.total_frames * BytesPerFrame / 1024 / 1024);
+
+		const auto k_stat = kernel_stack_pool->Stat();
+		PrintToFD(stdout_, "Kernel stacks: %lu live, %lu pooled, %lu KiB mapped (pool hit %lu / miss %lu)\n",
+			k_stat.live, k_stat.pooled, k_stat.mapped_bytes / 1024, k_stat.pool_hits, k_stat.pool_misses);
 		
 	} else if (command[0] != 0) {
 		auto file_entry = FindCommand(command);
@@ -655,7 +1094,51 @@ WithError<AppLoadInfo> LoadApp(const fat::DirectoryEntry* file, Task& task) {
 	return { app_load, err };
 }
 
+Error ReleaseAppSpace(Task& task) {
+	DISABLE_INTERRUPT;
+	// 주소 공간과 파일 테이블은 마지막 스레드가 종료된 뒤에 해제한다
+	auto& space = task.Space();
+	// 남은 스레드를 깨워서 user mode로 돌아가기 전에 종료되게 한다 (ExitIfAppExiting, FutexWait, Task::WaitMsgs, WaitFinish)
+	space.exiting = true;
+	for (auto thread_id : space.threads) {
+		task_manager->Wakeup(thread_id);
+	}
+	while (space.num_threads > 0) {
+		space.exit_waiter = &task;
+		task_manager->Sleep(&task);
+	}
+	space.exit_waiter = nullptr;
+	space.exiting = false;
+	for (auto thread_id : space.threads) { // join되지 않은 스레드의 종료 코드를 회수한다
+		task_manager->WaitFinish(thread_id);
+	}
+	space.threads.clear();
+	for (auto child_id : space.children) { // wait하지 않은 자식은 종료 코드를 남기지 않는다
+		task_manager->Detach(child_id);
+	}
+	space.children.clear();
+	task_manager->SetCurrentFSBase(0);
+	ENABLE_INTERRUPT;
+
+	task.Files().clear();
+	task.FileMaps().clear();
+	DISABLE_INTERRUPT;
+	timer_manager->CancelAppTimers(task.ID());
+	ENABLE_INTERRUPT;
+	// 창은 앱보다 오래 남을 수 있으므로 surface 매핑만 먼저 제거해서, 나중에 창이 닫힐 때 버퍼가 해제되게 한다
+	UnmapWindowSurfaces(GetCR3());
+
+	if (auto err = CleanUserPageMaps()) {
+		return err;
+	}
+	return FreePML4(task);
+}
+
 WithError<int> Terminal::ExecuteFile(const fat::DirectoryEntry* file, char* command, char* args) {
+	return RunApp(file, command, args, files);
+}
+
+WithError<int> RunApp(const fat::DirectoryEntry* file, char* command, char* args, const std::array<std::shared_ptr<FileDescriptor>, 3>& files) {
 	DISABLE_INTERRUPT;
 	auto& task = task_manager->CurrentTask();
 	ENABLE_INTERRUPT;
@@ -681,6 +1164,10 @@ WithError<int> Terminal::ExecuteFile(const fat::DirectoryEntry* file, char* comm
 	if (auto err = SetupPageMaps(args_frame_addr, 1, true)) {
 		return { 0, err };
 	}
+	static_assert(kTimePageAddr + 4096 <= 0xffff'ffff'ffff'f000 - stack_size);
+	if (auto err = MapTimePage()) {
+		return { 0, err };
+	}
 
 	auto argc = MakeArgVector(command, args, argv, argv_len, argbuf, argbuf_len);
 	if (argc.error) {
@@ -688,24 +1175,23 @@ WithError<int> Terminal::ExecuteFile(const fat::DirectoryEntry* file, char* comm
 	}
 
 	for (int i = 0; i < 3; i++)
-		task.files.push_back(files[i]);
+		task.Files().push_back(files[i]);
 	
 	const uintptr_t elf_dpaging_begin = (app_load.vaddr_end + 0xfff) & ~static_cast<uintptr_t>(0xfff);
 	task.SetDPagingBegin(elf_dpaging_begin);
 	task.SetDPagingEnd(elf_dpaging_begin);
-	task.SetFileMapEnd(stack_frame_addr.value);
+	task.SetFileMapEnd(kTimePageAddr);
 
+	DISABLE_INTERRUPT;
+	task_manager->AccountCurrentTask(true);
+	ENABLE_INTERRUPT;
 	int ret = CallApp(argc.value, &argv[0], 3 << 3 | 3, app_load.entry, stack_frame_addr.value + stack_size - 8, &task.os_stack_ptr);
-
-	task.files.clear();
-	task.FileMaps().clear();
+	DISABLE_INTERRUPT;
+	task_manager->AccountCurrentTask(false);
+	ENABLE_INTERRUPT;
 	// PrintFormat("app exited with status: %d\n", ret);
 
-	if (auto err = CleanPageMaps(LinearAddress4Level{0xffff'8000'0000'0000})) {
-		return { ret, err };
-	}
-
-	if (auto err = FreePML4(task)) {
+	if (auto err = ReleaseAppSpace(task)) {
 		return { ret, err };
 	}
 	#if 0
@@ -721,11 +1207,7 @@ WithError<int> Terminal::ExecuteFile(const fat::DirectoryEntry* file, char* comm
 }
 
 void Terminal::ReDraw() {
-	Rect<int> draw_area { TitleBarWindow::TopLeftMargin, window->InnerSize() };
-	Message msg = MakeLayerMessage(taskID, layerID, LayerOperation::DrawPartial, draw_area);
-	DISABLE_INTERRUPT;
-	task_manager->SendMsg(MainTaskID, msg);
-	ENABLE_INTERRUPT;
+	DamageLayer(layerID, { TitleBarWindow::TopLeftMargin, window->InnerSize() });
 }
 
 TerminalFileDescriptor::TerminalFileDescriptor(Terminal& term) : term(term) {
@@ -740,21 +1222,24 @@ size_t TerminalFileDescriptor::Read(void* buf, size_t len) {
 
 	while (true) {
 		auto msg = task.Wait();
-		if (msg.type != Message::KeyPush || !msg.arg.keyboard.press) {
+		if (!msg) {
+			return 0; // 앱이 종료 중이다 (시스템콜 복귀 시 종료된다)
+		}
+		if (msg->type != Message::KeyPush || !msg->arg.keyboard.press) {
 			continue;
 		}
 
-		if (msg.arg.keyboard.modifier & (kLControlBitMask | kRControlBitMask)) {
+		if (msg->arg.keyboard.modifier & (kLControlBitMask | kRControlBitMask)) {
 			char s[3] = "^ ";
-			s[1] = toupper(msg.arg.keyboard.ascii);
+			s[1] = toupper(msg->arg.keyboard.ascii);
 			term.Print(s);
-			if (msg.arg.keyboard.keycode == 7 /* D */) {
+			if (msg->arg.keyboard.keycode == 7 /* D */) {
 				return 0; // EOT
 			}
 			continue;
 		}
 		
-		bufc[0] = msg.arg.keyboard.ascii;
+		bufc[0] = msg->arg.keyboard.ascii;
 		term.Print(bufc, 1); // echo back
 		term.ReDraw();
 		return 1;
@@ -795,19 +1280,22 @@ size_t PipeDescriptor::Read(void* buf, size_t len) {
 
 	while (true) {
 		auto msg = task.Wait();
-		if (msg.type != Message::Pipe) {
+		if (!msg) {
+			return 0; // 앱이 종료 중이다 (시스템콜 복귀 시 종료된다)
+		}
+		if (msg->type != Message::Pipe) {
 			continue;
 		}
 
-		if (msg.arg.pipe.len == 0) {
+		if (msg->arg.pipe.len == 0) {
 			closed = true;
 			return 0;
 		}
 
-		size_t copy_bytes = std::min<size_t>(len, msg.arg.pipe.len);
-		memcpy(buf, msg.arg.pipe.data, copy_bytes);
-		this->len = msg.arg.pipe.len - copy_bytes;
-		memcpy(data, msg.arg.pipe.data + copy_bytes, this->len);
+		size_t copy_bytes = std::min<size_t>(len, msg->arg.pipe.len);
+		memcpy(buf, msg->arg.pipe.data, copy_bytes);
+		this->len = msg->arg.pipe.len - copy_bytes;
+		memcpy(data, msg->arg.pipe.data + copy_bytes, this->len);
 		return copy_bytes;
 	}
 }
@@ -819,9 +1307,7 @@ size_t PipeDescriptor::Write(const void* buf, size_t len) {
 		msg.arg.pipe.len = std::min(len - sent_bytes, sizeof(msg.arg.pipe.data));
 		memcpy(msg.arg.pipe.data, bufc + sent_bytes, msg.arg.pipe.len);
 		sent_bytes += msg.arg.pipe.len;
-		DISABLE_INTERRUPT;
 		task_manager->SendMsg(task.ID(), msg);
-		ENABLE_INTERRUPT;
 	}
 	return sent_bytes;
 }
@@ -829,9 +1315,45 @@ size_t PipeDescriptor::Write(const void* buf, size_t len) {
 void PipeDescriptor::FinishWrite() {
 	Message msg{ Message::Pipe };
 	msg.arg.pipe.len = 0;
-	DISABLE_INTERRUPT;
 	task.SendMsg(msg);
-	ENABLE_INTERRUPT;
+}
+
+namespace {
+	struct SpawnArgs {
+		const fat::DirectoryEntry* file;
+		std::string command_line;
+		std::array<std::shared_ptr<FileDescriptor>, 3> files;
+	};
+
+	// SpawnApp으로 만든 Task의 entry point. 앱 하나를 실행하고 종료 코드를 그대로 Task의 종료 코드로 남긴다
+	void TaskSpawnApp(TaskID_t task_id, int64_t data) {
+		auto spawn_args = reinterpret_cast<SpawnArgs*>(data);
+		std::vector<char> line(spawn_args->command_line.begin(), spawn_args->command_line.end());
+		line.push_back('\0');
+
+		char* command = &line[0];
+		char* first_arg = strchr(command, ' ');
+		if (first_arg) {
+			*first_arg = 0;
+			++first_arg;
+		}
+
+		auto [ exit_code, err ] = RunApp(spawn_args->file, command, first_arg, spawn_args->files);
+		if (err) {
+			PrintToFD(*spawn_args->files[2], "Error occurred while executing %s:\n%s from file %s(at line %d)", command,
+				err.Name(), err.File(), err.Line());
+		}
+		delete spawn_args;
+
+		DISABLE_INTERRUPT;
+		task_manager->Finish(exit_code);
+	}
+}
+
+Task& SpawnApp(Task& task, const fat::DirectoryEntry* file, std::string command_line,
+               std::array<std::shared_ptr<FileDescriptor>, 3> files) {
+	auto spawn_args = new SpawnArgs{ file, std::move(command_line), std::move(files) };
+	return task.InitContext(TaskSpawnApp, reinterpret_cast<int64_t>(spawn_args)).Wakeup();
 }
 
 void TaskTerminal(TaskID_t taskID, int64_t data) {
@@ -866,69 +1388,70 @@ void TaskTerminal(TaskID_t taskID, int64_t data) {
 		ENABLE_INTERRUPT;
 	}
 
-	auto add_blink_timer = [taskID](unsigned long t) {
-		timer_manager->AddTimer(Timer{ t + static_cast<int>(kTimerFreq * 0.5), 1, taskID });	
-	};
-	add_blink_timer(timer_manager->CurrentTick());
+	const unsigned long blink_period = kTimerFreq * 0.5;
+	DISABLE_INTERRUPT;
+	const TimerID_t blink_timer = timer_manager->AddTimer(Timer{
+		timer_manager->CurrentTick() + blink_period, 1, taskID, blink_period, kCursorBlinkSlack
+	});
+	ENABLE_INTERRUPT;
 
 	bool window_isactive = true;
 
+	std::array<Message, 16> msgs;
 	while (true) {
-		DISABLE_INTERRUPT;
-		auto msg_opt = task.ReceiveMsg();
-		if (!msg_opt) {
-			task.Sleep();
-			ENABLE_INTERRUPT;
-			continue;
-		}
-		ENABLE_INTERRUPT;
-
-		Message msg = *msg_opt;
-
-		switch (msg.type) {
-			case Message::TimerTimeout: {
-				switch (msg.arg.timer.value) {
-					case 24: { // for debugging purposes
-						auto file = FindCommand("rpn");
-						char cmd[] = "rpn";
-						char args[] = "2 3 +";
-
-						terminal->ExecuteFile(file, cmd, args);
-					} break;
-					default: {
-						add_blink_timer(msg.arg.timer.timeout);
-						if (show_window && window_isactive) {
-							terminal->BlinkCursor();
-							auto area = terminal->GetCursorArea();
-							msg = MakeLayerMessage(taskID, terminal->LayerID(), LayerOperation::DrawPartial, area);
-
-							DISABLE_INTERRUPT;
-							task_manager->SendMsg(MainTaskID, msg);
-							ENABLE_INTERRUPT;
+		// 쌓여있는 메세지를 한 번에 꺼내고, 그동안 바뀐 영역은 묶음마다 한 번만 main task에 다시 그리도록 요청한다
+		size_t num_msgs = task.WaitMsgs(msgs.data(), msgs.size());
+		Rect<int> dirty_area{};
+
+		for (size_t i = 0; i < num_msgs; i++) {
+			const Message& msg = msgs[i];
+			switch (msg.type) {
+				case Message::TimerTimeout: {
+					switch (msg.arg.timer.value) {
+						case 24: { // for debugging purposes
+							auto file = FindCommand("rpn");
+							char cmd[] = "rpn";
+							char args[] = "2 3 +";
+
+							terminal->ExecuteFile(file, cmd, args);
+						} break;
+						case 1: {
+							if (show_window && window_isactive) {
+								terminal->BlinkCursor();
+								dirty_area = dirty_area | terminal->GetCursorArea();
+							}
 						}
 					}
-				}
-			} break;
-			case Message::WindowActive:
-				window_isactive = msg.arg.window_active.activate;
-				break;
-			case Message::KeyPush: {
-				auto& arg = msg.arg.keyboard;
-				if (msg.arg.keyboard.press) {
-					auto area = terminal->InputKey(arg.modifier, arg.keycode, arg.ascii);
-					if (show_window) {
-						msg = MakeLayerMessage(taskID, terminal->LayerID(), LayerOperation::DrawPartial, area);
-						DISABLE_INTERRUPT;
-						task_manager->SendMsg(MainTaskID, msg);
-						ENABLE_INTERRUPT;
+				} break;
+				case Message::WindowActive:
+					window_isactive = msg.arg.window_active.activate;
+					break;
+				case Message::KeyPush: {
+					auto& arg = msg.arg.keyboard;
+					if (msg.arg.keyboard.press) {
+						// Enter는 앱을 실행할 수 있고 앱은 이 Task의 메세지를 읽으므로, 그 뒤에 입력된 키가 앱에 전달되도록
+						// 묶음의 나머지를 메일박스에 되돌린다
+						if (arg.ascii == '\n' && i + 1 < num_msgs) {
+							task.PutBackMsgs(&msgs[i + 1], num_msgs - i - 1);
+							num_msgs = i + 1;
+						}
+						auto area = terminal->InputKey(arg.modifier, arg.keycode, arg.ascii);
+						if (show_window) {
+							dirty_area = dirty_area | area;
+						}
 					}
-				}
-			} break;
-			case Message::WindowClose:
-				CloseLayer(msg.arg.window_close.layer_id);
-				DISABLE_INTERRUPT;
-				task_manager->Finish(terminal->ExitCode());
-			default: break;
+				} break;
+				case Message::WindowClose:
+					CloseLayer(msg.arg.window_close.layer_id);
+					DISABLE_INTERRUPT;
+					timer_manager->CancelTimer(blink_timer);
+					task_manager->Finish(terminal->ExitCode());
+				default: break;
+			}
+		}
+
+		if (dirty_area.size.x > 0 && dirty_area.size.y > 0) {
+			DamageLayer(terminal->LayerID(), dirty_area);
 		}
 	}
 }
@@ -90,3 +90,25 @@ private:
 extern std::map<uint64_t, Terminal*>* terminals;
 
 void TaskTerminal(TaskID_t taskID, int64_t data);
+/**
+ * @brief 경로 cmd 또는 apps 디렉토리에서 실행 파일을 찾습니다
+ * @return 찾지 못했거나 디렉토리면 nullptr
+ */
+fat::DirectoryEntry* FindCommand(const char* cmd, unsigned long dir_cluster = 0);
+/**
+ * @brief 현재 Task에서 앱을 로드하고 실행한 뒤 주소 공간을 해제합니다. files는 앱의 fd 0, 1, 2가 됩니다
+ * @return 앱의 종료 코드
+ */
+WithError<int> RunApp(const fat::DirectoryEntry* file, char* command, char* args, const std::array<std::shared_ptr<FileDescriptor>, 3>& files);
+/**
+ * @brief Terminal과 창 없이 task에서 앱 하나를 실행합니다 (posix_spawn). task는 NewTask()로 만든, 아직 초기화되지 않은 Task여야 합니다.
+ * command_line은 "명령 인자..." 형식이며 공백으로 나뉘어 argv가 됩니다. 앱이 종료되면 종료 코드는 WaitFinish로 얻을 수 있습니다.
+ * @return task (깨어난 상태)
+ */
+Task& SpawnApp(Task& task, const fat::DirectoryEntry* file, std::string command_line,
+               std::array<std::shared_ptr<FileDescriptor>, 3> files);
+/**
+ * @brief 앱이 종료된 Task의 스레드를 모두 회수하고 파일 테이블, 타이머, user 주소 공간을 해제합니다.
+ * 현재 Task(task)의 CR3가 해제되므로 커널 PML4로 전환됩니다.
+ */
+Error ReleaseAppSpace(Task& task);
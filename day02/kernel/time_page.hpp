@@ -0,0 +1,30 @@
+#pragma once
+
+#ifdef __cplusplus
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 모든 앱의 TIME_PAGE_ADDR에 읽기 전용으로 매핑되는 시간 정보 페이지 (vDSO).
+ * 커널은 타이머 인터럽트마다 seqlock(seq)으로 갱신하며, 앱은 시스템콜 없이 현재 시각을 계산할 수 있다 (apps/clock.h).
+ */
+#define TIME_PAGE_ADDR 0xfffffffffffee000ull // user 스택 바로 아래
+
+struct TimePage {
+	uint32_t seq;			// 홀수면 갱신 중. 읽기 전후의 값이 같고 짝수여야 읽은 값이 유효하다
+	uint32_t reserved;
+	uint64_t tick;			// 타이머 tick
+	uint64_t tick_freq;		// 초당 tick 수
+	uint64_t tsc_at_tick;	// tick이 증가한 시점의 TSC
+	uint64_t tsc_freq;		// TSC 주파수 (Hz, 측정하지 못했으면 0)
+};
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,8 +1,13 @@
 #include "timer.hpp"
 #include "acpi.hpp"
 #include "task.hpp"
+#include "asmfunc.h"
+#include "memory_manager.hpp"
+#include "paging.hpp"
 
 #include <limits>
+#include <algorithm>
+#include <cstring>
 
 union LVTTimer {
 	uint32_t data;
@@ -41,6 +46,41 @@ namespace {
 }
 
 unsigned long lapic_timer_freq = kDefaultLAPICTimerFreq;
+unsigned long tsc_freq = 0;
+
+namespace {
+	TimePage* time_page; // identity map을 통해 커널이 갱신한다
+
+	void InitializeTimePage() {
+		auto frame = memory_manager->Allocate(1);
+		if (!frame.has_value) {
+			return;
+		}
+		auto page = reinterpret_cast<TimePage*>(frame.value.Frame());
+		memset(page, 0, BytesPerFrame);
+		page->tick_freq = kTimerFreq;
+		page->tsc_freq = tsc_freq;
+		page->tsc_at_tick = ReadTSC();
+		time_page = page; // 초기화가 끝난 뒤에 Tick에 공개한다
+	}
+
+	// 타이머 인터럽트에서만 호출되므로 writer는 하나다
+	void UpdateTimePage(unsigned long tick) {
+		const uint32_t seq = time_page->seq;
+		__atomic_store_n(&time_page->seq, seq + 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		time_page->tick = tick;
+		time_page->tsc_at_tick = ReadTSC();
+		__atomic_store_n(&time_page->seq, seq + 2, __ATOMIC_RELEASE);
+	}
+}
+
+Error MapTimePage() {
+	if (time_page == nullptr) {
+		return MAKE_ERROR(Error::kNoEnoughMemory);
+	}
+	return MapSharedPage(LinearAddress4Level{kTimePageAddr}, time_page);
+}
 
 void InitLAPICTimer(const acpi::FADT* fadt) {
 	timer_manager = new TimerManager;
@@ -54,14 +94,19 @@ void InitLAPICTimer(const acpi::FADT* fadt) {
 		oneshot.bits.timer_mode = 0; // oneshot
 		*lvt_timer = oneshot.data;
 
+		const auto tsc_begin = ReadTSC();
 		StartLAPICTimer();
 		acpi::WaitMilliseconds(fadt, 100); // ACPI PM 타이머를 사용해서 약 100ms (0.1s) 대기한다
 		const auto elapsed = LAPICTimerElapsed();
 		StopLAPICTimer();
+		const auto tsc_elapsed = ReadTSC() - tsc_begin;
 
 		lapic_timer_freq = static_cast<unsigned long>(elapsed) * 10; // Hz
+		tsc_freq = tsc_elapsed * 10; // Hz
 	}
 
+	InitializeTimePage(); // 주기 타이머 인터럽트가 시작되기 전에 준비한다
+
 	LVTTimer timer = {};
 	timer.bits.vector_id = InterruptVector::LAPICTImer;
 	timer.bits.mask = 0; // enable interrupt (to vector_id)
@@ -86,51 +131,317 @@ uint32_t LAPICTimerElapsed() {
 
 TimerManager* timer_manager;
 
-Timer::Timer(unsigned long timeout, int value, TaskID_t task_id) : timeout{timeout}, value{value}, task_id{task_id} {
+Timer::Timer(unsigned long timeout, int value, TaskID_t task_id, unsigned long period, unsigned long slack)
+	: timeout{timeout}, value{value}, task_id{task_id}, period{period}, slack{slack} {
+
+}
+
+Timer::Timer(unsigned long timeout, WorkFunc* func, uint64_t arg, WorkPriority prio, unsigned long period, unsigned long slack)
+	: timeout{timeout}, period{period}, slack{slack}, callback{func}, callback_arg{arg}, callback_prio{prio} {
 
 }
 
 TimerManager::TimerManager() {
-	timers.push(Timer{std::numeric_limits<unsigned long>::max(), -1, MainTaskID}); // 파수꾼(sentinel) 테크닉
+	for (auto& level : wheel) {
+		level.fill(kNil);
+	}
+}
+
+TimerID_t TimerManager::AddTimer(const Timer& timer) {
+	const uint32_t idx = Allocate();
+	nodes[idx].timer = timer;
+	nodes[idx].expires = ApplySlack(timer);
+	Link(idx, tick + 1); // 이미 지난 타임아웃은 다음 틱에 만료시킨다
+	return MakeID(idx);
+}
+
+Error TimerManager::CancelTimer(TimerID_t id) {
+	auto node = Lookup(id);
+	if (node == nullptr) {
+		return MAKE_ERROR(Error::kNoSuchEntry);
+	}
+
+	const uint32_t idx = node - nodes.data();
+	Unlink(idx);
+	Free(idx);
+	return MAKE_ERROR(Error::kSuccess);
+}
+
+Error TimerManager::RearmTimer(TimerID_t id, unsigned long timeout) {
+	auto node = Lookup(id);
+	if (node == nullptr) {
+		return MAKE_ERROR(Error::kNoSuchEntry);
+	}
+
+	const uint32_t idx = node - nodes.data();
+	Unlink(idx);
+	node->timer.SetTimeout(timeout);
+	node->expires = ApplySlack(node->timer);
+	Link(idx, tick + 1);
+	return MAKE_ERROR(Error::kSuccess);
+}
+
+const Timer* TimerManager::FindTimer(TimerID_t id) const {
+	auto node = Lookup(id);
+	return node ? &node->timer : nullptr;
+}
+
+void TimerManager::CancelAppTimers(TaskID_t task_id) {
+	for (uint32_t idx = 0; idx < nodes.size(); ++idx) {
+		const auto& node = nodes[idx];
+		if (node.level == kFreeLevel) continue;
+		if (node.timer.TaskID() == task_id && node.timer.Value() < 0) {
+			Unlink(idx);
+			Free(idx);
+		}
+	}
+}
+
+uint32_t& TimerManager::ListHead(const Node& node) {
+	if (node.level == kOverflowLevel) {
+		return overflow;
+	}
+	return wheel[node.level][node.slot];
+}
+
+uint32_t TimerManager::Allocate() {
+	if (free_head == kNil) { // 풀이 가득 찬 경우에만 노드 배열을 두 배로 늘린다
+		const uint32_t old_size = nodes.size();
+		const uint32_t new_size = std::max<uint32_t>(64, old_size * 2);
+		nodes.resize(new_size);
+		for (uint32_t i = new_size; i-- > old_size; ) {
+			nodes[i].next = free_head;
+			free_head = i;
+		}
+	}
+
+	const uint32_t idx = free_head;
+	free_head = nodes[idx].next;
+	++num_timers;
+	return idx;
+}
+
+void TimerManager::Free(uint32_t idx) {
+	auto& node = nodes[idx];
+	node.level = kFreeLevel;
+	node.prev = kNil;
+	node.next = free_head;
+	++node.generation; // 기존 handle을 무효화한다
+	free_head = idx;
+	--num_timers;
 }
 
-void TimerManager::AddTimer(const Timer &timer) {
-	timers.push(timer);
+unsigned long TimerManager::ApplySlack(const Timer& timer) {
+	const unsigned long timeout = timer.Timeout();
+	const unsigned long slack = std::min(timer.Slack(), timeout);
+	if (slack == 0) {
+		return timeout;
+	}
+
+	// [timeout - slack, timeout + slack] 안에서 가장 큰 2의 거듭제곱 배수인 틱으로 정렬한다
+	unsigned long align = 1;
+	while (align * 2 <= slack * 2) {
+		align *= 2;
+	}
+	return (timeout + slack) & ~(align - 1);
 }
 
-#include "logger.hpp"
+void TimerManager::Link(uint32_t idx, unsigned long earliest) {
+	auto& node = nodes[idx];
+	const unsigned long expires = std::max(node.expires, earliest);
+	const unsigned long delta = expires - tick;
+
+	node.level = kOverflowLevel;
+	node.slot = 0;
+	for (int lvl = 0; lvl < kWheelLevels; ++lvl) {
+		if (delta < (1ul << (kWheelBits * (lvl + 1)))) {
+			node.level = lvl;
+			node.slot = (expires >> (kWheelBits * lvl)) & kSlotMask;
+			break;
+		}
+	}
+
+	uint32_t& head = ListHead(node);
+	node.prev = kNil;
+	node.next = head;
+	if (head != kNil) {
+		nodes[head].prev = idx;
+	}
+	head = idx;
+}
+
+void TimerManager::Unlink(uint32_t idx) {
+	auto& node = nodes[idx];
+	if (node.prev != kNil) {
+		nodes[node.prev].next = node.next;
+	} else {
+		ListHead(node) = node.next;
+	}
+	if (node.next != kNil) {
+		nodes[node.next].prev = node.prev;
+	}
+	node.prev = node.next = kNil;
+}
+
+void TimerManager::Cascade(uint32_t& head) {
+	uint32_t idx = head;
+	head = kNil;
+	while (idx != kNil) {
+		const uint32_t next = nodes[idx].next;
+		Link(idx, tick);
+		idx = next;
+	}
+}
+
+TimerManager::Node* TimerManager::Lookup(TimerID_t id) {
+	return const_cast<Node*>(static_cast<const TimerManager*>(this)->Lookup(id));
+}
+
+const TimerManager::Node* TimerManager::Lookup(TimerID_t id) const {
+	const uint32_t idx = static_cast<uint32_t>(id) - 1;
+	const uint32_t generation = id >> 32;
+	if (id == kInvalidTimerID || idx >= nodes.size()) {
+		return nullptr;
+	}
+
+	const auto& node = nodes[idx];
+	if (node.level == kFreeLevel || node.generation != generation) {
+		return nullptr;
+	}
+	return &node;
+}
+
+TimerID_t TimerManager::MakeID(uint32_t idx) const {
+	return static_cast<TimerID_t>(nodes[idx].generation) << 32 | (idx + 1);
+}
 
 bool TimerManager::Tick() {
 	++tick;
+	if (time_page) {
+		UpdateTimePage(tick);
+	}
+
+	// 상위 레벨부터 현재 구간에 진입한 슬롯을 하위 레벨로 내린다
+	if ((tick & kSlotMask) == 0) {
+		int lvl = 1;
+		while (lvl < kWheelLevels && (tick & ((1ul << (kWheelBits * (lvl + 1))) - 1)) == 0) {
+			++lvl;
+		}
+		if (lvl == kWheelLevels) {
+			Cascade(overflow);
+		}
+		for (lvl = std::min(lvl, kWheelLevels - 1); lvl >= 1; --lvl) {
+			Cascade(wheel[lvl][(tick >> (kWheelBits * lvl)) & kSlotMask]);
+		}
+	}
 
 	bool task_timer_timeout = false;
-	while (true) {
-		const auto& t = timers.top();
-		if (t.Timeout() > tick) { break; } // 타임아웃된 Timer가 없으므로 루프를 종료한다
+	bool sent_msg = false;
+	uint32_t& head = wheel[0][tick & kSlotMask];
+	uint32_t idx = head;
+	head = kNil;
+
+	while (idx != kNil) {
+		auto& node = nodes[idx];
+		const uint32_t next = node.next;
+		const Timer t = node.timer;
+
+		if (node.expires > tick) { // 아직 만료되지 않은 Timer (발생하지 않아야 함)
+			Link(idx, tick + 1);
+			idx = next;
+			continue;
+		}
 
 		if (t.Value() == kTaskTimerValue) { // 콘텍스트 스위칭 주기 타이머인 경우 특수 처리한다
 			task_timer_timeout = true;
-			timers.pop();
-			timers.push(Timer(tick + kTaskTimerPeriod, kTaskTimerValue, MainTaskID));
-			continue;
+		} else if (t.Callback()) { // 콜백은 인터럽트 핸들러 밖(worker Task)에서 실행한다
+			QueueWork(t.CallbackPriority(), t.Callback(), t.CallbackArg());
+			++expired_timers;
+			sent_msg = true;
+		} else {
+			// Timer t가 타임아웃됐다면 TimerTimeout 메세지를 보낸다
+			Message m{Message::TimerTimeout};
+			m.arg.timer.timeout = t.Timeout();
+			m.arg.timer.value = t.Value();
+			task_manager->SendMsg(t.TaskID(), m);
+			++expired_timers;
+			sent_msg = true;
 		}
 
-		// Timer t가 타임아웃됐다면 TimerTimeout 메세지를 보내면서 t를 제거한다
-		Message m{Message::TimerTimeout};
-		m.arg.timer.timeout = t.Timeout();
-		m.arg.timer.value = t.Value();
-		task_manager->SendMsg(t.TaskID(), m);
-		timers.pop();
+		if (t.Period() > 0) { // 주기 타이머는 handle을 유지한 채 다시 등록한다
+			nodes[idx].timer.SetTimeout(std::max(t.Timeout() + t.Period(), tick + 1));
+			nodes[idx].expires = ApplySlack(nodes[idx].timer);
+			Link(idx, tick + 1);
+		} else {
+			Free(idx);
+		}
+		idx = next;
 	}
 
+	if (sent_msg) {
+		++wakeup_passes;
+	}
 	return task_timer_timeout;
 }
 
+TimerBenchResult BenchmarkTimerManager(int num_timers) {
+	static TimerManager* bench = nullptr; // 커널 힙은 해제되지 않으므로 재사용한다
+	if (bench == nullptr) {
+		bench = new TimerManager;
+	}
+
+	std::vector<TimerID_t> ids(num_timers);
+	uint64_t seed = 88172645463325252ull;
+	auto next_timeout = [&seed]() { // xorshift
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+		return 1 + seed % (1ul << 20);
+	};
+
+	TimerBenchResult res{num_timers, 0, 0, 0};
+
+	auto t0 = ReadTSC();
+	for (int i = 0; i < num_timers; ++i) {
+		ids[i] = bench->AddTimer(Timer{next_timeout(), 1, 0});
+	}
+	auto t1 = ReadTSC();
+	res.insert_cycles = t1 - t0;
+
+	// num_timers개가 등록된 상태에서 등록+취소를 반복한다
+	t0 = ReadTSC();
+	for (int i = 0; i < num_timers; ++i) {
+		bench->CancelTimer(ids[i]);
+		ids[i] = bench->AddTimer(Timer{next_timeout(), 1, 0});
+	}
+	t1 = ReadTSC();
+	res.churn_cycles = t1 - t0;
+
+	t0 = ReadTSC();
+	for (int i = num_timers; i-- > 0; ) {
+		bench->CancelTimer(ids[i]);
+	}
+	t1 = ReadTSC();
+	res.cancel_cycles = t1 - t0;
+
+	return res;
+}
+
 extern "C" void LAPICTimerOnInterrupt(const TaskContext& ctx_stack) {
 	const bool task_timer_timeout = timer_manager->Tick();
 	NotifyEOI();
+	if (!task_manager) { // 타이머는 InitTask보다 먼저 시작된다
+		return;
+	}
+
+	// 종료 중인 앱의 스레드가 user mode를 실행하고 있었다면 (무한 루프 등) 돌아가지 않고 종료한다
+	if ((ctx_stack.cs & 3) == 3) {
+		ExitIfAppExiting();
+	}
 
 	if (task_timer_timeout) {
-		task_manager->SwitchTask(ctx_stack);
+		task_manager->OnTaskTimer(ctx_stack);
+	} else if (task_manager->NeedResched()) { // 타이머 메세지로 상위 레벨의 Task가 깨어난 경우
+		task_manager->SwitchTask(ctx_stack, false);
 	}
 }
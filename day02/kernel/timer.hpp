@@ -2,11 +2,14 @@
 
 #include <cstdint>
 #include <limits>
-#include <deque>
-#include <queue>
+#include <array>
+#include <vector>
+#include "error.hpp"
 #include "message.hpp"
 #include "interrupt.hpp"
 #include "task.hpp"
+#include "workqueue.hpp"
+#include "time_page.hpp"
 
 namespace acpi { struct FADT; }
 
@@ -15,47 +18,149 @@ void StartLAPICTimer();
 void StopLAPICTimer();
 uint32_t LAPICTimerElapsed();
 
+using TimerID_t = uint64_t;
+constexpr TimerID_t kInvalidTimerID = 0;
+
 class Timer {
 public:
+	Timer() = default;
 	/** @brief Constructs Timer 
 	 * @param timeout timeout duration for this timer
 	 * @param value value to send when timeout
 	 * @param task_id destination task ID
+	 * @param period re-arm interval in ticks (0 for oneshot timers)
+	 * @param slack allowed deviation (+/-) from timeout in ticks; lets TimerManager coalesce nearby timers
+	 */
+	Timer(unsigned long timeout, int value, TaskID_t task_id, unsigned long period = 0, unsigned long slack = 0);
+	/** @brief Constructs callback Timer; func(arg) is run on the prio work queue instead of sending a message
+	 * @param period re-arm interval in ticks (0 for oneshot timers)
+	 * @param slack allowed deviation (+/-) from timeout in ticks
 	 */
-	Timer(unsigned long timeout, int value, TaskID_t task_id);
+	Timer(unsigned long timeout, WorkFunc* func, uint64_t arg, WorkPriority prio, unsigned long period = 0, unsigned long slack = 0);
 
 	unsigned long Timeout() const { return timeout; }
 	int Value() const { return value; }
 	uint64_t TaskID() const { return task_id; }
+	unsigned long Period() const { return period; }
+	unsigned long Slack() const { return slack; }
+	WorkFunc* Callback() const { return callback; }
+	uint64_t CallbackArg() const { return callback_arg; }
+	WorkPriority CallbackPriority() const { return callback_prio; }
+	void SetTimeout(unsigned long t) { timeout = t; }
 
 private:
-	unsigned long timeout;
-	int value;
-	TaskID_t task_id;
+	unsigned long timeout{0};
+	int value{0};
+	TaskID_t task_id{0};
+	unsigned long period{0};
+	unsigned long slack{0};
+	WorkFunc* callback{nullptr}; // nullptr가 아니면 메세지 대신 work queue에서 호출된다
+	uint64_t callback_arg{0};
+	WorkPriority callback_prio{kWorkNormal};
 };
 
-inline bool operator<(const Timer& lhs, const Timer& rhs) {
-	return lhs.Timeout() > rhs.Timeout();
-}
+struct TimerStat {
+	size_t num_timers;
+	uint64_t expired_timers; // 만료되어 메세지를 보낸 Timer 수
+	uint64_t wakeup_passes;  // 메세지를 1개 이상 보낸 틱 수
+};
 
+/**
+ * @brief 계층형 타이밍 휠(hierarchical timing wheel)로 Timer를 관리합니다.
+ * @details 레벨 l의 슬롯 하나는 64^l 틱을 담당하며, 상위 레벨의 슬롯은 해당 구간에 진입할 때
+ * 하위 레벨로 내려옵니다(cascade). 등록, 취소, 만료 처리 모두 O(1)입니다.
+ * Timer 노드는 내부 풀에서 재사용되므로 풀이 가득 찬 경우를 제외하면 메모리 할당이 없습니다.
+ * slack이 지정된 Timer는 허용 범위 안에서 2의 거듭제곱 틱 경계로 정렬되므로,
+ * 서로의 slack 안에 있는 Timer들은 같은 틱에 함께 만료됩니다.
+ */
 class TimerManager {
 public:
+	static constexpr int kWheelBits = 6;
+	static constexpr int kWheelLevels = 4;
+	static constexpr unsigned long kWheelSlots = 1ul << kWheelBits;
+
 	TimerManager();
-	void AddTimer(const Timer& timer);
+	/**
+	 * @brief Timer를 등록합니다.
+	 * @return 등록된 Timer의 handle (CancelTimer, RearmTimer에 사용됩니다)
+	 */
+	TimerID_t AddTimer(const Timer& timer);
+	/**
+	 * @brief 등록된 Timer를 취소합니다.
+	 * @return 이미 만료되었거나 존재하지 않는 handle인 경우 Error::kNoSuchEntry
+	 */
+	Error CancelTimer(TimerID_t id);
+	/**
+	 * @brief 등록된 Timer의 타임아웃을 변경합니다. handle은 그대로 유지됩니다.
+	 */
+	Error RearmTimer(TimerID_t id, unsigned long timeout);
+	const Timer* FindTimer(TimerID_t id) const;
+	// task_id의 애플리케이션 Timer(value < 0)를 모두 취소합니다.
+	void CancelAppTimers(TaskID_t task_id);
 	bool Tick();
 	unsigned long CurrentTick() const { return tick; }
-	auto Top() { return timers.top(); }
+	size_t NumTimers() const { return num_timers; }
+	TimerStat Stat() const { return { num_timers, expired_timers, wakeup_passes }; }
 private:
+	static constexpr uint32_t kNil = std::numeric_limits<uint32_t>::max();
+	static constexpr uint16_t kFreeLevel = 0xffff;
+	static constexpr uint16_t kOverflowLevel = kWheelLevels;
+	static constexpr unsigned long kSlotMask = kWheelSlots - 1;
+
+	struct Node {
+		Timer timer{};
+		unsigned long expires{0}; // slack을 적용한 실제 만료 틱
+		uint32_t prev{kNil}, next{kNil};
+		uint32_t generation{0};
+		uint16_t level{kFreeLevel}, slot{0};
+	};
+
 	volatile unsigned long tick{0};
-	std::priority_queue<Timer> timers{};
+	std::vector<Node> nodes{};
+	uint32_t free_head{kNil};
+	size_t num_timers{0};
+	uint64_t expired_timers{0}, wakeup_passes{0};
+	std::array<std::array<uint32_t, kWheelSlots>, kWheelLevels> wheel;
+	uint32_t overflow{kNil}; // 휠 범위(64^4 틱)를 넘어서는 Timer들
+
+	uint32_t& ListHead(const Node& node);
+	uint32_t Allocate();
+	void Free(uint32_t idx);
+	static unsigned long ApplySlack(const Timer& timer);
+	void Link(uint32_t idx, unsigned long earliest);
+	void Unlink(uint32_t idx);
+	void Cascade(uint32_t& head);
+	Node* Lookup(TimerID_t id);
+	const Node* Lookup(TimerID_t id) const;
+	TimerID_t MakeID(uint32_t idx) const;
 };
 
+struct TimerBenchResult {
+	int num_timers;
+	uint64_t insert_cycles, churn_cycles, cancel_cycles;
+};
+
+/**
+ * @brief 독립된 TimerManager에 num_timers개의 Timer를 등록한 상태에서 등록/취소 성능을 측정합니다.
+ * @return 각 단계에서 소요된 TSC 사이클 수
+ */
+TimerBenchResult BenchmarkTimerManager(int num_timers);
+
 extern TimerManager* timer_manager;
 extern unsigned long lapic_timer_freq;
+extern unsigned long tsc_freq; // Hz (ACPI 타이머가 없어서 측정하지 못한 경우 0)
+
+constexpr uint64_t kTimePageAddr = TIME_PAGE_ADDR;
+/**
+ * @brief 현재 CR3의 kTimePageAddr에 시간 정보 페이지(time_page.hpp)를 읽기 전용으로 매핑합니다.
+ * 페이지는 모든 앱이 공유하며, 주소 공간을 해제해도 해제되지 않습니다.
+ */
+Error MapTimePage();
 constexpr int kDefaultLAPICTimerFreq = 100;
 constexpr int kTimerFreq = 100;
 
-constexpr int kTaskTimerPeriod = static_cast<int>(kTimerFreq * 0.02);
+constexpr int kTaskTimerPeriod = static_cast<int>(kTimerFreq * 0.01); // 스케줄러 틱 (레벨별 time slice는 TaskManager::TimeSlice)
+constexpr unsigned long kCursorBlinkSlack = static_cast<unsigned long>(kTimerFreq * 0.05); // +/-50ms
 constexpr int kTaskTimerValue = std::numeric_limits<int>::max();
 
 /*
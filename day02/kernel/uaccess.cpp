@@ -0,0 +1,65 @@
+#include "uaccess.hpp"
+#include "asmfunc.h"
+#include <algorithm>
+#include <cerrno>
+
+namespace {
+	constexpr uintptr_t kUserSpaceBegin = 0xffff'8000'0000'0000;
+
+	struct ExceptionTableEntry {
+		uint64_t fault_ip, fixup;
+	};
+}
+
+extern "C" const ExceptionTableEntry ex_table[], ex_table_end[];
+
+bool AccessOK(const void* p, size_t len) {
+	const auto addr = reinterpret_cast<uintptr_t>(p);
+	// 상위 절반은 주소 공간의 끝까지이므로 addr + len이 넘치지 않으면 된다
+	return addr >= kUserSpaceBegin && addr + len >= addr;
+}
+
+size_t CopyFromUser(void* dst, const void* src, size_t len) {
+	if (!AccessOK(src, len)) {
+		return len;
+	}
+	return CopyUserBytes(dst, src, len);
+}
+
+size_t CopyToUser(void* dst, const void* src, size_t len) {
+	if (!AccessOK(dst, len)) {
+		return len;
+	}
+	return CopyUserBytes(dst, src, len);
+}
+
+int64_t StrncpyFromUser(char* dst, const char* src, size_t n) {
+	const auto addr = reinterpret_cast<uintptr_t>(src);
+	if (addr < kUserSpaceBegin) {
+		return -EFAULT;
+	}
+	// 주소 공간의 끝을 넘어 커널 영역(하위 절반)으로 이어 읽지 않도록 자른다
+	const size_t limit = std::min<size_t>(n, -addr);
+	const int64_t len = StrncpyFromUserBytes(dst, src, limit);
+	if (len < 0 || (static_cast<size_t>(len) == limit && limit < n)) {
+		return -EFAULT;
+	}
+	return len;
+}
+
+bool GetUser32(const uint32_t* src, uint32_t& dst) {
+	return AccessOK(src, sizeof(uint32_t)) && LoadUser32(src, &dst) == 0;
+}
+
+bool PutUser32(uint32_t* dst, uint32_t value) {
+	return AccessOK(dst, sizeof(uint32_t)) && StoreUser32(dst, value) == 0;
+}
+
+uint64_t SearchExceptionTable(uint64_t rip) {
+	for (auto e = ex_table; e != ex_table_end; ++e) {
+		if (e->fault_ip == rip) {
+			return e->fixup;
+		}
+	}
+	return 0;
+}
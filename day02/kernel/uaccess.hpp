@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * 시스템콜이 user 메모리를 읽고 쓸 때 사용하는 함수.
+ * 포인터가 user 영역을 가리키는지만 확인하고 바로 접근하며, 매핑되지 않은 주소라서 page fault를 처리할 수 없으면
+ * IntHandlerPF가 예외 테이블(asmfunc.asm의 ex_table)에서 fixup을 찾아 복사를 중단시킨다.
+ * 따라서 잘못된 포인터를 넘긴 앱 때문에 커널이 멈추지 않고 시스템콜이 EFAULT를 반환할 수 있다.
+ */
+
+/** @brief [p, p + len)이 모두 user 영역(상위 절반)에 있으면 true */
+bool AccessOK(const void* p, size_t len);
+
+/**
+ * @brief user 메모리 src에서 커널 메모리 dst로 len 바이트를 복사합니다
+ * @return 복사하지 못한 바이트 수 (성공하면 0)
+ */
+size_t CopyFromUser(void* dst, const void* src, size_t len);
+/**
+ * @brief 커널 메모리 src에서 user 메모리 dst로 len 바이트를 복사합니다
+ * @return 복사하지 못한 바이트 수 (성공하면 0)
+ */
+size_t CopyToUser(void* dst, const void* src, size_t len);
+/**
+ * @brief user 문자열 src를 NUL까지 최대 n 바이트 dst에 복사합니다
+ * @return 문자열 길이 (NUL 제외). n 바이트 안에 NUL이 없으면 n을 반환하며 이때 dst는 NUL로 끝나지 않는다.
+ * 읽을 수 없는 주소면 -EFAULT
+ */
+int64_t StrncpyFromUser(char* dst, const char* src, size_t n);
+
+// 정렬된 4바이트 접근. 한 번의 mov로 읽고 쓰므로 다른 스레드와 공유하는 변수(futex word, ring의 head/tail)에 사용한다
+bool GetUser32(const uint32_t* src, uint32_t& dst);
+bool PutUser32(uint32_t* dst, uint32_t value);
+
+template <class T>
+bool GetUser(T& dst, const T* src) {
+	return CopyFromUser(&dst, src, sizeof(T)) == 0;
+}
+
+template <class T>
+bool PutUser(T* dst, const T& src) {
+	return CopyToUser(dst, &src, sizeof(T)) == 0;
+}
+
+/** @brief fault가 난 rip가 user 메모리 접근 루틴이면 복귀할 fixup 주소를, 아니면 0을 반환합니다 */
+uint64_t SearchExceptionTable(uint64_t rip);
@@ -0,0 +1,27 @@
+#pragma once
+
+#ifdef __cplusplus
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WIN_BLIT_COLOR_KEY 1u // color_key와 같은 색(하위 24비트)의 픽셀은 그리지 않는다
+
+/* SyscallWinBlit으로 창에 복사할 이미지. 픽셀은 SyscallWinFillRect의 color와 같은 0x00RRGGBB 형식이다 */
+struct WinBlitImage {
+	const uint32_t* pixels;	// 첫 줄의 첫 픽셀
+	int32_t width, height;
+	int32_t stride;			// 한 줄의 픽셀 수 (0이면 width)
+	uint32_t flags;			// WIN_BLIT_*
+	uint32_t color_key;
+	uint32_t reserved;
+};
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+
+#ifdef __cplusplus
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+
+#include "win_blit.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WIN_DRAW_MAX_CMDS  4096  /* SyscallWinDraw 한 번에 넘길 수 있는 명령 수 */
+#define WIN_DRAW_MAX_TEXT  256   /* WIN_DRAW_TEXT 문자열의 최대 바이트 수 (NUL 제외) */
+#define WIN_DRAW_MAX_COORD 32767 /* 좌표와 크기는 -WIN_DRAW_MAX_COORD ~ WIN_DRAW_MAX_COORD */
+
+/* SyscallWinDraw 명령. 좌표는 SyscallWinFillRect와 같이 창의 테두리를 포함한다 */
+enum WinDrawOp {
+	WIN_DRAW_CLIP,      /* 이후의 명령을 (x, y, w, h) 안에만 그린다. w나 h가 음수면 창 전체 */
+	WIN_DRAW_FILL_RECT, /* (x, y, w, h)를 color로 채운다 */
+	WIN_DRAW_LINE,      /* (x, y)에서 (w, h)까지 color로 선을 긋는다 (끝점 포함) */
+	WIN_DRAW_TEXT,      /* (x, y)에 color로 data(UTF-8, NUL로 끝남)를 쓴다 */
+	WIN_DRAW_BLIT,      /* (x, y)에 data(const struct WinBlitImage*)를 복사한다 (SyscallWinBlit) */
+	WIN_DRAW_NUM_OPS,
+};
+
+struct WinDrawCmd {
+	uint32_t op;		/* enum WinDrawOp */
+	uint32_t color;		/* 0x00RRGGBB */
+	int32_t x, y, w, h;
+	const void* data;
+};
+
+static inline struct WinDrawCmd WinDrawClipCmd(int x, int y, int w, int h) {
+	struct WinDrawCmd cmd = { WIN_DRAW_CLIP, 0, x, y, w, h, 0 };
+	return cmd;
+}
+
+static inline struct WinDrawCmd WinDrawFillRectCmd(int x, int y, int w, int h, uint32_t color) {
+	struct WinDrawCmd cmd = { WIN_DRAW_FILL_RECT, color, x, y, w, h, 0 };
+	return cmd;
+}
+
+static inline struct WinDrawCmd WinDrawLineCmd(int x0, int y0, int x1, int y1, uint32_t color) {
+	struct WinDrawCmd cmd = { WIN_DRAW_LINE, color, x0, y0, x1, y1, 0 };
+	return cmd;
+}
+
+static inline struct WinDrawCmd WinDrawTextCmd(int x, int y, uint32_t color, const char* s) {
+	struct WinDrawCmd cmd = { WIN_DRAW_TEXT, color, x, y, 0, 0, s };
+	return cmd;
+}
+
+static inline struct WinDrawCmd WinDrawBlitCmd(int x, int y, const struct WinBlitImage* image) {
+	struct WinDrawCmd cmd = { WIN_DRAW_BLIT, 0, x, y, 0, 0, image };
+	return cmd;
+}
+
+#ifdef __cplusplus
+}
+#endif
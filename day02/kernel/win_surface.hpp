@@ -0,0 +1,43 @@
+#pragma once
+
+#ifdef __cplusplus
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WIN_SURFACE_BUFFERS 2
+
+#define WIN_SURFACE_XRGB8888 0 /* uint32_t 픽셀 = 0x00RRGGBB */
+#define WIN_SURFACE_XBGR8888 1 /* uint32_t 픽셀 = 0x00BBGGRR */
+
+/*
+ * SyscallOpenWindowSurface가 채워주는 창 surface 정보.
+ * buffers는 창 내부 영역 크기의 픽셀 버퍼이며 화면과 같은 픽셀 형식(format)이다.
+ * 앱은 buffers[back]에 그린 뒤 SyscallWinCommit을 호출하고, 반환된 번호의 버퍼에 다음 프레임을 그린다.
+ * 새 back 버퍼에는 두 프레임 전의 내용이 남아있다.
+ */
+struct WinSurface {
+	uint32_t* buffers[WIN_SURFACE_BUFFERS];
+	int32_t width, height;	// 창 내부 영역 크기
+	int32_t stride;			// 한 줄의 픽셀 수
+	uint32_t format;		// WIN_SURFACE_*
+	int32_t back;			// 처음 그릴 버퍼 번호
+	uint32_t reserved;
+};
+
+/* 0x00RRGGBB 색을 surface의 픽셀 형식으로 변환한다 */
+static inline uint32_t WinSurfaceColor(const struct WinSurface* surface, uint32_t rgb) {
+	if (surface->format == WIN_SURFACE_XRGB8888) {
+		return rgb;
+	}
+	return (rgb & 0x00ff00) | (rgb >> 16 & 0xff) | (rgb & 0xff) << 16;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,6 +1,7 @@
 #include "window.hpp"
 #include "logger.hpp"
 #include "font.hpp"
+#include <algorithm>
 
 Window::Window(int width, int height, PixelFormat shadow_format) : width(width), height(height) {
 	data.resize(width * height);
@@ -21,7 +22,32 @@ void Window::DrawTo(FrameBuffer& dst, Vector2D<int> pos, const Rectangle<int>& a
 	if (!transparent_color) {
 		Rect<int> window_area{ pos, this->Size() };
 		Rect<int> intersection = area & window_area;
-		dst.Copy(intersection.pos, shadow_buffer, { intersection.pos - pos, intersection.size });
+		if (!surface) {
+			dst.Copy(intersection.pos, shadow_buffer, { intersection.pos - pos, intersection.size });
+			return;
+		}
+
+		// surface가 덮는 부분은 front 버퍼에서, 나머지(테두리)는 shadow_buffer에서 복사한다
+		const Rect<int> surface_area{ pos + surface_pos, surface->Size() };
+		const Rect<int> inner = intersection & surface_area;
+		if (inner.size.x <= 0 || inner.size.y <= 0) {
+			dst.Copy(intersection.pos, shadow_buffer, { intersection.pos - pos, intersection.size });
+			return;
+		}
+		const auto end = intersection.pos + intersection.size;
+		const auto inner_end = inner.pos + inner.size;
+		const Rect<int> borders[] = {
+			{ intersection.pos, { intersection.size.x, inner.pos.y - intersection.pos.y } }, // 위
+			{ { intersection.pos.x, inner_end.y }, { intersection.size.x, end.y - inner_end.y } }, // 아래
+			{ { intersection.pos.x, inner.pos.y }, { inner.pos.x - intersection.pos.x, inner.size.y } }, // 왼쪽
+			{ { inner_end.x, inner.pos.y }, { end.x - inner_end.x, inner.size.y } }, // 오른쪽
+		};
+		for (const auto& r : borders) {
+			if (r.size.x > 0 && r.size.y > 0) {
+				dst.Copy(r.pos, shadow_buffer, { r.pos - pos, r.size });
+			}
+		}
+		surface->DrawTo(dst, inner.pos, { inner.pos - surface_area.pos, inner.size });
 		return;
 	}
 
@@ -47,6 +73,37 @@ void Window::Write(Vector2D<int> pos, const PixelColor& c) {
 	shadow_buffer.Writer()->Write(pos, c);
 }
 
+void Window::WritePixels(Vector2D<int> pos, const uint32_t* src, int len, std::optional<uint32_t> color_key) {
+	PixelColor* row = &At(pos.x, pos.y);
+	for (int i = 0; i < len; i++) {
+		if (!color_key || ((src[i] ^ *color_key) & 0x00ffffff) != 0) {
+			row[i] = ToColor(src[i]);
+		}
+	}
+	shadow_buffer.WritePixels(pos, src, len, color_key);
+}
+
+void Window::FillRect(const Rect<int>& area, uint32_t color) {
+	if (area.size.x <= 0 || area.size.y <= 0) {
+		return;
+	}
+	const auto r = area & Rect<int>{{0, 0}, Size()};
+	if (r.size.x <= 0 || r.size.y <= 0) {
+		return;
+	}
+
+	const auto c = ToColor(color);
+	for (int y = r.pos.y; y < r.pos.y + r.size.y; y++) {
+		std::fill_n(&At(r.pos.x, y), r.size.x, c);
+	}
+	shadow_buffer.FillRect(r, color);
+}
+
+void Window::SetSurface(std::unique_ptr<WindowSurface> surface, Vector2D<int> pos) {
+	this->surface = std::move(surface);
+	surface_pos = pos;
+}
+
 void Window::Shift(Vector2D<int> dst_pos, const Rectangle<int>& src) {
 	shadow_buffer.Shift(dst_pos, src);
 }
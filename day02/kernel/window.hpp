@@ -2,6 +2,7 @@
 
 #include "graphics.hpp"
 #include "frame_buffer.hpp"
+#include "window_surface.hpp"
 #include <optional>
 #include <vector>
 #include <string>
@@ -44,6 +45,21 @@ public:
 	// pos 픽셀에 색깔 c를 찍습니다.
 	void Write(Vector2D<int> pos, const PixelColor& c);
 
+	// pos부터 가로로 len개의 0x00RRGGBB 픽셀을 씁니다. color_key와 같은 색은 건너뜁니다 (FrameBuffer::WritePixels)
+	void WritePixels(Vector2D<int> pos, const uint32_t* src, int len, std::optional<uint32_t> color_key);
+
+	/**
+	 * @brief pos(창 좌표)부터 surface 크기만큼의 영역을 shadow_buffer 대신 surface의 front 버퍼로 렌더링합니다.
+	 * 이 영역에 Write 등으로 그린 픽셀은 surface에 가려서 보이지 않습니다
+	 */
+	void SetSurface(std::unique_ptr<WindowSurface> surface, Vector2D<int> pos);
+	WindowSurface* Surface() const { return surface.get(); }
+	// Surface()가 렌더링되는 영역 (창 좌표)
+	Rect<int> SurfaceArea() const { return { surface_pos, surface ? surface->Size() : Vector2D<int>{0, 0} }; }
+
+	// area를 0x00RRGGBB 색 color로 채웁니다. 창 밖으로 나가는 부분은 잘립니다
+	void FillRect(const Rect<int>& area, uint32_t color);
+
 	// 사각형 영역 src에 그려진 픽셀을 dst_pos(x, y) 위치로 이동합니다.
 	void Shift(Vector2D<int> dst_pos, const Rectangle<int>& src);
 
@@ -63,6 +79,8 @@ private:
 	std::optional<PixelColor> transparent_color{std::nullopt};
 
 	FrameBuffer shadow_buffer{};
+	std::unique_ptr<WindowSurface> surface{};
+	Vector2D<int> surface_pos{0, 0};
 };
 
 class TitleBarWindow : public Window {
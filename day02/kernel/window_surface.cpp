@@ -0,0 +1,90 @@
+#include "window_surface.hpp"
+#include "paging.hpp"
+#include "task.hpp"
+#include "interrupt.hpp"
+#include "asmfunc.h"
+#include "logger.hpp"
+#include <cstring>
+
+WithError<std::unique_ptr<WindowSurface>> WindowSurface::New(Vector2D<int> size, PixelFormat format) {
+	const size_t bytes = 4 * static_cast<size_t>(size.x) * size.y;
+	const size_t buffer_frames = (bytes + BytesPerFrame - 1) / BytesPerFrame;
+	const auto frame = memory_manager->Allocate(buffer_frames * kNumBuffers);
+	if (!frame.has_value) {
+		return { nullptr, frame.error };
+	}
+	memset((*frame).Frame(), 0, buffer_frames * kNumBuffers * BytesPerFrame);
+
+	std::unique_ptr<WindowSurface> surface{new WindowSurface(*frame, buffer_frames, size, format)};
+	return { std::move(surface), MakeError(Error::kSuccess) };
+}
+
+WindowSurface::WindowSurface(FrameID frame, size_t buffer_frames, Vector2D<int> size, PixelFormat format)
+	: frame{frame}, buffer_frames{buffer_frames}, size{size} {
+	for (int i = 0; i < kNumBuffers; i++) {
+		FrameBufferConfig config{};
+		config.frame_buffer = reinterpret_cast<uint8_t*>(frame.Frame()) + i * BufferBytes();
+		config.pixels_per_scan_line = size.x;
+		config.horizontal_resolution = size.x;
+		config.vertical_resolution = size.y;
+		config.pixel_format = format;
+		if (auto err = buffers[i].Init(config)) {
+			Log(kError, "failed to initialize surface buffer: %s at %s:%d\n",
+				err.Name(), err.File(), err.Line());
+		}
+	}
+}
+
+WindowSurface::~WindowSurface() {
+	// 아직 앱이 매핑하고 있는 프레임은 재사용되면 안 되므로 해제하지 않는다
+	if (mapped_cr3 == 0) {
+		memory_manager->Free(frame, buffer_frames * kNumBuffers);
+	}
+}
+
+Error WindowSurface::Map(uint64_t vaddr) {
+	if (auto err = MapSharedFrames(LinearAddress4Level{vaddr}, frame.Frame(), buffer_frames * kNumBuffers)) {
+		return err;
+	}
+	mapped_cr3 = GetCR3();
+	mapped_vaddr = vaddr;
+	return MakeError(Error::kSuccess);
+}
+
+void WindowSurface::Unmap() {
+	if (mapped_cr3 == 0) {
+		return;
+	}
+	UnmapSharedFrames(mapped_cr3, LinearAddress4Level{mapped_vaddr}, buffer_frames * kNumBuffers);
+	mapped_cr3 = 0;
+}
+
+void WindowSurface::DrawTo(FrameBuffer& dst, Vector2D<int> pos, const Rectangle<int>& src_area) {
+	int i;
+	{
+		InterruptDisabler guard;
+		i = front;
+		++readers[i];
+	}
+
+	dst.Copy(pos, buffers[i], src_area);
+
+	InterruptDisabler guard;
+	if (--readers[i] == 0 && i != front && commit_waiter) {
+		task_manager->Wakeup(commit_waiter);
+	}
+}
+
+int WindowSurface::Commit() {
+	InterruptDisabler guard;
+	front = Back();
+
+	// 이전 front를 읽는 중인 합성기가 끝나기 전에 앱이 덮어쓰지 않도록 기다린다
+	auto& task = task_manager->CurrentTask();
+	while (readers[Back()] > 0) {
+		commit_waiter = &task;
+		task_manager->Sleep(&task);
+	}
+	commit_waiter = nullptr;
+	return Back();
+}
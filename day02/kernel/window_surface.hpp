@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include "frame_buffer.hpp"
+#include "memory_manager.hpp"
+
+class Task;
+
+/**
+ * @class WindowSurface
+ * @brief 앱이 직접 그리는 창 내부 영역입니다 (SyscallOpenWindowSurface).
+ * 화면과 같은 픽셀 형식의 버퍼 kNumBuffers개를 연속된 프레임으로 할당해서 앱 주소 공간에 그대로 매핑하므로 픽셀을 복사하지 않습니다.
+ * 앱은 back 버퍼에 그린 뒤 Commit으로 front와 바꾸고, 합성기는 front 버퍼만 읽으므로 그리는 중인 프레임은 화면에 나오지 않습니다.
+ */
+class WindowSurface {
+public:
+	static constexpr int kNumBuffers = 2;
+
+	/**
+	 * @brief size 크기의 버퍼를 할당합니다. 버퍼는 검은색으로 초기화됩니다
+	 * @return [Error::kNoEnoughMemory] 프레임을 할당할 수 없는 경우
+	 */
+	static WithError<std::unique_ptr<WindowSurface>> New(Vector2D<int> size, PixelFormat format);
+	~WindowSurface();
+	WindowSurface(const WindowSurface&) = delete;
+	WindowSurface& operator=(const WindowSurface&) = delete;
+
+	Vector2D<int> Size() const { return size; }
+	PixelFormat Format() const { return buffers[0].Config().pixel_format; }
+	// 버퍼 하나의 바이트 수 (페이지 단위로 올림). i번째 버퍼는 Buffer(0) + i * BufferBytes()에 있다
+	size_t BufferBytes() const { return buffer_frames * BytesPerFrame; }
+	uint8_t* Buffer(int i) const { return buffers[i].Config().frame_buffer; }
+	int Back() const { return 1 - front; }
+
+	/**
+	 * @brief 현재 CR3의 vaddr에 모든 버퍼를 매핑합니다. 창을 닫거나 앱이 종료될 때 Unmap으로 제거해야 하며,
+	 * 매핑이 남아있는 동안에는 소멸자가 프레임을 해제하지 않습니다
+	 */
+	Error Map(uint64_t vaddr);
+	// Map한 주소 공간(현재 CR3가 아니어도 된다)에서 매핑을 제거합니다
+	void Unmap();
+	// 매핑한 주소 공간의 CR3 (매핑되지 않았으면 0)
+	uint64_t MappedCR3() const { return mapped_cr3; }
+
+	/**
+	 * @brief front 버퍼의 src_area를 dst의 pos에 복사합니다 (Window::DrawTo).
+	 * 복사하는 동안에는 Commit이 이 버퍼를 앱에게 back으로 돌려주지 않습니다
+	 */
+	void DrawTo(FrameBuffer& dst, Vector2D<int> pos, const Rectangle<int>& src_area);
+
+	/**
+	 * @brief back 버퍼를 front로 바꿉니다. 새 back 버퍼(이전 front)를 합성기가 읽는 중이면 다 읽을 때까지 sleep합니다
+	 * @return 앱이 다음에 그릴 back 버퍼 번호
+	 */
+	int Commit();
+
+private:
+	WindowSurface(FrameID frame, size_t buffer_frames, Vector2D<int> size, PixelFormat format);
+
+	FrameID frame;
+	size_t buffer_frames;
+	Vector2D<int> size;
+	std::array<FrameBuffer, kNumBuffers> buffers;
+	// 아래는 인터럽트 금지 상태에서만 접근한다
+	int front {0};
+	std::array<int, kNumBuffers> readers {}; // 버퍼를 읽고 있는 DrawTo 수
+	Task* commit_waiter {nullptr};
+	uint64_t mapped_cr3 {0}, mapped_vaddr {0};
+};
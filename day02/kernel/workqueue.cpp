@@ -0,0 +1,91 @@
+#include "workqueue.hpp"
+#include "task.hpp"
+#include "queue.hpp"
+#include "asmfunc.h"
+
+namespace {
+	struct Work {
+		WorkFunc* func;
+		uint64_t arg;
+		uint64_t queued_tsc;
+	};
+
+	struct WorkQueue {
+		MPSCQueue<Work, 256> works;
+		Task* worker {nullptr};
+		WorkQueueStat stat {};
+	};
+
+	std::array<WorkQueue, kNumWorkPriorities>* work_queues;
+
+	constexpr std::array<unsigned int, kNumWorkPriorities> kWorkerLevel = {
+		TaskManager::kTaskMaxLevel, TaskManager::kMLFQMaxLevel, TaskManager::kMLFQMinLevel
+	};
+
+	void TaskWorker(TaskID_t task_id, int64_t data) {
+		auto& queue = (*work_queues)[data];
+
+		Work work;
+		while (true) {
+			while (queue.works.try_pop(work)) {
+				queue.stat.latency.Record(ReadTSC() - work.queued_tsc);
+				work.func(work.arg);
+				++queue.stat.executed;
+			}
+
+			// Task::WaitMsgs와 마찬가지로 인터럽트를 금지한 채로 다시 확인한 뒤 sleep한다
+			InterruptDisabler guard;
+			if (queue.works.empty()) {
+				queue.worker->Sleep();
+			}
+		}
+	}
+}
+
+bool QueueWork(WorkPriority prio, WorkFunc* func, uint64_t arg) {
+	auto& queue = (*work_queues)[prio];
+	if (!queue.works.try_push(Work{func, arg, ReadTSC()})) {
+		++queue.stat.dropped;
+		return false;
+	}
+	++queue.stat.queued;
+
+	if (!queue.worker->Running()) {
+		InterruptDisabler guard;
+		queue.worker->Wakeup();
+	}
+	return true;
+}
+
+WorkQueueStat GetWorkQueueStat(WorkPriority prio, bool reset) {
+	InterruptDisabler guard;
+	auto& stat = (*work_queues)[prio].stat;
+	const WorkQueueStat copy = stat;
+	if (reset) {
+		stat.latency = {};
+	}
+	return copy;
+}
+
+const char* WorkPriorityName(WorkPriority prio) {
+	switch (prio) {
+		case kWorkHigh: return "high";
+		case kWorkNormal: return "normal";
+		case kWorkLow: return "low";
+		default: return "?";
+	}
+}
+
+bool WorkQueuesReady() {
+	return work_queues != nullptr;
+}
+
+void InitializeWorkQueues() {
+	work_queues = new std::array<WorkQueue, kNumWorkPriorities>;
+
+	for (int prio = 0; prio < kNumWorkPriorities; prio++) {
+		Task& worker = task_manager->NewTask().InitContext(TaskWorker, prio);
+		task_manager->SetFixedLevel(&worker, kWorkerLevel[prio]);
+		(*work_queues)[prio].worker = &worker;
+	}
+}
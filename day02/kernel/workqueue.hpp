@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include "interrupt.hpp"
+
+using WorkFunc = void(uint64_t arg);
+
+/* 우선순위마다 전용 worker Task가 하나씩 있다 */
+enum WorkPriority : int {
+	kWorkHigh,		// 입력 장치(xHCI), 화면 합성. main task와 같은 최상위 레벨에서 실행된다
+	kWorkNormal,	// 타이머 콜백. MLFQ 최상위 레벨(interactive Task와 같은 레벨)에 고정된다
+	kWorkLow,		// 급하지 않은 작업. MLFQ 최하위 레벨에 고정된다
+	kNumWorkPriorities,
+};
+
+struct WorkQueueStat {
+	uint64_t queued;
+	uint64_t dropped;				// 큐가 가득 차서 버려진 work 수
+	uint64_t executed;
+	InterruptLatencyStat latency;	// QueueWork 호출부터 work 함수가 시작될 때까지의 지연 (TSC 사이클)
+};
+
+/**
+ * @brief work를 큐에 넣고 해당 우선순위의 worker Task를 깨웁니다 (bottom half).
+ * 메모리를 할당하지 않으며, 인터럽트 핸들러에서 인터럽트를 금지하지 않고 호출할 수 있습니다.
+ * 같은 우선순위의 work는 넣은 순서대로 하나씩 실행됩니다.
+ * @return 큐가 가득 차서 work를 버린 경우 false
+ */
+bool QueueWork(WorkPriority prio, WorkFunc* func, uint64_t arg = 0);
+
+/**
+ * @brief 우선순위별 통계를 복사합니다. reset이 true면 지연 시간 통계를 초기화합니다 (latstat)
+ */
+WorkQueueStat GetWorkQueueStat(WorkPriority prio, bool reset = false);
+const char* WorkPriorityName(WorkPriority prio);
+
+// InitializeWorkQueues 이후면 true
+bool WorkQueuesReady();
+
+/**
+ * @brief 우선순위별 worker Task를 생성합니다. InitTask 이후, 인터럽트 핸들러가 QueueWork를 호출하기 전에 호출해야 합니다
+ */
+void InitializeWorkQueues();